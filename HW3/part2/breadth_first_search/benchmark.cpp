@@ -0,0 +1,198 @@
+#include "benchmark.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <omp.h>
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#include "common/CycleTimer.h"
+#include "common/memory_policy.h"
+#include "bfs.h"
+
+#define NOT_VISITED_MARKER -1
+
+enum search_variant { SEARCH_TOP_DOWN, SEARCH_BOTTOM_UP, SEARCH_HYBRID, NUM_SEARCH_VARIANTS };
+
+static const char* variant_names[NUM_SEARCH_VARIANTS] = { "top-down", "bottom-up", "hybrid" };
+
+// Picks up to GRAPH500_ROOTS distinct roots uniformly among the vertices
+// with outgoing edges, the same ones on every run
+template <typename G>
+static std::vector<Vertex> pick_roots(G* g)
+{
+    std::vector<Vertex> candidates;
+    for (Vertex v = 0; v < g->num_nodes; v++)
+        if (outgoing_size(g, v) > 0)
+            candidates.push_back(v);
+
+    std::mt19937_64 rng(GRAPH500_SEED);
+    int count = std::min((int) candidates.size(), GRAPH500_ROOTS);
+    for (int i = 0; i < count; i++) {
+        size_t pick = i + rng() % (candidates.size() - i);
+        std::swap(candidates[i], candidates[pick]);
+    }
+    candidates.resize(count);
+    return candidates;
+}
+
+template <typename G>
+static void run_search(G* g, search_variant variant, solution* sol, Vertex root)
+{
+    switch (variant) {
+    case SEARCH_TOP_DOWN: bfs_top_down(g, sol, root); break;
+    case SEARCH_BOTTOM_UP: bfs_bottom_up(g, sol, root); break;
+    default: bfs_hybrid(g, sol, root); break;
+    }
+}
+
+// Checks a search result against the Graph500 validation rules, adapted
+// to directed graphs, and returns the number of violations.  Stores the
+// number of edges out of reached vertices, the edges the search had to
+// consider, in *component_edges.
+//
+//  - the root is its own parent, at distance 0
+//  - a vertex has a parent exactly when it has a distance
+//  - every tree edge is an edge of the graph and joins consecutive
+//    levels, so following parents always ends at the root
+//  - no edge leaves the reached vertices or skips forward a level
+template <typename G>
+static long validate_bfs_tree(G* g, const solution* sol, Vertex root, long* component_edges)
+{
+    const int* distances = sol->distances;
+    const int* parents = sol->parents;
+    long errors = 0;
+    long edges = 0;
+
+    if (parents[root] != root || distances[root] != 0)
+        errors++;
+
+    #pragma omp parallel for reduction(+:errors, edges) schedule(dynamic, 1024)
+    for (Vertex v = 0; v < g->num_nodes; v++) {
+        bool reached = parents[v] != NOT_VISITED_MARKER;
+        if (reached != (distances[v] != NOT_VISITED_MARKER)) {
+            errors++;
+            continue;
+        }
+        if (!reached)
+            continue;
+
+        edges += outgoing_size(g, v);
+
+        if (v != root) {
+            Vertex parent = parents[v];
+            if (distances[v] <= 0 || parent < 0 || parent >= g->num_nodes ||
+                distances[parent] + 1 != distances[v]) {
+                errors++;
+            } else {
+                bool tree_edge_exists = false;
+                for (Vertex u : incoming_neighbors(g, v)) {
+                    if (u == parent) {
+                        tree_edge_exists = true;
+                        break;
+                    }
+                }
+                if (!tree_edge_exists)
+                    errors++;
+            }
+        }
+
+        for (Vertex u : outgoing_neighbors(g, v)) {
+            if (distances[u] == NOT_VISITED_MARKER || distances[u] > distances[v] + 1)
+                errors++;
+        }
+    }
+
+    *component_edges = edges;
+    return errors;
+}
+
+// Value at fraction p of the sorted samples, interpolating between ranks
+static double quantile(const std::vector<double>& sorted, double p)
+{
+    double rank = p * (sorted.size() - 1);
+    size_t below = (size_t) rank;
+    if (below + 1 >= sorted.size())
+        return sorted.back();
+    return sorted[below] + (rank - below) * (sorted[below + 1] - sorted[below]);
+}
+
+template <typename G>
+static void graph500_benchmark_impl(G* g, int thread_count)
+{
+    std::vector<Vertex> roots = pick_roots(g);
+    if (roots.empty()) {
+        fprintf(stderr, "The graph has no vertex with outgoing edges to search from.\n");
+        exit(1);
+    }
+
+    std::vector<int> num_threads;
+    if (thread_count <= -1) {
+        int max_threads = omp_get_max_threads();
+        for (int i = 1; i < max_threads; i *= 2)
+            num_threads.push_back(i);
+        num_threads.push_back(max_threads);
+    } else {
+        num_threads.push_back(thread_count);
+    }
+
+    solution sol;
+    sol.distances = (int*)policy_alloc(sizeof(int) * g->num_nodes);
+    sol.parents = (int*)policy_alloc(sizeof(int) * g->num_nodes);
+
+    printf("\n");
+    printf("Graph stats:\n");
+    printf("  Edges: %ld\n", (long) g->num_edges);
+    printf("  Nodes: %d\n", g->num_nodes);
+    printf("----------------------------------------------------------\n");
+    printf("Graph500 benchmark: %zu roots (seed %d), TEPS in millions\n", roots.size(), GRAPH500_SEED);
+    printf("  (edges counted once per direction stored, i.e. twice per undirected edge)\n");
+    printf("Threads  Search     Harmonic       Min        Q1    Median        Q3       Max  Invalid\n");
+
+    bool all_valid = true;
+    for (int t : num_threads) {
+        omp_set_num_threads(t);
+
+        for (int variant = 0; variant < NUM_SEARCH_VARIANTS; variant++) {
+            std::vector<double> teps;
+            double inverse_sum = 0;
+            int invalid = 0;
+
+            for (Vertex root : roots) {
+                double start = CycleTimer::currentSeconds();
+                run_search(g, (search_variant) variant, &sol, root);
+                double seconds = CycleTimer::currentSeconds() - start;
+
+                long edges;
+                if (validate_bfs_tree(g, &sol, root, &edges) != 0)
+                    invalid++;
+
+                double rate = edges / seconds / 1e6;
+                teps.push_back(rate);
+                inverse_sum += 1 / rate;
+            }
+
+            std::sort(teps.begin(), teps.end());
+            printf("%4d:    %-9s %9.2f %9.2f %9.2f %9.2f %9.2f %9.2f  %7d\n",
+                   t, variant_names[variant], teps.size() / inverse_sum,
+                   teps.front(), quantile(teps, 0.25), quantile(teps, 0.5),
+                   quantile(teps, 0.75), teps.back(), invalid);
+            if (invalid)
+                all_valid = false;
+        }
+    }
+
+    printf("----------------------------------------------------------\n");
+    printf("Validation: %s\n", all_valid ? "all BFS trees valid" : "INVALID BFS trees found");
+    printf("----------------------------------------------------------\n");
+
+    policy_free(sol.distances);
+    policy_free(sol.parents);
+}
+
+void graph500_benchmark(Graph graph, int thread_count) { graph500_benchmark_impl(graph, thread_count); }
+void graph500_benchmark(Graph64 graph, int thread_count) { graph500_benchmark_impl(graph, thread_count); }
+void graph500_benchmark(CompressedGraph graph, int thread_count) { graph500_benchmark_impl(graph, thread_count); }
+void graph500_benchmark(CompressedGraph64 graph, int thread_count) { graph500_benchmark_impl(graph, thread_count); }
@@ -0,0 +1,20 @@
+#ifndef __BENCHMARK_H__
+#define __BENCHMARK_H__
+
+#include "common/graph.h"
+#include "common/compressed_graph.h"
+
+// Graph500-style benchmark: every search variant runs from
+// GRAPH500_ROOTS random roots with outgoing edges, each BFS tree is
+// validated, and TEPS (edges in the searched component per second) are
+// summarized by harmonic mean and quartiles.  thread_count is handled as
+// by the timing runs: -1 means every power of two up to the maximum.
+#define GRAPH500_ROOTS 64
+#define GRAPH500_SEED 1
+
+void graph500_benchmark(Graph graph, int thread_count);
+void graph500_benchmark(Graph64 graph, int thread_count);
+void graph500_benchmark(CompressedGraph graph, int thread_count);
+void graph500_benchmark(CompressedGraph64 graph, int thread_count);
+
+#endif
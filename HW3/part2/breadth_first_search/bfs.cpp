@@ -4,14 +4,98 @@
 #include <stdlib.h>
 #include <string.h>
 #include <cstddef>
+#include <vector>
+#include <algorithm>
 #include <omp.h>
 
 #include "../common/CycleTimer.h"
 #include "../common/graph.h"
+#include "../common/compressed_graph.h"
+#include "../common/bitmap.h"
+#include "../common/edge_partition.h"
+#include "../common/parallel_scan.h"
+#include "../common/trace.h"
+#include "bottom_up_simd.h"
 
-#define ROOT_NODE_ID 0
 #define NOT_VISITED_MARKER -1
-#define HYBIRD_THRESHOLD 10000000
+
+static hybrid_params current_hybrid_params = { HYBRID_DEFAULT_ALPHA, HYBRID_DEFAULT_BETA };
+static std::vector<hybrid_level> hybrid_log;
+
+void set_hybrid_params(const hybrid_params* params)
+{
+    current_hybrid_params = *params;
+}
+
+hybrid_params get_hybrid_params()
+{
+    return current_hybrid_params;
+}
+
+int hybrid_level_log(const hybrid_level** levels)
+{
+    *levels = hybrid_log.data();
+    return hybrid_log.size();
+}
+
+bool bottom_up_kernel_supported(bottom_up_kernel kernel)
+{
+    switch (kernel) {
+    case BOTTOM_UP_AVX512:
+        return cpu_supports_avx512();
+    case BOTTOM_UP_AVX2:
+        return cpu_supports_avx2();
+    default:
+        return true;
+    }
+}
+
+static bottom_up_kernel widest_bottom_up_kernel()
+{
+    if (bottom_up_kernel_supported(BOTTOM_UP_AVX512))
+        return BOTTOM_UP_AVX512;
+    if (bottom_up_kernel_supported(BOTTOM_UP_AVX2))
+        return BOTTOM_UP_AVX2;
+    return BOTTOM_UP_SCALAR;
+}
+
+static bottom_up_kernel current_bottom_up_kernel = widest_bottom_up_kernel();
+
+bool set_bottom_up_kernel(bottom_up_kernel kernel)
+{
+    if (!bottom_up_kernel_supported(kernel))
+        return false;
+    current_bottom_up_kernel = kernel;
+    return true;
+}
+
+bottom_up_kernel get_bottom_up_kernel()
+{
+    return current_bottom_up_kernel;
+}
+
+const char* bottom_up_kernel_name(bottom_up_kernel kernel)
+{
+    switch (kernel) {
+    case BOTTOM_UP_AVX512:
+        return "avx512";
+    case BOTTOM_UP_AVX2:
+        return "avx2";
+    default:
+        return "scalar";
+    }
+}
+
+bool parse_bottom_up_kernel(const char* name, bottom_up_kernel* kernel)
+{
+    for (bottom_up_kernel k : { BOTTOM_UP_SCALAR, BOTTOM_UP_AVX2, BOTTOM_UP_AVX512 }) {
+        if (strcmp(name, bottom_up_kernel_name(k)) == 0) {
+            *kernel = k;
+            return true;
+        }
+    }
+    return false;
+}
 
 void vertex_set_clear(vertex_set *list)
 {
@@ -25,88 +109,289 @@ void vertex_set_init(vertex_set *list, int count)
     vertex_set_clear(list);
 }
 
-// Take one step of "top-down" BFS.  For each vertex on the frontier,
-// follow all outgoing edges, and add all neighboring vertices to the
-// new_frontier.
-void top_down_step(
-    Graph g,
-    vertex_set *frontier,
-    vertex_set *new_frontier,
-    int *distances)
+void bfs_workspace_init(bfs_workspace *workspace)
 {
-    #pragma omp parallel
-    {
-        vertex_set *local_frontier = (vertex_set *)malloc(sizeof(vertex_set));
+    memset(workspace, 0, sizeof(bfs_workspace));
+}
 
-        vertex_set_init(local_frontier, g->num_nodes);
+void bfs_workspace_reserve(bfs_workspace *workspace, int num_nodes, int num_threads)
+{
+    if (num_nodes > workspace->num_nodes) {
+        long words = bitmap_words(num_nodes);
+        free(workspace->lists[0].vertices);
+        free(workspace->lists[1].vertices);
+        free(workspace->frontier_bits);
+        free(workspace->next_bits);
+        free(workspace->visited);
+        free(workspace->degree_offsets);
+        vertex_set_init(&workspace->lists[0], num_nodes);
+        vertex_set_init(&workspace->lists[1], num_nodes);
+        workspace->frontier_bits = (uint64_t *)malloc(sizeof(uint64_t) * words);
+        workspace->next_bits = (uint64_t *)malloc(sizeof(uint64_t) * words);
+        workspace->visited = (uint64_t *)malloc(sizeof(uint64_t) * words);
+        workspace->degree_offsets = (long *)malloc(sizeof(long) * ((long) num_nodes + 1));
+        workspace->num_nodes = num_nodes;
+    }
+
+    if (num_threads > workspace->num_threads) {
+        free(workspace->chunks);
+        free(workspace->block_counts);
+        free(workspace->thread_edges);
+        free(workspace->scan_sums);
+        // whole cache lines per thread, so chunks never share one
+        workspace->chunks = (int *)aligned_alloc(64, sizeof(int) * FRONTIER_CHUNK * num_threads);
+        workspace->block_counts = (int *)malloc(sizeof(int) * (num_threads + 1));
+        workspace->thread_edges = (long *)malloc(sizeof(long) * num_threads);
+        workspace->scan_sums = (long *)malloc(sizeof(long) * (num_threads + 1));
+        workspace->num_threads = num_threads;
+    }
+}
 
-        #pragma omp for nowait schedule(dynamic, 1024)
-        for (int i = 0; i < frontier->count; i++) {
-            int node = frontier->vertices[i];
+void bfs_workspace_free(bfs_workspace *workspace)
+{
+    free(workspace->lists[0].vertices);
+    free(workspace->lists[1].vertices);
+    free(workspace->frontier_bits);
+    free(workspace->next_bits);
+    free(workspace->visited);
+    free(workspace->chunks);
+    free(workspace->block_counts);
+    free(workspace->degree_offsets);
+    free(workspace->thread_edges);
+    free(workspace->scan_sums);
+    bfs_workspace_init(workspace);
+}
 
-            int start_edge = g->outgoing_starts[node];
-            int end_edge = (node == g->num_nodes - 1)
-                               ? g->num_edges
-                               : g->outgoing_starts[node + 1];
+// Used by searches called without a workspace
+static bfs_workspace default_workspace;
 
-            // attempt to add all neighbors to the new frontier
-            for (int neighbor = start_edge; neighbor < end_edge; neighbor++) {
-                int outgoing = g->outgoing_edges[neighbor];
+// Sizes the workspace for a search of graph with the current thread
+// count, falling back to the shared one
+template <typename G>
+static bfs_workspace *prepare_workspace(G* graph, bfs_workspace *workspace)
+{
+    if (workspace == NULL)
+        workspace = &default_workspace;
+    bfs_workspace_reserve(workspace, graph->num_nodes, omp_get_max_threads());
+    return workspace;
+}
 
-                bool not_visited = __sync_bool_compare_and_swap(&distances[outgoing], NOT_VISITED_MARKER, distances[node] + 1);
-                if (not_visited) {
-                    int index = local_frontier->count++;
-                    local_frontier->vertices[index] = outgoing;
-                }
+// Appends count vertices collected by one thread to the shared frontier
+static void append_chunk(vertex_set *frontier, const int *chunk, int count)
+{
+    int index = __sync_fetch_and_add(&frontier->count, count);
+    memcpy(frontier->vertices + index, chunk, sizeof(int) * count);
+}
+
+// Marks every vertex but the root NOT_VISITED
+static void init_solution(solution *sol, int num_nodes, Vertex root)
+{
+    #pragma omp parallel for schedule(static)
+    for (int i = 0; i < num_nodes; i++)
+        sol->distances[i] = NOT_VISITED_MARKER;
+    sol->distances[root] = 0;
+
+    if (sol->parents) {
+        #pragma omp parallel for schedule(static)
+        for (int i = 0; i < num_nodes; i++)
+            sol->parents[i] = NOT_VISITED_MARKER;
+        sol->parents[root] = root;
+    }
+}
+
+// Frontier edges handed to a thread at a time by top_down_step
+#define TOP_DOWN_EDGE_GRAIN 2048
+
+// Frontiers up to this size have their degrees summed serially
+#define TOP_DOWN_SERIAL_SCAN 4096
+
+// Visits the neighbors lo .. hi - 1 of v's outgoing list.  Plain lists
+// are indexed directly; varint lists can only be decoded from their
+// start, so top_down_step never splits them.
+template <typename V, typename O, typename F>
+static inline void visit_outgoing(const basic_graph<V, O>* g, V v, long lo, long hi, F visit)
+{
+    const V* neighbors = outgoing_begin(g, v);
+    for (long k = lo; k < hi; k++)
+        visit(neighbors[k]);
+}
+
+template <typename V, typename O, typename F>
+static inline void visit_outgoing(const basic_compressed_graph<V, O>* g, V v, long, long, F visit)
+{
+    for (V u : outgoing_neighbors(g, v))
+        visit(u);
+}
+
+template <typename V, typename O>
+static inline bool splits_lists(const basic_graph<V, O>*) { return true; }
+template <typename V, typename O>
+static inline bool splits_lists(const basic_compressed_graph<V, O>*) { return false; }
+
+// Stores the prefix sums of the frontier's out-degrees in
+// offsets[0 .. count], returning the total.  scan_sums is the scan's
+// scratch, see parallel_exclusive_scan.
+template <typename G>
+static long frontier_degree_offsets(G* g, const vertex_set *frontier, long *offsets, long *scan_sums)
+{
+    int count = frontier->count;
+    long total = 0;
+
+    if (count <= TOP_DOWN_SERIAL_SCAN) {
+        for (int i = 0; i < count; i++) {
+            offsets[i] = total;
+            total += outgoing_size(g, frontier->vertices[i]);
+        }
+    } else {
+        #pragma omp parallel for schedule(static)
+        for (int i = 0; i < count; i++)
+            offsets[i] = outgoing_size(g, frontier->vertices[i]);
+        total = parallel_exclusive_scan(offsets, offsets, count, scan_sums);
+    }
+
+    offsets[count] = total;
+    return total;
+}
+
+// What a step reports besides its result, for the hybrid log and the
+// trace
+struct step_stats {
+    // edges the step scanned
+    long examined;
+    // most edges one thread scanned over the mean
+    double imbalance;
+    // per-thread busy seconds to add to, or NULL (see trace_busy_slots)
+    double *busy;
+};
+
+// Take one step of "top-down" BFS.  For each vertex on the frontier,
+// follow all outgoing edges, and add all neighboring vertices to the
+// new_frontier.  Each thread gathers discovered vertices in its own
+// chunk and appends the chunk whenever it fills.  If new_frontier_edges
+// is set, stores the number of edges out of the new frontier there.
+//
+// Work is handed out by edges rather than by vertices: the frontier's
+// out-degrees are prefix-summed and threads take ranges of
+// TOP_DOWN_EDGE_GRAIN edges, so a hub's list is spread over many
+// threads.  Compressed lists are kept whole and go to the range their
+// first edge falls in.  If stats is set, fills in the edges scanned and
+// how evenly the threads shared them, and adds their busy times.
+template <typename G>
+static void top_down_step(
+    G* g,
+    vertex_set *frontier,
+    vertex_set *new_frontier,
+    int *distances,
+    int *parents,
+    bfs_workspace *workspace,
+    long *new_frontier_edges = NULL,
+    step_stats *stats = NULL)
+{
+    long edges = 0;
+    bool count_edges = new_frontier_edges != NULL;
+
+    const long *offsets = workspace->degree_offsets;
+    long total = frontier_degree_offsets(g, frontier, workspace->degree_offsets, workspace->scan_sums);
+    long tasks = (total + TOP_DOWN_EDGE_GRAIN - 1) / TOP_DOWN_EDGE_GRAIN;
+    int count = frontier->count;
+    bool split = splits_lists(g);
+    int num_threads = omp_get_max_threads();
+    double *busy = stats ? stats->busy : NULL;
+
+    #pragma omp parallel num_threads(num_threads) reduction(+:edges)
+    {
+        double start_time = busy ? CycleTimer::currentSeconds() : 0;
+        int tid = omp_get_thread_num();
+        int *chunk = workspace->chunks + (long) tid * FRONTIER_CHUNK;
+        int chunk_count = 0;
+        long scanned = 0;
+
+        #pragma omp for nowait schedule(dynamic, 1)
+        for (long t = 0; t < tasks; t++) {
+            long begin = t * TOP_DOWN_EDGE_GRAIN;
+            long end = begin + TOP_DOWN_EDGE_GRAIN < total ? begin + TOP_DOWN_EDGE_GRAIN : total;
+
+            // split lists start at the vertex holding edge begin, whole
+            // lists at the first vertex whose list starts in the range
+            int i = split ? std::upper_bound(offsets, offsets + count + 1, begin) - offsets - 1
+                          : std::lower_bound(offsets, offsets + count, begin) - offsets;
+
+            for (; i < count && offsets[i] < end; i++) {
+                int node = frontier->vertices[i];
+                int distance = distances[node] + 1;
+                long lo = split && begin > offsets[i] ? begin - offsets[i] : 0;
+                long hi = split && end < offsets[i + 1] ? end - offsets[i] : offsets[i + 1] - offsets[i];
+                scanned += hi - lo;
+
+                // attempt to add all neighbors to the new frontier
+                visit_outgoing(g, node, lo, hi, [&](Vertex outgoing) {
+                    if (distances[outgoing] != NOT_VISITED_MARKER ||
+                        !__sync_bool_compare_and_swap(&distances[outgoing], NOT_VISITED_MARKER, distance))
+                        return;
+                    if (parents)
+                        parents[outgoing] = node;
+                    chunk[chunk_count++] = outgoing;
+                    if (chunk_count == FRONTIER_CHUNK) {
+                        append_chunk(new_frontier, chunk, chunk_count);
+                        chunk_count = 0;
+                    }
+                    if (count_edges)
+                        edges += outgoing_size(g, outgoing);
+                });
             }
         }
 
         // frontier reduction
-        int index = __sync_fetch_and_add(&new_frontier->count, local_frontier->count);
-        memcpy(new_frontier->vertices + index, local_frontier->vertices, sizeof(int) * local_frontier->count);
+        append_chunk(new_frontier, chunk, chunk_count);
+        workspace->thread_edges[tid] = scanned;
+        if (busy)
+            busy[tid] += CycleTimer::currentSeconds() - start_time;
+    }
+
+    if (count_edges)
+        *new_frontier_edges = edges;
 
-        free(local_frontier);
+    if (stats) {
+        long most = 0;
+        for (int t = 0; t < num_threads; t++)
+            most = workspace->thread_edges[t] > most ? workspace->thread_edges[t] : most;
+        stats->examined = total;
+        stats->imbalance = total > 0 ? (double) most * num_threads / total : 1.0;
     }
 }
 
 // Implements top-down BFS.
 //
 // Result of execution is that, for each node in the graph, the
-// distance to the root is stored in sol.distances.
-void bfs_top_down(Graph graph, solution *sol)
+// distance to root is stored in sol.distances.
+template <typename G>
+static void bfs_top_down_impl(G* graph, solution *sol, Vertex root, bfs_workspace *workspace)
 {
+    workspace = prepare_workspace(graph, workspace);
 
-    vertex_set list1;
-    vertex_set list2;
-    vertex_set_init(&list1, graph->num_nodes);
-    vertex_set_init(&list2, graph->num_nodes);
+    vertex_set *frontier = &workspace->lists[0];
+    vertex_set *new_frontier = &workspace->lists[1];
+    vertex_set_clear(frontier);
 
-    vertex_set *frontier = &list1;
-    vertex_set *new_frontier = &list2;
-
-    // initialize all nodes to NOT_VISITED
-    for (int i = 0; i < graph->num_nodes; i++)
-        sol->distances[i] = NOT_VISITED_MARKER;
+    init_solution(sol, graph->num_nodes, root);
 
     // setup frontier with the root node
-    frontier->vertices[frontier->count++] = ROOT_NODE_ID;
-    sol->distances[ROOT_NODE_ID] = 0;
+    frontier->vertices[frontier->count++] = root;
+
+    int run = trace_enabled() ? trace_begin_run() : 0;
+    int depth = 0;
 
     while (frontier->count != 0)
     {
-
-#ifdef VERBOSE
-        double start_time = CycleTimer::currentSeconds();
-#endif
+        double start_time = trace_now();
+        step_stats stats = { 0, 0, trace_busy_slots(omp_get_max_threads()) };
 
         vertex_set_clear(new_frontier);
 
-        top_down_step(graph, frontier, new_frontier, sol->distances);
+        top_down_step(graph, frontier, new_frontier, sol->distances, sol->parents, workspace, NULL, &stats);
 
-#ifdef VERBOSE
-        double end_time = CycleTimer::currentSeconds();
-        printf("frontier=%-10d %.4f sec\n", frontier->count, end_time - start_time);
-#endif
+        trace_record("bfs_top_down", run, depth++, frontier->count, stats.examined, "top-down", 0,
+                     start_time, trace_now() - start_time);
 
         // swap pointers
         vertex_set *tmp = frontier;
@@ -115,44 +400,210 @@ void bfs_top_down(Graph graph, solution *sol)
     }
 }
 
-void bottom_up_step(
-    Graph g,
-    vertex_set *frontier,
-    vertex_set *new_frontier,
-    bool *frontier_set,
-    int *distances)
+// Sets frontier_bits to the vertices of the sparse frontier list
+static void sparse_to_dense(const vertex_set *frontier, uint64_t *frontier_bits, long words)
 {
     #pragma omp parallel
     {
-        vertex_set *local_frontier = (vertex_set *)malloc(sizeof(vertex_set));
-
-        vertex_set_init(local_frontier, g->num_nodes);
-
-        #pragma omp for nowait schedule(dynamic, 1024)
-        for (int i = 0; i < g->num_nodes; i++) {
-            if (distances[i] == NOT_VISITED_MARKER) {
-                const Vertex* start = incoming_begin(g, i);
-                const Vertex* end = incoming_end(g, i);
-                for (const Vertex* v = start; v != end; v++) {
-                    if (frontier_set[*v]) {
-                        int index = local_frontier->count++;
-                        local_frontier->vertices[index] = i;
-                        distances[i] = distances[*v] + 1;
-                        break;
+        #pragma omp for schedule(static)
+        for (long w = 0; w < words; w++)
+            frontier_bits[w] = 0;
+
+        #pragma omp for schedule(static)
+        for (int i = 0; i < frontier->count; i++)
+            bitmap_set_atomic(frontier_bits, frontier->vertices[i]);
+    }
+}
+
+// Fills the frontier list with the vertices of frontier_bits in
+// increasing order.  Each thread counts the bits of one contiguous block
+// of words, the counts are scanned to give every block its offset in the
+// list, and then each thread writes its block.
+static void dense_to_sparse(const uint64_t *frontier_bits, long words, vertex_set *frontier,
+                            int *block_counts)
+{
+    int num_threads = omp_get_max_threads();
+    block_counts[0] = 0;
+
+    #pragma omp parallel num_threads(num_threads)
+    {
+        int tid = omp_get_thread_num();
+        int threads = omp_get_num_threads();
+        long begin = words * tid / threads;
+        long end = words * (tid + 1) / threads;
+
+        int count = 0;
+        for (long w = begin; w < end; w++)
+            count += __builtin_popcountll(frontier_bits[w]);
+        block_counts[tid + 1] = count;
+
+        #pragma omp barrier
+        #pragma omp single
+        {
+            for (int t = 1; t <= threads; t++)
+                block_counts[t] += block_counts[t - 1];
+            frontier->count = block_counts[threads];
+        }
+
+        int index = block_counts[tid];
+        for (long w = begin; w < end; w++) {
+            uint64_t bits = frontier_bits[w];
+            while (bits) {
+                frontier->vertices[index++] = w * BITMAP_WORD_BITS + __builtin_ctzll(bits);
+                bits &= bits - 1;
+            }
+        }
+    }
+}
+
+// Rebuilds the visited bitmap from distances, after top-down steps have
+// discovered vertices without recording them in it.
+static void visited_from_distances(const int *distances, int num_nodes, uint64_t *visited)
+{
+    long words = bitmap_words(num_nodes);
+
+    #pragma omp parallel for schedule(static)
+    for (long w = 0; w < words; w++) {
+        long base = w * BITMAP_WORD_BITS;
+        int bits = num_nodes - base < BITMAP_WORD_BITS ? num_nodes - base : BITMAP_WORD_BITS;
+        uint64_t word = 0;
+        for (int b = 0; b < bits; b++)
+            word |= (uint64_t)(distances[base + b] != NOT_VISITED_MARKER) << b;
+        visited[w] = word;
+    }
+}
+
+// Incoming lists shorter than this are scanned one neighbor at a time
+// even with a SIMD kernel, which then costs more than it saves.  4 was
+// best on scale-16 to scale-20 RMAT graphs, ahead of 1, 2, 8 and 16.
+#define BOTTOM_UP_SIMD_MIN_DEGREE 4
+
+// The first incoming neighbor of v on the frontier, or -1.  Adds the
+// neighbors it checked to examined.
+template <typename V, typename O>
+static inline V frontier_parent(const basic_graph<V, O>* g, V v, const uint64_t* frontier_bits,
+                                bottom_up_kernel kernel, long *examined)
+{
+    const V* neighbors = incoming_begin(g, v);
+    long count = incoming_size(g, v);
+    long k = -1;
+
+    if (kernel == BOTTOM_UP_SCALAR || count < BOTTOM_UP_SIMD_MIN_DEGREE) {
+        for (long j = 0; j < count; j++) {
+            if (bitmap_test(frontier_bits, neighbors[j])) {
+                k = j;
+                break;
+            }
+        }
+    } else if (kernel == BOTTOM_UP_AVX512) {
+        k = first_in_frontier_avx512(neighbors, count, frontier_bits);
+    } else {
+        k = first_in_frontier_avx2(neighbors, count, frontier_bits);
+    }
+    *examined += k >= 0 ? k + 1 : count;
+    return k >= 0 ? neighbors[k] : -1;
+}
+
+template <typename V, typename O>
+static inline V frontier_parent(const basic_compressed_graph<V, O>* g, V v, const uint64_t* frontier_bits,
+                                bottom_up_kernel, long *examined)
+{
+    long checked = 0;
+    for (V u : incoming_neighbors(g, v)) {
+        checked++;
+        if (bitmap_test(frontier_bits, u)) {
+            *examined += checked;
+            return u;
+        }
+    }
+    *examined += checked;
+    return -1;
+}
+
+// Take one step of "bottom-up" BFS.  Every unvisited vertex looks for a
+// parent among its incoming neighbors in frontier_bits and, if it finds
+// one, joins next_bits at distance depth + 1.  Threads own whole words
+// of the bitmaps, so next_bits and visited are written without atomics,
+// and words whose vertices are all visited are skipped outright.
+// Returns the size of the new frontier and, if new_frontier_edges is
+// set, stores the number of edges out of it there.  If stats is set,
+// fills in the edges checked, how unevenly the threads shared them
+// (counted per thread in the workspace's thread_edges), and adds the
+// threads' busy times.
+template <typename G>
+static int bottom_up_step(
+    G* g,
+    const uint64_t *frontier_bits,
+    uint64_t *next_bits,
+    uint64_t *visited,
+    int *distances,
+    int *parents,
+    int depth,
+    bfs_workspace *workspace,
+    long *new_frontier_edges = NULL,
+    step_stats *stats = NULL)
+{
+    int found = 0;
+    long edges = 0;
+    long examined = 0;
+    bool count_edges = new_frontier_edges != NULL;
+    bottom_up_kernel kernel = current_bottom_up_kernel;
+    double *busy = stats ? stats->busy : NULL;
+    int num_threads = omp_get_max_threads();
+    const edge_partition *partition = incoming_partition(g, num_threads);
+
+    #pragma omp parallel reduction(+:found, edges, examined)
+    {
+        double start_time = busy ? CycleTimer::currentSeconds() : 0;
+
+        // ranges of equal incoming edge counts, which start on word
+        // boundaries (see edge_partition.h)
+        #pragma omp for nowait schedule(dynamic, 1)
+        for (int p = 0; p < partition->num_parts; p++) {
+            long last_word = bitmap_words(partition->starts[p + 1]);
+            for (long w = partition->starts[p] / BITMAP_WORD_BITS; w < last_word; w++) {
+                uint64_t unvisited = ~visited[w] & bitmap_valid_mask(g->num_nodes, w);
+                uint64_t discovered = 0;
+
+                while (unvisited) {
+                    int b = __builtin_ctzll(unvisited);
+                    unvisited &= unvisited - 1;
+
+                    Vertex i = w * BITMAP_WORD_BITS + b;
+                    Vertex v = frontier_parent(g, i, frontier_bits, kernel, &examined);
+                    if (v >= 0) {
+                        discovered |= (uint64_t) 1 << b;
+                        distances[i] = depth + 1;
+                        if (parents)
+                            parents[i] = v;
+                        if (count_edges)
+                            edges += outgoing_size(g, i);
                     }
                 }
+
+                next_bits[w] = discovered;
+                visited[w] |= discovered;
+                found += __builtin_popcountll(discovered);
             }
         }
 
-        // frontier reduction
-        int index = __sync_fetch_and_add(&new_frontier->count, local_frontier->count);
-        memcpy(new_frontier->vertices + index, local_frontier->vertices, sizeof(int) * local_frontier->count);
+        workspace->thread_edges[omp_get_thread_num()] = examined;
+        if (busy)
+            busy[omp_get_thread_num()] += CycleTimer::currentSeconds() - start_time;
+    }
 
-        free(local_frontier);
+    if (count_edges)
+        *new_frontier_edges = edges;
+    if (stats) {
+        long most = *std::max_element(workspace->thread_edges, workspace->thread_edges + num_threads);
+        stats->examined = examined;
+        stats->imbalance = examined > 0 ? (double) most * num_threads / examined : 1.0;
     }
+    return found;
 }
 
-void bfs_bottom_up(Graph graph, solution *sol)
+template <typename G>
+static void bfs_bottom_up_impl(G* graph, solution *sol, Vertex root, bfs_workspace *workspace)
 {
     // For PP students:
     //
@@ -165,111 +616,161 @@ void bfs_bottom_up(Graph graph, solution *sol)
     // As was done in the top-down case, you may wish to organize your
     // code by creating subroutine bottom_up_step() that is called in
     // each step of the BFS process.
-    vertex_set list1;
-    vertex_set list2;
-    vertex_set_init(&list1, graph->num_nodes);
-    vertex_set_init(&list2, graph->num_nodes);
-
-    vertex_set *frontier = &list1;
-    vertex_set *new_frontier = &list2;
+    workspace = prepare_workspace(graph, workspace);
 
-    // initialize all nodes to NOT_VISITED
-    for (int i = 0; i < graph->num_nodes; i++)
-        sol->distances[i] = NOT_VISITED_MARKER;
+    long words = bitmap_words(graph->num_nodes);
+    uint64_t *frontier_bits = workspace->frontier_bits;
+    uint64_t *next_bits = workspace->next_bits;
+    uint64_t *visited = workspace->visited;
 
-    // setup frontier with the root node
-    frontier->vertices[frontier->count++] = ROOT_NODE_ID;
-    sol->distances[ROOT_NODE_ID] = 0;
+    init_solution(sol, graph->num_nodes, root);
 
-    bool *frontier_set = (bool *)malloc(sizeof(bool) * graph->num_nodes);
+    #pragma omp parallel for schedule(static)
+    for (long w = 0; w < words; w++) {
+        frontier_bits[w] = 0;
+        visited[w] = 0;
+    }
 
-    while (frontier->count > 0) {
+    // setup frontier with the root node
+    bitmap_set(frontier_bits, root);
+    bitmap_set(visited, root);
 
-#ifdef VERBOSE
-        double start_time = CycleTimer::currentSeconds();
-#endif
+    int frontier_count = 1;
+    int depth = 0;
+    int run = trace_enabled() ? trace_begin_run() : 0;
 
-        vertex_set_clear(new_frontier);
-        memset(frontier_set, 0, sizeof(bool) * graph->num_nodes);
-        for (int f = 0; f < frontier->count; f++) {
-            frontier_set[frontier->vertices[f]] = true;
-        }
+    while (frontier_count > 0) {
+        double start_time = trace_now();
+        step_stats stats = { 0, 0, trace_busy_slots(omp_get_max_threads()) };
+        int current_count = frontier_count;
 
-        bottom_up_step(graph, frontier, new_frontier, frontier_set, sol->distances);
+        frontier_count = bottom_up_step(graph, frontier_bits, next_bits, visited, sol->distances, sol->parents, depth,
+                                        workspace, NULL, &stats);
 
-#ifdef VERBOSE
-        double end_time = CycleTimer::currentSeconds();
-        printf("frontier=%-10d %.4f sec\n", frontier->count, end_time - start_time);
-#endif
+        trace_record("bfs_bottom_up", run, depth, current_count, stats.examined, "bottom-up", 0,
+                     start_time, trace_now() - start_time);
 
         // swap pointers
-        vertex_set *tmp = frontier;
-        frontier = new_frontier;
-        new_frontier = tmp;
+        uint64_t *tmp = frontier_bits;
+        frontier_bits = next_bits;
+        next_bits = tmp;
+        depth++;
     }
-
-    free(frontier_set);
 }
 
-void bfs_hybrid(Graph graph, solution *sol)
+template <typename G>
+static void bfs_hybrid_impl(G* graph, solution *sol, Vertex root, bfs_workspace *workspace)
 {
     // For PP students:
     //
     // You will need to implement the "hybrid" BFS here as
     // described in the handout.
-    vertex_set list1;
-    vertex_set list2;
-    vertex_set_init(&list1, graph->num_nodes);
-    vertex_set_init(&list2, graph->num_nodes);
+    workspace = prepare_workspace(graph, workspace);
 
-    vertex_set *frontier = &list1;
-    vertex_set *new_frontier = &list2;
+    vertex_set *frontier = &workspace->lists[0];
+    vertex_set *new_frontier = &workspace->lists[1];
+    vertex_set_clear(frontier);
 
-    // initialize all nodes to NOT_VISITED
-    for (int i = 0; i < graph->num_nodes; i++)
-        sol->distances[i] = NOT_VISITED_MARKER;
-
-    // setup frontier with the root node
-    frontier->vertices[frontier->count++] = ROOT_NODE_ID;
-    sol->distances[ROOT_NODE_ID] = 0;
-
-    bool *frontier_set = (bool *)malloc(sizeof(bool) * graph->num_nodes);
-
-    int visited_nodes = 0;
-
-    while (frontier->count > 0) {
-
-        visited_nodes += frontier->count;
-
-#ifdef VERBOSE
-        double start_time = CycleTimer::currentSeconds();
-#endif
-
-        vertex_set_clear(new_frontier);
+    // Top-down steps work on the sparse frontier list, bottom-up steps on
+    // the dense frontier bitmap.  The frontier is converted only when the
+    // direction changes, and the visited bitmap, which top-down steps do
+    // not maintain, is rebuilt from the distances at the same time.
+    long words = bitmap_words(graph->num_nodes);
+    uint64_t *frontier_bits = workspace->frontier_bits;
+    uint64_t *next_bits = workspace->next_bits;
+    uint64_t *visited = workspace->visited;
+    bool dense = false;
 
-        int pred_bottom_up = (graph->num_nodes - visited_nodes);
+    init_solution(sol, graph->num_nodes, root);
 
-        if (frontier->count > HYBIRD_THRESHOLD || frontier->count > pred_bottom_up) {
-            memset(frontier_set, 0, sizeof(bool) * graph->num_nodes);
-            for (int f = 0; f < frontier->count; f++) {
-                frontier_set[frontier->vertices[f]] = true;
+    // setup frontier with the root node
+    frontier->vertices[frontier->count++] = root;
+
+    hybrid_params params = current_hybrid_params;
+    hybrid_log.clear();
+
+    int frontier_count = 1;
+    long frontier_edges = outgoing_size(graph, root);
+    long unexplored_edges = graph->num_edges;
+    int previous_count = 0;
+    int depth = 0;
+    int run = trace_enabled() ? trace_begin_run() : 0;
+
+    while (frontier_count > 0) {
+
+        double start_time = trace_now();
+        step_stats stats = { 0, 0, trace_busy_slots(omp_get_max_threads()) };
+
+        hybrid_level level;
+        level.frontier_vertices = frontier_count;
+        level.frontier_edges = frontier_edges;
+        level.unexplored_edges = unexplored_edges;
+        level.imbalance = 0;
+
+        // Bottom-up pays for edges out of unvisited vertices, top-down
+        // for edges out of the frontier; stay bottom-up while the
+        // frontier is still growing
+        bool was_dense = dense;
+        if (dense)
+            dense = frontier_count >= previous_count ||
+                    frontier_count > graph->num_nodes / params.beta;
+        else
+            dense = frontier_edges > unexplored_edges / params.alpha;
+        level.direction = dense ? BOTTOM_UP : TOP_DOWN;
+
+        unexplored_edges -= frontier_edges;
+
+        if (dense) {
+            if (!was_dense) {
+                sparse_to_dense(frontier, frontier_bits, words);
+                visited_from_distances(sol->distances, graph->num_nodes, visited);
             }
 
-            bottom_up_step(graph, frontier, new_frontier, frontier_set, sol->distances);
+            frontier_count = bottom_up_step(graph, frontier_bits, next_bits, visited,
+                                            sol->distances, sol->parents, depth, workspace, &frontier_edges, &stats);
+            level.imbalance = stats.imbalance;
+
+            uint64_t *tmp = frontier_bits;
+            frontier_bits = next_bits;
+            next_bits = tmp;
         } else {
-            top_down_step(graph, frontier, new_frontier, sol->distances);
+            if (was_dense)
+                dense_to_sparse(frontier_bits, words, frontier, workspace->block_counts);
+
+            vertex_set_clear(new_frontier);
+            top_down_step(graph, frontier, new_frontier, sol->distances, sol->parents, workspace,
+                          &frontier_edges, &stats);
+            level.imbalance = stats.imbalance;
+            frontier_count = new_frontier->count;
+
+            vertex_set *tmp = frontier;
+            frontier = new_frontier;
+            new_frontier = tmp;
         }
 
-#ifdef VERBOSE
-        double end_time = CycleTimer::currentSeconds();
-        printf("frontier=%-10d %.4f sec\n", frontier->count, end_time - start_time);
-#endif
+        level.seconds = trace_now() - start_time;
+        hybrid_log.push_back(level);
 
-        // swap pointers
-        vertex_set *tmp = frontier;
-        frontier = new_frontier;
-        new_frontier = tmp;
-    }
+        trace_record("bfs_hybrid", run, depth, level.frontier_vertices, stats.examined,
+                     dense ? "bottom-up" : "top-down", 0, start_time, level.seconds);
 
-    free(frontier_set);
+        previous_count = level.frontier_vertices;
+        depth++;
+    }
 }
+
+void bfs_top_down(Graph graph, solution *sol) { bfs_top_down_impl(graph, sol, ROOT_NODE_ID, NULL); }
+void bfs_bottom_up(Graph graph, solution *sol) { bfs_bottom_up_impl(graph, sol, ROOT_NODE_ID, NULL); }
+void bfs_hybrid(Graph graph, solution *sol) { bfs_hybrid_impl(graph, sol, ROOT_NODE_ID, NULL); }
+void bfs_top_down(Graph graph, solution *sol, Vertex root, bfs_workspace *workspace) { bfs_top_down_impl(graph, sol, root, workspace); }
+void bfs_bottom_up(Graph graph, solution *sol, Vertex root, bfs_workspace *workspace) { bfs_bottom_up_impl(graph, sol, root, workspace); }
+void bfs_hybrid(Graph graph, solution *sol, Vertex root, bfs_workspace *workspace) { bfs_hybrid_impl(graph, sol, root, workspace); }
+void bfs_top_down(Graph64 graph, solution *sol, Vertex root, bfs_workspace *workspace) { bfs_top_down_impl(graph, sol, root, workspace); }
+void bfs_bottom_up(Graph64 graph, solution *sol, Vertex root, bfs_workspace *workspace) { bfs_bottom_up_impl(graph, sol, root, workspace); }
+void bfs_hybrid(Graph64 graph, solution *sol, Vertex root, bfs_workspace *workspace) { bfs_hybrid_impl(graph, sol, root, workspace); }
+void bfs_top_down(CompressedGraph graph, solution *sol, Vertex root, bfs_workspace *workspace) { bfs_top_down_impl(graph, sol, root, workspace); }
+void bfs_bottom_up(CompressedGraph graph, solution *sol, Vertex root, bfs_workspace *workspace) { bfs_bottom_up_impl(graph, sol, root, workspace); }
+void bfs_hybrid(CompressedGraph graph, solution *sol, Vertex root, bfs_workspace *workspace) { bfs_hybrid_impl(graph, sol, root, workspace); }
+void bfs_top_down(CompressedGraph64 graph, solution *sol, Vertex root, bfs_workspace *workspace) { bfs_top_down_impl(graph, sol, root, workspace); }
+void bfs_bottom_up(CompressedGraph64 graph, solution *sol, Vertex root, bfs_workspace *workspace) { bfs_bottom_up_impl(graph, sol, root, workspace); }
+void bfs_hybrid(CompressedGraph64 graph, solution *sol, Vertex root, bfs_workspace *workspace) { bfs_hybrid_impl(graph, sol, root, workspace); }
@@ -4,10 +4,16 @@
 //#define DEBUG
 
 #include "common/graph.h"
+#include "common/compressed_graph.h"
+
+#include <stdint.h>
 
 struct solution
 {
   int *distances;
+  // if set, the BFS tree: each reached vertex's parent, the root's being
+  // the root itself, and -1 for vertices not reached
+  int *parents = NULL;
 };
 
 struct vertex_set {
@@ -19,9 +25,114 @@ struct vertex_set {
   int *vertices;
 };
 
+// Vertices a thread collects before appending them to the shared next
+// frontier
+#define FRONTIER_CHUNK 4096
+
+// Everything a search needs besides the graph and the result.  Buffers
+// only grow, so a workspace reused across searches takes allocation out
+// of the search entirely.  A workspace must not be shared by searches
+// running at the same time.
+struct bfs_workspace {
+  // vertices and threads the buffers are sized for
+  int num_nodes;
+  int num_threads;
+  // current and next frontier lists
+  vertex_set lists[2];
+  // frontier, next frontier and visited bitmaps
+  uint64_t *frontier_bits;
+  uint64_t *next_bits;
+  uint64_t *visited;
+  // FRONTIER_CHUNK vertices per thread
+  int *chunks;
+  // num_threads + 1 per-thread counts for frontier compaction
+  int *block_counts;
+  // num_nodes + 1 prefix sums of the frontier's out-degrees
+  long *degree_offsets;
+  // edges each thread scanned or checked in the last step
+  long *thread_edges;
+  // num_threads + 1 block sums for the frontier degree scan
+  long *scan_sums;
+};
+
+void bfs_workspace_init(bfs_workspace* workspace);
+// Grows the buffers to fit a graph and thread count
+void bfs_workspace_reserve(bfs_workspace* workspace, int num_nodes, int num_threads);
+void bfs_workspace_free(bfs_workspace* workspace);
+
+#define ROOT_NODE_ID 0
+
+// Direction switching in bfs_hybrid (Beamer et al.): a top-down search
+// switches to bottom-up once the edges out of the frontier exceed
+// 1/alpha of the edges not yet explored, and a bottom-up search switches
+// back once the frontier is shrinking and holds fewer than 1/beta of the
+// vertices.
+#define HYBRID_DEFAULT_ALPHA 15.0
+#define HYBRID_DEFAULT_BETA 18.0
+
+struct hybrid_params {
+  double alpha;
+  double beta;
+};
+
+void set_hybrid_params(const hybrid_params* params);
+hybrid_params get_hybrid_params();
+
+enum bfs_direction { TOP_DOWN, BOTTOM_UP };
+
+// What bfs_hybrid saw and decided at one level
+struct hybrid_level {
+  // size of the frontier expanded at this level
+  int frontier_vertices;
+  // edges out of that frontier
+  long frontier_edges;
+  // edges not yet explored before this level
+  long unexplored_edges;
+  bfs_direction direction;
+  double seconds;
+  // most edges one thread scanned over the mean per thread; 0 where not
+  // measured
+  double imbalance;
+};
+
+// Levels of the most recent bfs_hybrid call, returns how many there were
+int hybrid_level_log(const hybrid_level** levels);
+
+// How bottom-up steps scan a vertex's incoming neighbors for a frontier
+// vertex: one at a time, or 8 or 16 at a time with AVX2 or AVX-512
+// gathers.  The SIMD kernels apply to uncompressed graphs; compressed
+// lists are always scanned one at a time.  The default is the widest
+// kernel the CPU supports.
+enum bottom_up_kernel { BOTTOM_UP_SCALAR, BOTTOM_UP_AVX2, BOTTOM_UP_AVX512 };
+
+// Returns false, keeping the current kernel, if the CPU lacks it
+bool set_bottom_up_kernel(bottom_up_kernel kernel);
+bottom_up_kernel get_bottom_up_kernel();
+bool bottom_up_kernel_supported(bottom_up_kernel kernel);
+const char* bottom_up_kernel_name(bottom_up_kernel kernel);
+bool parse_bottom_up_kernel(const char* name, bottom_up_kernel* kernel);
 
 void bfs_top_down(Graph graph, solution* sol);
 void bfs_bottom_up(Graph graph, solution* sol);
 void bfs_hybrid(Graph graph, solution* sol);
 
+// Same searches, starting from an arbitrary root vertex.  Searches
+// without a workspace share one kept by the library.
+void bfs_top_down(Graph graph, solution* sol, Vertex root, bfs_workspace* workspace = NULL);
+void bfs_bottom_up(Graph graph, solution* sol, Vertex root, bfs_workspace* workspace = NULL);
+void bfs_hybrid(Graph graph, solution* sol, Vertex root, bfs_workspace* workspace = NULL);
+
+// Same searches over graphs with 64-bit edge offsets
+void bfs_top_down(Graph64 graph, solution* sol, Vertex root = ROOT_NODE_ID, bfs_workspace* workspace = NULL);
+void bfs_bottom_up(Graph64 graph, solution* sol, Vertex root = ROOT_NODE_ID, bfs_workspace* workspace = NULL);
+void bfs_hybrid(Graph64 graph, solution* sol, Vertex root = ROOT_NODE_ID, bfs_workspace* workspace = NULL);
+
+// Same searches over compressed graphs, decoding neighbor lists on the fly
+void bfs_top_down(CompressedGraph graph, solution* sol, Vertex root = ROOT_NODE_ID, bfs_workspace* workspace = NULL);
+void bfs_bottom_up(CompressedGraph graph, solution* sol, Vertex root = ROOT_NODE_ID, bfs_workspace* workspace = NULL);
+void bfs_hybrid(CompressedGraph graph, solution* sol, Vertex root = ROOT_NODE_ID, bfs_workspace* workspace = NULL);
+void bfs_top_down(CompressedGraph64 graph, solution* sol, Vertex root = ROOT_NODE_ID, bfs_workspace* workspace = NULL);
+void bfs_bottom_up(CompressedGraph64 graph, solution* sol, Vertex root = ROOT_NODE_ID, bfs_workspace* workspace = NULL);
+void bfs_hybrid(CompressedGraph64 graph, solution* sol, Vertex root = ROOT_NODE_ID, bfs_workspace* workspace = NULL);
+
 #endif
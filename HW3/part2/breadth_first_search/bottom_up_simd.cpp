@@ -0,0 +1,64 @@
+#include "bottom_up_simd.h"
+
+#include <immintrin.h>
+
+#include "common/bitmap.h"
+
+// Each function is compiled for its instruction set alone, so the rest
+// of the program runs on any x86-64 CPU.
+
+__attribute__((target("avx2")))
+long first_in_frontier_avx2(const Vertex* neighbors, long count, const uint64_t* frontier_bits)
+{
+    const int* halves = (const int*) frontier_bits;
+    const __m256i low_bits = _mm256_set1_epi32(31);
+    long k = 0;
+
+    for (; k + 8 <= count; k += 8) {
+        __m256i v = _mm256_loadu_si256((const __m256i*)(neighbors + k));
+        __m256i half = _mm256_i32gather_epi32(halves, _mm256_srli_epi32(v, 5), 4);
+        // move each neighbor's bit to the sign bit of its lane
+        __m256i shift = _mm256_sub_epi32(low_bits, _mm256_and_si256(v, low_bits));
+        int hits = _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_sllv_epi32(half, shift)));
+        if (hits)
+            return k + __builtin_ctz(hits);
+    }
+
+    for (; k < count; k++)
+        if (bitmap_test(frontier_bits, neighbors[k]))
+            return k;
+    return -1;
+}
+
+__attribute__((target("avx512f")))
+long first_in_frontier_avx512(const Vertex* neighbors, long count, const uint64_t* frontier_bits)
+{
+    const int* halves = (const int*) frontier_bits;
+    const __m512i low_bits = _mm512_set1_epi32(31);
+    const __m512i one = _mm512_set1_epi32(1);
+
+    for (long k = 0; k < count; k += 16) {
+        // the last block loads and gathers only the lanes in the list
+        __mmask16 lanes = count - k >= 16 ? (__mmask16) 0xffff : (__mmask16)((1u << (count - k)) - 1);
+        __m512i v = _mm512_maskz_loadu_epi32(lanes, neighbors + k);
+        __m512i half = _mm512_mask_i32gather_epi32(_mm512_setzero_si512(), lanes, _mm512_srli_epi32(v, 5),
+                                                   halves, 4);
+        __m512i bit = _mm512_sllv_epi32(one, _mm512_and_si512(v, low_bits));
+        __mmask16 hits = _mm512_mask_test_epi32_mask(lanes, half, bit);
+        if (hits)
+            return k + __builtin_ctz(hits);
+    }
+    return -1;
+}
+
+bool cpu_supports_avx2()
+{
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2");
+}
+
+bool cpu_supports_avx512()
+{
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx512f");
+}
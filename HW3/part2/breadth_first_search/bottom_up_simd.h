@@ -0,0 +1,20 @@
+#ifndef __BOTTOM_UP_SIMD_H__
+#define __BOTTOM_UP_SIMD_H__
+
+#include <stdint.h>
+
+#include "common/graph.h"
+
+// Vectorized scans for the bottom-up step.  Each returns the index of
+// the first of the count vertices in neighbors whose bit is set in
+// frontier_bits, or -1.  They gather the 32-bit half word holding each
+// neighbor's bit, 8 neighbors at a time with AVX2 and 16 with AVX-512,
+// and stop at the first block with a hit, so they find the same first
+// parent as a scalar scan.  Only call them if the CPU supports them.
+long first_in_frontier_avx2(const Vertex* neighbors, long count, const uint64_t* frontier_bits);
+long first_in_frontier_avx512(const Vertex* neighbors, long count, const uint64_t* frontier_bits);
+
+bool cpu_supports_avx2();
+bool cpu_supports_avx512();
+
+#endif
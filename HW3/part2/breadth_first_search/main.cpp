@@ -1,5 +1,6 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <omp.h>
 #include <string>
 #include <getopt.h>
@@ -10,7 +11,12 @@
 
 #include "common/CycleTimer.h"
 #include "common/graph.h"
+#include "common/memory_policy.h"
+#include "common/edge_partition.h"
+#include "common/trace.h"
 #include "bfs.h"
+#include "ms_bfs.h"
+#include "benchmark.h"
 
 #define USE_BINARY_GRAPH 1
 
@@ -18,51 +24,281 @@ void reference_bfs_bottom_up(Graph graph, solution* sol);
 void reference_bfs_top_down(Graph graph, solution* sol);
 void reference_bfs_hybrid(Graph graph, solution* sol);
 
-int main(int argc, char** argv) {
+// The reference library only understands the compact graph layout and
+// always starts from ROOT_NODE_ID.  Graphs with 64-bit edge offsets and
+// searches from other roots are checked against our own top-down search
+// instead.
+static void reference_bfs_top_down(Graph graph, solution* sol, Vertex root) {
+    if (root == ROOT_NODE_ID)
+        reference_bfs_top_down(graph, sol);
+    else
+        bfs_top_down(graph, sol, root);
+}
+static void reference_bfs_bottom_up(Graph graph, solution* sol, Vertex root) {
+    if (root == ROOT_NODE_ID)
+        reference_bfs_bottom_up(graph, sol);
+    else
+        bfs_top_down(graph, sol, root);
+}
+static void reference_bfs_hybrid(Graph graph, solution* sol, Vertex root) {
+    if (root == ROOT_NODE_ID)
+        reference_bfs_hybrid(graph, sol);
+    else
+        bfs_top_down(graph, sol, root);
+}
+static void reference_bfs_top_down(Graph64 graph, solution* sol, Vertex root) { bfs_top_down(graph, sol, root); }
+static void reference_bfs_bottom_up(Graph64 graph, solution* sol, Vertex root) { bfs_top_down(graph, sol, root); }
+static void reference_bfs_hybrid(Graph64 graph, solution* sol, Vertex root) { bfs_top_down(graph, sol, root); }
+
+static bool print_direction_log = false;
+static int multi_source_count = 0;
+static bool run_graph500 = false;
+static bool compare_kernels = false;
+static const char* trace_filename = NULL;
+static const char* chrome_trace_filename = NULL;
+
+// Timed runs per kernel in run_kernel_comparison, of which the best counts
+#define KERNEL_TRIALS 5
+
+// Prints the per-level direction choices of the last bfs_hybrid call
+static void print_hybrid_log() {
+    if (!print_direction_log)
+        return;
+
+    const hybrid_level* levels;
+    int count = hybrid_level_log(&levels);
+    printf("Hybrid levels:\n");
+    printf("  Level  Frontier    Frontier edges  Unexplored edges  Direction  Imbalance  Time\n");
+    for (int i = 0; i < count; i++) {
+        char imbalance[16] = "-";
+        if (levels[i].imbalance > 0)
+            snprintf(imbalance, sizeof(imbalance), "%.2f", levels[i].imbalance);
+        printf("  %5d  %-10d  %-14ld  %-16ld  %-9s  %-9s  %.4f sec\n", i,
+               levels[i].frontier_vertices, levels[i].frontier_edges, levels[i].unexplored_edges,
+               levels[i].direction == BOTTOM_UP ? "bottom-up" : "top-down", imbalance, levels[i].seconds);
+    }
+}
 
-    int  num_threads = -1;
-    std::string graph_filename;
+// Writes the levels traced during the run to the files given by -t and -T
+static void save_traces() {
+    if (trace_filename)
+        trace_save(trace_filename, false);
+    if (chrome_trace_filename)
+        trace_save(chrome_trace_filename, true);
+    if (trace_filename || chrome_trace_filename)
+        printf("Traced %zu levels\n", trace_steps().size());
+}
 
-    if (argc < 2)
-    {
-        std::cerr << "Usage: <path/to/graph/file> [num_threads]\n";
-        std::cerr << "  To run results for all thread counts: <path/to/graph/file>\n";
-        std::cerr << "  Run with a certain number of threads (no correctness run): <path/to/graph/file> <num_threads>\n";
-        exit(1);
+// Spreads num_sources roots with outgoing edges over the vertex range
+template <typename G>
+static void pick_sources(G* g, Vertex* sources, int num_sources) {
+    for (int i = 0; i < num_sources; i++) {
+        Vertex v = (Vertex)((long) i * g->num_nodes / num_sources);
+        for (int tries = 0; tries < g->num_nodes && outgoing_size(g, v) == 0; tries++)
+            v = (v + 1) % g->num_nodes;
+        sources[i] = v;
     }
+}
 
-    int thread_count = -1;
-    if (argc == 3)
-    {
-        thread_count = atoi(argv[2]);
-    }
+// Runs a batch of searches with ms_bfs, then one bfs_hybrid per source,
+// checks that the distances agree and compares the throughput.
+template <typename G>
+static void run_multi_source(G* g, int thread_count, int num_sources) {
+    long n = g->num_nodes;
+    Vertex* sources = (Vertex*)malloc(sizeof(Vertex) * num_sources);
+    pick_sources(g, sources, num_sources);
 
-    graph_filename = argv[1];
+    ms_bfs_result result;
+    result.distances = (int*)malloc(sizeof(int) * num_sources * n);
+    result.eccentricity = (int*)malloc(sizeof(int) * num_sources);
+    result.reached = (int*)malloc(sizeof(int) * num_sources);
+    result.closeness = (double*)malloc(sizeof(double) * num_sources);
 
-    Graph g;
+    solution sol;
+    sol.distances = (int*)policy_alloc(sizeof(int) * n);
 
-    printf("----------------------------------------------------------\n");
-    printf("Max system threads = %d\n", omp_get_max_threads());
     if (thread_count > 0)
-    {
-        thread_count = std::min(thread_count, omp_get_max_threads());
-        printf("Running with %d threads\n", thread_count);
+        omp_set_num_threads(thread_count);
+
+    printf("\n");
+    printf("Graph stats:\n");
+    printf("  Edges: %ld\n", (long) g->num_edges);
+    printf("  Nodes: %d\n", g->num_nodes);
+    printf("----------------------------------------------------------\n");
+    printf("Running %d searches with %d threads\n", num_sources, omp_get_max_threads());
+
+    // once for the aggregates alone, once with the distances to check
+    int* distances = result.distances;
+    result.distances = NULL;
+    double start = CycleTimer::currentSeconds();
+    ms_bfs(g, sources, num_sources, &result);
+    double aggregate_time = CycleTimer::currentSeconds() - start;
+
+    result.distances = distances;
+    start = CycleTimer::currentSeconds();
+    ms_bfs(g, sources, num_sources, &result);
+    double batch_time = CycleTimer::currentSeconds() - start;
+
+    bool check = true;
+    double single_time = 0;
+    for (int i = 0; i < num_sources; i++) {
+        start = CycleTimer::currentSeconds();
+        bfs_hybrid(g, &sol, sources[i]);
+        single_time += CycleTimer::currentSeconds() - start;
+
+        const int* batch_distances = result.distances + i * n;
+        for (long j = 0; j < n; j++) {
+            if (sol.distances[j] != batch_distances[j]) {
+                fprintf(stderr, "*** Results disagree for source %d at %ld: %d, %d\n",
+                        sources[i], j, batch_distances[j], sol.distances[j]);
+                check = false;
+                break;
+            }
+        }
+    }
+
+    double eccentricity = 0, closeness = 0, reached = 0;
+    for (int i = 0; i < num_sources; i++) {
+        eccentricity += result.eccentricity[i];
+        closeness += result.closeness[i];
+        reached += result.reached[i];
     }
+
+    printf("                       Time          Searches/sec  Speedup\n");
+    printf("  One by one (hybrid)  %8.3f sec  %10.1f\n", single_time, num_sources / single_time);
+    printf("  Batch, aggregates    %8.3f sec  %10.1f    %6.2fx\n",
+           aggregate_time, num_sources / aggregate_time, single_time / aggregate_time);
+    printf("  Batch, distances     %8.3f sec  %10.1f    %6.2fx\n",
+           batch_time, num_sources / batch_time, single_time / batch_time);
+    printf("  Mean reached %.1f, eccentricity %.2f, closeness %.4f\n",
+           reached / num_sources, eccentricity / num_sources, closeness / num_sources);
+    if (!check)
+        std::cout << "Multi-Source Search is not Correct" << std::endl;
     printf("----------------------------------------------------------\n");
 
-    printf("Loading graph...\n");
-    if (USE_BINARY_GRAPH) {
-      g = load_graph_binary(graph_filename.c_str());
-    } else {
-        g = load_graph(argv[1]);
-        printf("storing binary form of graph!\n");
-        store_graph_binary(graph_filename.append(".bin").c_str(), g);
-        free_graph(g);
-        exit(1);
+    free(sources);
+    free(result.distances);
+    free(result.eccentricity);
+    free(result.reached);
+    free(result.closeness);
+    policy_free(sol.distances);
+}
+
+// Times bottom-up and hybrid searches with each bottom-up kernel the CPU
+// supports and checks that every kernel finds the same distances and
+// parents as the scalar one.
+template <typename G>
+static void run_kernel_comparison(G* g, int thread_count) {
+    long n = g->num_nodes;
+    solution expected, sol;
+    expected.distances = (int*)policy_alloc(sizeof(int) * n);
+    expected.parents = (int*)policy_alloc(sizeof(int) * n);
+    sol.distances = (int*)policy_alloc(sizeof(int) * n);
+    sol.parents = (int*)policy_alloc(sizeof(int) * n);
+
+    if (thread_count > 0)
+        omp_set_num_threads(thread_count);
+
+    printf("\n");
+    printf("Graph stats:\n");
+    printf("  Edges: %ld\n", (long) g->num_edges);
+    printf("  Nodes: %d\n", g->num_nodes);
+    printf("----------------------------------------------------------\n");
+    printf("Bottom-up kernels with %d threads, best of %d:\n", omp_get_max_threads(), KERNEL_TRIALS);
+    printf("Kernel   Bottom Up         Hybrid            Check\n");
+
+    bottom_up_kernel saved = get_bottom_up_kernel();
+    double scalar_bottom = 0, scalar_hybrid = 0;
+
+    for (bottom_up_kernel kernel : { BOTTOM_UP_SCALAR, BOTTOM_UP_AVX2, BOTTOM_UP_AVX512 }) {
+        if (!set_bottom_up_kernel(kernel)) {
+            printf("%-8s (not supported by this CPU)\n", bottom_up_kernel_name(kernel));
+            continue;
+        }
+
+        double bottom_time = 1e30, hybrid_time = 1e30;
+        bool check = true;
+        for (int trial = 0; trial < KERNEL_TRIALS; trial++) {
+            double start = CycleTimer::currentSeconds();
+            bfs_bottom_up(g, &sol, ROOT_NODE_ID);
+            bottom_time = std::min(bottom_time, CycleTimer::currentSeconds() - start);
+
+            start = CycleTimer::currentSeconds();
+            bfs_hybrid(g, &sol, ROOT_NODE_ID);
+            hybrid_time = std::min(hybrid_time, CycleTimer::currentSeconds() - start);
+        }
+
+        if (kernel == BOTTOM_UP_SCALAR) {
+            bfs_bottom_up(g, &expected, ROOT_NODE_ID);
+            scalar_bottom = bottom_time;
+            scalar_hybrid = hybrid_time;
+        } else {
+            // the last trial's hybrid search against a scalar bottom-up one
+            for (long j = 0; j < n && check; j++) {
+                if (sol.distances[j] != expected.distances[j]) {
+                    fprintf(stderr, "*** Results disagree at %ld: %d, %d\n", j, sol.distances[j], expected.distances[j]);
+                    check = false;
+                }
+            }
+            bfs_bottom_up(g, &sol, ROOT_NODE_ID);
+            for (long j = 0; j < n && check; j++) {
+                if (sol.distances[j] != expected.distances[j] || sol.parents[j] != expected.parents[j]) {
+                    fprintf(stderr, "*** Parents disagree at %ld: %d, %d\n", j, sol.parents[j], expected.parents[j]);
+                    check = false;
+                }
+            }
+        }
+
+        printf("%-8s %.4f (%.2fx)   %.4f (%.2fx)   %s\n", bottom_up_kernel_name(kernel),
+               bottom_time, scalar_bottom / bottom_time, hybrid_time, scalar_hybrid / hybrid_time,
+               check ? "ok" : "WRONG");
     }
+
+    set_bottom_up_kernel(saved);
+    policy_free(expected.distances);
+    policy_free(expected.parents);
+    policy_free(sol.distances);
+    policy_free(sol.parents);
+}
+
+// When the graph was relabeled (see 'graphTools reorder'), rewrites the
+// distances of sol from new to original vertex ids.
+static void to_original_ids(solution* sol, int num_nodes, const Vertex* new_ids, int* scratch) {
+    if (new_ids == NULL)
+        return;
+    unpermute(sol->distances, scratch, new_ids, num_nodes);
+    memcpy(sol->distances, scratch, sizeof(int) * num_nodes);
+}
+
+// Runs the student code on g and the reference code on ref_g, which is
+// the same graph in uncompressed form.  If new_ids is set the graph was
+// relabeled: the search starts from the new id of ROOT_NODE_ID and
+// results are mapped back to original ids before being checked.
+template <typename G, typename R>
+static void run(G* g, R* ref_g, int thread_count, const Vertex* new_ids) {
+
+    if (run_graph500) {
+        graph500_benchmark(g, thread_count);
+        print_memory_policy_report(stdout);
+        return;
+    }
+
+    if (multi_source_count > 0) {
+        run_multi_source(g, thread_count, multi_source_count);
+        return;
+    }
+
+    if (compare_kernels) {
+        run_kernel_comparison(g, thread_count);
+        return;
+    }
+
+    Vertex root = new_ids ? new_ids[ROOT_NODE_ID] : ROOT_NODE_ID;
+    int* scratch = new_ids ? (int*)malloc(sizeof(int) * g->num_nodes) : NULL;
+
     printf("\n");
     printf("Graph stats:\n");
-    printf("  Edges: %d\n", g->num_edges);
+    printf("  Edges: %ld\n", (long) g->num_edges);
     printf("  Nodes: %d\n", g->num_nodes);
 
     //If we want to run on all threads
@@ -82,15 +318,15 @@ int main(int argc, char** argv) {
         int n_usage = num_threads.size();
 
         solution sol1;
-        sol1.distances = (int*)malloc(sizeof(int) * g->num_nodes);
+        sol1.distances = (int*)policy_alloc(sizeof(int) * g->num_nodes);
         solution sol2;
-        sol2.distances = (int*)malloc(sizeof(int) * g->num_nodes);
+        sol2.distances = (int*)policy_alloc(sizeof(int) * g->num_nodes);
         solution sol3;
-        sol3.distances = (int*)malloc(sizeof(int) * g->num_nodes);
+        sol3.distances = (int*)policy_alloc(sizeof(int) * g->num_nodes);
 
         //Solution sphere
         solution sol4;
-        sol4.distances = (int*)malloc(sizeof(int) * g->num_nodes);
+        sol4.distances = (int*)policy_alloc(sizeof(int) * g->num_nodes);
 
         double hybrid_base, top_base, bottom_base;
         double hybrid_time, top_time, bottom_time;
@@ -119,14 +355,16 @@ int main(int argc, char** argv) {
 
             //Run implementations
             start = CycleTimer::currentSeconds();
-            bfs_top_down(g, &sol1);
+            bfs_top_down(g, &sol1, root);
             top_time = CycleTimer::currentSeconds() - start;
 
             //Run reference implementation
             start = CycleTimer::currentSeconds();
-            reference_bfs_top_down(g, &sol4);
+            reference_bfs_top_down(ref_g, &sol4, root);
             ref_top_time = CycleTimer::currentSeconds() - start;
 
+            to_original_ids(&sol1, g->num_nodes, new_ids, scratch);
+            to_original_ids(&sol4, g->num_nodes, new_ids, scratch);
             std::cout << "Testing Correctness of Top Down\n";
             for (int j=0; j<g->num_nodes; j++) {
                 if (sol1.distances[j] != sol4.distances[j]) {
@@ -138,14 +376,16 @@ int main(int argc, char** argv) {
 
             //Run implementations
             start = CycleTimer::currentSeconds();
-            bfs_bottom_up(g, &sol2);
+            bfs_bottom_up(g, &sol2, root);
             bottom_time = CycleTimer::currentSeconds() - start;
 
             //Run reference implementation
             start = CycleTimer::currentSeconds();
-            reference_bfs_bottom_up(g, &sol4);
+            reference_bfs_bottom_up(ref_g, &sol4, root);
             ref_bottom_time = CycleTimer::currentSeconds() - start;
 
+            to_original_ids(&sol2, g->num_nodes, new_ids, scratch);
+            to_original_ids(&sol4, g->num_nodes, new_ids, scratch);
             std::cout << "Testing Correctness of Bottom Up\n";
             for (int j=0; j<g->num_nodes; j++) {
                 if (sol2.distances[j] != sol4.distances[j]) {
@@ -156,14 +396,17 @@ int main(int argc, char** argv) {
             }
 
             start = CycleTimer::currentSeconds();
-            bfs_hybrid(g, &sol3);
+            bfs_hybrid(g, &sol3, root);
             hybrid_time = CycleTimer::currentSeconds() - start;
+            print_hybrid_log();
 
             //Run reference implementation
             start = CycleTimer::currentSeconds();
-            reference_bfs_hybrid(g, &sol4);
+            reference_bfs_hybrid(ref_g, &sol4, root);
             ref_hybrid_time = CycleTimer::currentSeconds() - start;
 
+            to_original_ids(&sol3, g->num_nodes, new_ids, scratch);
+            to_original_ids(&sol4, g->num_nodes, new_ids, scratch);
             std::cout << "Testing Correctness of Hybrid\n";
             for (int j=0; j<g->num_nodes; j++) {
                 if (sol3.distances[j] != sol4.distances[j]) {
@@ -223,15 +466,15 @@ int main(int argc, char** argv) {
     {
         bool tds_check = true, bus_check = true, hs_check = true;
         solution sol1;
-        sol1.distances = (int*)malloc(sizeof(int) * g->num_nodes);
+        sol1.distances = (int*)policy_alloc(sizeof(int) * g->num_nodes);
         solution sol2;
-        sol2.distances = (int*)malloc(sizeof(int) * g->num_nodes);
+        sol2.distances = (int*)policy_alloc(sizeof(int) * g->num_nodes);
         solution sol3;
-        sol3.distances = (int*)malloc(sizeof(int) * g->num_nodes);
+        sol3.distances = (int*)policy_alloc(sizeof(int) * g->num_nodes);
 
         //Solution sphere
         solution sol4;
-        sol4.distances = (int*)malloc(sizeof(int) * g->num_nodes);
+        sol4.distances = (int*)policy_alloc(sizeof(int) * g->num_nodes);
 
         double hybrid_time, top_time, bottom_time;
         double ref_hybrid_time, ref_top_time, ref_bottom_time;
@@ -251,14 +494,16 @@ int main(int argc, char** argv) {
 
         //Run implementations
         start = CycleTimer::currentSeconds();
-        bfs_top_down(g, &sol1);
+        bfs_top_down(g, &sol1, root);
         top_time = CycleTimer::currentSeconds() - start;
 
         //Run reference implementation
         start = CycleTimer::currentSeconds();
-        reference_bfs_top_down(g, &sol4);
+        reference_bfs_top_down(ref_g, &sol4, root);
         ref_top_time = CycleTimer::currentSeconds() - start;
 
+        to_original_ids(&sol1, g->num_nodes, new_ids, scratch);
+        to_original_ids(&sol4, g->num_nodes, new_ids, scratch);
         std::cout << "Testing Correctness of Top Down\n";
         for (int j=0; j<g->num_nodes; j++) {
             if (sol1.distances[j] != sol4.distances[j]) {
@@ -271,14 +516,16 @@ int main(int argc, char** argv) {
 
         //Run implementations
         start = CycleTimer::currentSeconds();
-        bfs_bottom_up(g, &sol2);
+        bfs_bottom_up(g, &sol2, root);
         bottom_time = CycleTimer::currentSeconds() - start;
 
         //Run reference implementation
         start = CycleTimer::currentSeconds();
-        reference_bfs_bottom_up(g, &sol4);
+        reference_bfs_bottom_up(ref_g, &sol4, root);
         ref_bottom_time = CycleTimer::currentSeconds() - start;
 
+        to_original_ids(&sol2, g->num_nodes, new_ids, scratch);
+        to_original_ids(&sol4, g->num_nodes, new_ids, scratch);
         std::cout << "Testing Correctness of Bottom Up\n";
         for (int j=0; j<g->num_nodes; j++) {
             if (sol2.distances[j] != sol4.distances[j]) {
@@ -290,14 +537,17 @@ int main(int argc, char** argv) {
 
 
         start = CycleTimer::currentSeconds();
-        bfs_hybrid(g, &sol3);
+        bfs_hybrid(g, &sol3, root);
         hybrid_time = CycleTimer::currentSeconds() - start;
+        print_hybrid_log();
 
         //Run reference implementation
         start = CycleTimer::currentSeconds();
-        reference_bfs_hybrid(g, &sol4);
+        reference_bfs_hybrid(ref_g, &sol4, root);
         ref_hybrid_time = CycleTimer::currentSeconds() - start;
 
+        to_original_ids(&sol3, g->num_nodes, new_ids, scratch);
+        to_original_ids(&sol4, g->num_nodes, new_ids, scratch);
         std::cout << "Testing Correctness of Hybrid\n";
         for (int j=0; j<g->num_nodes; j++) {
             if (sol3.distances[j] != sol4.distances[j]) {
@@ -333,7 +583,194 @@ int main(int argc, char** argv) {
         printf("----------------------------------------------------------\n");
     }
 
+    print_memory_policy_report(stdout);
+    printf("----------------------------------------------------------\n");
+
+    free(scratch);
+}
+
+// Runs on the loaded graph, or on its compressed form if requested
+template <typename G>
+static void run_layout(G* g, bool compressed, int thread_count, const Vertex* new_ids) {
+    if (!compressed) {
+        run(g, g, thread_count, new_ids);
+        return;
+    }
+
+    printf("Compressing graph...\n");
+    auto cg = compress_graph(g);
+    printf("  Adjacency: %.1f MB -> %.1f MB\n",
+           2.0 * sizeof(Vertex) * g->num_edges / (1 << 20),
+           (double) compressed_adjacency_bytes(cg) / (1 << 20));
+    run(cg, g, thread_count, new_ids);
+    free_graph(cg);
+}
+
+template <typename G>
+static void check_permutation(G* g, const char* perm_filename, Vertex perm_nodes) {
+    if (perm_filename && perm_nodes != g->num_nodes) {
+        fprintf(stderr, "Permutation %s has %d vertices, graph has %d\n",
+                perm_filename, perm_nodes, g->num_nodes);
+        exit(1);
+    }
+}
+
+int main(int argc, char** argv) {
+
+    int  num_threads = -1;
+    std::string graph_filename;
+
+    bool compressed = false;
+    const char* perm_filename = NULL;
+    memory_policy policy = get_memory_policy();
+    hybrid_params params = get_hybrid_params();
+    bottom_up_kernel kernel = get_bottom_up_kernel();
+    bool balance_edges = true;
+    int opt;
+    while ((opt = getopt(argc, argv, "cp:m:a:b:k:Kels:Gt:T:")) != -1) {
+        switch (opt) {
+        case 'c':
+            compressed = true;
+            break;
+        case 'p':
+            perm_filename = optarg;
+            break;
+        case 'm':
+            if (!parse_memory_policy(optarg, &policy)) {
+                std::cerr << "Unknown memory policy: " << optarg << "\n";
+                argc = 0;
+            }
+            break;
+        case 'a':
+            params.alpha = atof(optarg);
+            break;
+        case 'b':
+            params.beta = atof(optarg);
+            break;
+        case 'k':
+            if (!parse_bottom_up_kernel(optarg, &kernel)) {
+                std::cerr << "Unknown bottom-up kernel: " << optarg << "\n";
+                argc = 0;
+            } else if (!bottom_up_kernel_supported(kernel)) {
+                std::cerr << "This CPU does not support the " << optarg << " kernel\n";
+                argc = 0;
+            }
+            break;
+        case 'K':
+            compare_kernels = true;
+            break;
+        case 'e':
+            balance_edges = false;
+            break;
+        case 'l':
+            print_direction_log = true;
+            break;
+        case 'G':
+            run_graph500 = true;
+            break;
+        case 't':
+            trace_filename = optarg;
+            break;
+        case 'T':
+            chrome_trace_filename = optarg;
+            break;
+        case 's':
+            multi_source_count = atoi(optarg);
+            if (multi_source_count <= 0) {
+                std::cerr << "Number of sources must be positive\n";
+                argc = 0;
+            }
+            break;
+        default:
+            argc = 0;
+        }
+    }
+
+    if (params.alpha <= 0 || params.beta <= 0) {
+        std::cerr << "Hybrid alpha and beta must be positive\n";
+        argc = 0;
+    }
+
+    if (argc - optind < 1)
+    {
+        std::cerr << "Usage: [-c] [-p perm_file] [-m memory_policy] [-a alpha] [-b beta] [-k kernel] [-K] [-e] [-l] [-s num_sources] [-G] [-t trace] [-T trace] <path/to/graph/file> [num_threads]\n";
+        std::cerr << "  To run results for all thread counts: <path/to/graph/file>\n";
+        std::cerr << "  Run with a certain number of threads (no correctness run): <path/to/graph/file> <num_threads>\n";
+        std::cerr << "  -c: run on the compressed (varint) adjacency layout\n";
+        std::cerr << "  -p: the graph was relabeled by 'graphTools reorder' with this permutation\n";
+        std::cerr << "  -m: placement and page size of graph and result arrays, e.g. interleave,thp\n";
+        std::cerr << "      placement: default, interleave, local (parallel first touch)\n";
+        std::cerr << "      pages:     small, thp (transparent 2MB), huge (explicit 2MB)\n";
+        std::cerr << "  -a: hybrid goes bottom-up when frontier edges > unexplored edges / alpha (default 15)\n";
+        std::cerr << "  -b: hybrid goes top-down when the frontier shrinks below vertices / beta (default 18)\n";
+        std::cerr << "  -k: bottom-up neighbor scan: scalar, avx2 or avx512 (default: widest supported)\n";
+        std::cerr << "  -K: time bottom-up and hybrid searches with each supported kernel\n";
+        std::cerr << "  -e: split bottom-up steps into equal vertex counts per thread instead of\n";
+        std::cerr << "      ranges of equal incoming edge counts, to compare the imbalance with -l\n";
+        std::cerr << "  -l: print the direction the hybrid search chose at each level\n";
+        std::cerr << "  -s: run num_sources searches as one multi-source batch and check them\n";
+        std::cerr << "      against one hybrid search per source\n";
+        std::cerr << "  -G: Graph500 benchmark: 64 random roots, validated BFS trees, TEPS statistics\n";
+        std::cerr << "  -t: write every level of every search to this file, as CSV if it ends in\n";
+        std::cerr << "      .csv and as JSON otherwise\n";
+        std::cerr << "  -T: write the levels as a Chrome trace (chrome://tracing, ui.perfetto.dev)\n";
+        exit(1);
+    }
+
+    int thread_count = -1;
+    if (argc - optind == 2)
+    {
+        thread_count = atoi(argv[optind + 1]);
+    }
+
+    graph_filename = argv[optind];
+
+    Graph g;
+
+    printf("----------------------------------------------------------\n");
+    printf("Max system threads = %d\n", omp_get_max_threads());
+    if (thread_count > 0)
+    {
+        thread_count = std::min(thread_count, omp_get_max_threads());
+        printf("Running with %d threads\n", thread_count);
+    }
+    printf("----------------------------------------------------------\n");
+
+    Vertex* new_ids = NULL;
+    Vertex perm_nodes = 0;
+    if (perm_filename)
+        new_ids = load_permutation(perm_filename, &perm_nodes);
+
+    set_memory_policy(&policy);
+    set_hybrid_params(&params);
+    set_bottom_up_kernel(kernel);
+    set_edge_balancing(balance_edges);
+    trace_enable(trace_filename || chrome_trace_filename);
+
+    printf("Loading graph...\n");
+    if (USE_BINARY_GRAPH && graph_file_needs_wide_offsets(graph_filename.c_str())) {
+        Graph64 g64 = load_graph_binary64(graph_filename.c_str());
+        check_permutation(g64, perm_filename, perm_nodes);
+        run_layout(g64, compressed, thread_count, new_ids);
+        free_graph(g64);
+        free(new_ids);
+        save_traces();
+        return 0;
+    } else if (USE_BINARY_GRAPH) {
+      g = load_graph_binary(graph_filename.c_str());
+    } else {
+        g = load_graph(graph_filename.c_str());
+        printf("storing binary form of graph!\n");
+        store_graph_binary(graph_filename.append(".bin").c_str(), g);
+        free_graph(g);
+        exit(1);
+    }
+    check_permutation(g, perm_filename, perm_nodes);
+    run_layout(g, compressed, thread_count, new_ids);
+
     free_graph(g);
+    free(new_ids);
+    save_traces();
 
     return 0;
 }
@@ -0,0 +1,329 @@
+#include "ms_bfs.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <omp.h>
+
+#include "bfs.h"
+
+#define NOT_VISITED_MARKER -1
+
+// A pulling vertex can stop only once every frontier lane has reached
+// it, not at the first parent as in bfs_hybrid, so pulling pays off
+// later than there: when the frontier's outgoing edges exceed 1/alpha of
+// all edges with this alpha.
+#define MS_BFS_PULL_ALPHA 4.0
+
+// One bit per source of a pass, W words per vertex
+template <int W>
+struct lane_set
+{
+    uint64_t word[W];
+};
+
+template <int W>
+static inline bool lanes_empty(const lane_set<W>& a)
+{
+    uint64_t any = 0;
+    for (int j = 0; j < W; j++)
+        any |= a.word[j];
+    return any == 0;
+}
+
+// Whether a has every lane of active set
+template <int W>
+static inline bool lanes_cover(const lane_set<W>& a, const lane_set<W>& active)
+{
+    uint64_t missing = 0;
+    for (int j = 0; j < W; j++)
+        missing |= active.word[j] & ~a.word[j];
+    return missing == 0;
+}
+
+// Counts the lanes of fresh, which reached v at this level, and writes
+// their distances
+template <int W>
+static inline void record_lanes(const lane_set<W>& fresh, Vertex v, int level, long *lane_counts,
+                                int *distances, long num_nodes)
+{
+    for (int j = 0; j < W; j++) {
+        uint64_t bits = fresh.word[j];
+        while (bits) {
+            int lane = j * 64 + __builtin_ctzll(bits);
+            bits &= bits - 1;
+            lane_counts[lane]++;
+            if (distances)
+                distances[lane * num_nodes + v] = level;
+        }
+    }
+}
+
+// Thread-local buffer of vertices bound for a shared list
+struct vertex_chunk
+{
+    Vertex vertices[FRONTIER_CHUNK];
+    int count;
+};
+
+static inline void chunk_flush(vertex_chunk *chunk, Vertex *list, int *list_count)
+{
+    int index = __sync_fetch_and_add(list_count, chunk->count);
+    memcpy(list + index, chunk->vertices, sizeof(Vertex) * chunk->count);
+    chunk->count = 0;
+}
+
+static inline void chunk_push(vertex_chunk *chunk, Vertex v, Vertex *list, int *list_count)
+{
+    chunk->vertices[chunk->count++] = v;
+    if (chunk->count == FRONTIER_CHUNK)
+        chunk_flush(chunk, list, list_count);
+}
+
+// Runs the searches from count <= 64 * W sources together.  Each level
+// is either pushed along the outgoing edges of the frontier list, OR-ing
+// lanes into neighbors with atomics, or pulled by every vertex not yet
+// reached on all frontier lanes from its incoming neighbors, which needs
+// no atomics and stops scanning once no further lane can arrive.
+template <int W, typename G>
+static void ms_bfs_pass(G* g, const Vertex* sources, int count, int *distances,
+                        int *eccentricity, int *reached, double *closeness)
+{
+    long n = g->num_nodes;
+    lane_set<W> *seen = (lane_set<W> *)malloc(sizeof(lane_set<W>) * n);
+    lane_set<W> *visit = (lane_set<W> *)malloc(sizeof(lane_set<W>) * n);
+    lane_set<W> *next = (lane_set<W> *)malloc(sizeof(lane_set<W>) * n);
+
+    // vertices with a lane in visit, and vertices a push put lanes in
+    // next.  With several words per vertex, claimed keeps a vertex from
+    // being listed once per word.
+    Vertex *frontier = (Vertex *)malloc(sizeof(Vertex) * n);
+    Vertex *touched = (Vertex *)malloc(sizeof(Vertex) * n);
+    unsigned char *claimed = W > 1 ? (unsigned char *)calloc(n, 1) : NULL;
+    int frontier_count = 0;
+    int touched_count = 0;
+
+    #pragma omp parallel for schedule(static)
+    for (long v = 0; v < n; v++) {
+        seen[v] = lane_set<W>();
+        visit[v] = lane_set<W>();
+        next[v] = lane_set<W>();
+    }
+
+    // lanes with a vertex on the current frontier; only these can reach
+    // new vertices
+    lane_set<W> active = lane_set<W>();
+    lane_set<W> all_lanes = lane_set<W>();
+    long *distance_sums = (long *)calloc(count, sizeof(long));
+    long frontier_edges = 0;
+    for (int i = 0; i < count; i++) {
+        Vertex s = sources[i];
+        uint64_t bit = (uint64_t) 1 << (i % 64);
+        if (lanes_empty(visit[s])) {
+            frontier[frontier_count++] = s;
+            frontier_edges += outgoing_size(g, s);
+        }
+        active.word[i / 64] |= bit;
+        all_lanes.word[i / 64] |= bit;
+        seen[s].word[i / 64] |= bit;
+        visit[s].word[i / 64] |= bit;
+        if (distances)
+            distances[i * n + s] = 0;
+        eccentricity[i] = 0;
+        reached[i] = 1;
+    }
+
+    int num_threads = omp_get_max_threads();
+    long *lane_counts = (long *)calloc((long) num_threads * 64 * W, sizeof(long));
+    bool next_clear = true;
+
+    for (int level = 1; frontier_count > 0; level++) {
+        long new_edges = 0;
+        lane_set<W> new_active = lane_set<W>();
+
+        if (frontier_edges > g->num_edges / MS_BFS_PULL_ALPHA) {
+            frontier_count = 0;
+
+            #pragma omp parallel num_threads(num_threads) reduction(+:new_edges)
+            {
+                long *counts = lane_counts + (long) omp_get_thread_num() * 64 * W;
+                lane_set<W> thread_active = lane_set<W>();
+                vertex_chunk chunk;
+                chunk.count = 0;
+
+                #pragma omp for nowait schedule(dynamic, 1024)
+                for (long v = 0; v < n; v++) {
+                    lane_set<W> s = seen[v];
+                    lane_set<W> found = lane_set<W>();
+
+                    if (!lanes_cover(s, active)) {
+                        for (Vertex u : incoming_neighbors(g, v)) {
+                            for (int j = 0; j < W; j++) {
+                                found.word[j] |= visit[u].word[j];
+                                s.word[j] |= visit[u].word[j];
+                            }
+                            if (lanes_cover(s, active))
+                                break;
+                        }
+                    }
+
+                    for (int j = 0; j < W; j++)
+                        found.word[j] &= ~seen[v].word[j];
+                    next[v] = found;
+
+                    if (!lanes_empty(found)) {
+                        seen[v] = s;
+                        for (int j = 0; j < W; j++)
+                            thread_active.word[j] |= found.word[j];
+                        record_lanes(found, v, level, counts, distances, n);
+                        chunk_push(&chunk, v, frontier, &frontier_count);
+                        new_edges += outgoing_size(g, v);
+                    }
+                }
+
+                chunk_flush(&chunk, frontier, &frontier_count);
+                for (int j = 0; j < W; j++)
+                    __sync_fetch_and_or(&new_active.word[j], thread_active.word[j]);
+            }
+
+            lane_set<W> *tmp = visit;
+            visit = next;
+            next = tmp;
+            next_clear = false;
+        } else {
+            if (!next_clear) {
+                #pragma omp parallel for schedule(static)
+                for (long v = 0; v < n; v++)
+                    next[v] = lane_set<W>();
+            }
+
+            touched_count = 0;
+
+            #pragma omp parallel num_threads(num_threads)
+            {
+                vertex_chunk chunk;
+                chunk.count = 0;
+
+                #pragma omp for nowait schedule(dynamic, 64)
+                for (int i = 0; i < frontier_count; i++) {
+                    Vertex v = frontier[i];
+                    lane_set<W> lanes = visit[v];
+
+                    for (Vertex u : outgoing_neighbors(g, v)) {
+                        for (int j = 0; j < W; j++) {
+                            uint64_t bits = lanes.word[j] & ~seen[u].word[j] & ~next[u].word[j];
+                            if (bits && __sync_fetch_and_or(&next[u].word[j], bits) == 0 &&
+                                (W == 1 || __sync_bool_compare_and_swap(&claimed[u], 0, 1)))
+                                chunk_push(&chunk, u, touched, &touched_count);
+                        }
+                    }
+                }
+
+                chunk_flush(&chunk, touched, &touched_count);
+            }
+
+            // seen is only read while pushing, so the lanes that reached
+            // each vertex are folded into it afterwards
+            #pragma omp parallel for schedule(static)
+            for (int i = 0; i < frontier_count; i++)
+                visit[frontier[i]] = lane_set<W>();
+
+            frontier_count = 0;
+
+            #pragma omp parallel num_threads(num_threads) reduction(+:new_edges)
+            {
+                long *counts = lane_counts + (long) omp_get_thread_num() * 64 * W;
+                lane_set<W> thread_active = lane_set<W>();
+                vertex_chunk chunk;
+                chunk.count = 0;
+
+                #pragma omp for nowait schedule(static)
+                for (int i = 0; i < touched_count; i++) {
+                    Vertex v = touched[i];
+                    lane_set<W> found = next[v];
+                    next[v] = lane_set<W>();
+                    if (W > 1)
+                        claimed[v] = 0;
+
+                    visit[v] = found;
+                    for (int j = 0; j < W; j++) {
+                        seen[v].word[j] |= found.word[j];
+                        thread_active.word[j] |= found.word[j];
+                    }
+                    record_lanes(found, v, level, counts, distances, n);
+                    chunk_push(&chunk, v, frontier, &frontier_count);
+                    new_edges += outgoing_size(g, v);
+                }
+
+                chunk_flush(&chunk, frontier, &frontier_count);
+                for (int j = 0; j < W; j++)
+                    __sync_fetch_and_or(&new_active.word[j], thread_active.word[j]);
+            }
+            next_clear = true;
+        }
+
+        for (int i = 0; i < count; i++) {
+            long lane_total = 0;
+            for (int t = 0; t < num_threads; t++) {
+                lane_total += lane_counts[(long) t * 64 * W + i];
+                lane_counts[(long) t * 64 * W + i] = 0;
+            }
+            if (lane_total) {
+                reached[i] += lane_total;
+                distance_sums[i] += lane_total * level;
+                eccentricity[i] = level;
+            }
+        }
+
+        active = new_active;
+        frontier_edges = new_edges;
+    }
+
+    // every distance is written once: levels as lanes reach vertices,
+    // and the marker for lanes that never did
+    if (distances) {
+        #pragma omp parallel for schedule(dynamic, 1024)
+        for (long v = 0; v < n; v++) {
+            for (int j = 0; j < W; j++) {
+                uint64_t bits = all_lanes.word[j] & ~seen[v].word[j];
+                while (bits) {
+                    int lane = j * 64 + __builtin_ctzll(bits);
+                    bits &= bits - 1;
+                    distances[lane * n + v] = NOT_VISITED_MARKER;
+                }
+            }
+        }
+    }
+
+    for (int i = 0; i < count; i++)
+        closeness[i] = distance_sums[i] ? (double)(reached[i] - 1) / distance_sums[i] : 0.0;
+
+    free(seen);
+    free(visit);
+    free(next);
+    free(frontier);
+    free(touched);
+    free(claimed);
+    free(distance_sums);
+    free(lane_counts);
+}
+
+template <typename G>
+static void ms_bfs_impl(G* g, const Vertex* sources, int num_sources, ms_bfs_result* result)
+{
+    long n = g->num_nodes;
+
+    for (int done = 0; done < num_sources; done += MS_BFS_LANES) {
+        int count = num_sources - done < MS_BFS_LANES ? num_sources - done : MS_BFS_LANES;
+        int *distances = result->distances ? result->distances + done * n : NULL;
+
+        ms_bfs_pass<MS_BFS_LANES / 64>(g, sources + done, count, distances, result->eccentricity + done,
+                                       result->reached + done, result->closeness + done);
+    }
+}
+
+void ms_bfs(Graph graph, const Vertex* sources, int num_sources, ms_bfs_result* result) { ms_bfs_impl(graph, sources, num_sources, result); }
+void ms_bfs(Graph64 graph, const Vertex* sources, int num_sources, ms_bfs_result* result) { ms_bfs_impl(graph, sources, num_sources, result); }
+void ms_bfs(CompressedGraph graph, const Vertex* sources, int num_sources, ms_bfs_result* result) { ms_bfs_impl(graph, sources, num_sources, result); }
+void ms_bfs(CompressedGraph64 graph, const Vertex* sources, int num_sources, ms_bfs_result* result) { ms_bfs_impl(graph, sources, num_sources, result); }
@@ -0,0 +1,38 @@
+#ifndef __MS_BFS_H__
+#define __MS_BFS_H__
+
+#include "common/graph.h"
+#include "common/compressed_graph.h"
+
+// Multi-source BFS (Then et al., "The More the Merrier"): every vertex
+// keeps a bitset with one lane per source, so one scan of an edge
+// advances all the searches that cross it at the same level.  Sources
+// are processed in passes of MS_BFS_LANES, a multiple of 64.  Wider
+// passes share more edge scans but read more bits per edge; 64 was
+// fastest on a scale-20 RMAT graph.
+#ifndef MS_BFS_LANES
+#define MS_BFS_LANES 64
+#endif
+
+struct ms_bfs_result
+{
+  // num_sources arrays of num_nodes distances, source i's at
+  // distances + i * num_nodes, or NULL to compute only the aggregates
+  int *distances;
+  // per source: largest distance to a reachable vertex
+  int *eccentricity;
+  // per source: vertices reachable, the source included
+  int *reached;
+  // per source: (reached - 1) / sum of distances to reachable vertices,
+  // or 0 if nothing else is reachable
+  double *closeness;
+};
+
+// Runs a BFS from each of the num_sources sources.  Sources may repeat.
+// All arrays of result are allocated by the caller.
+void ms_bfs(Graph graph, const Vertex* sources, int num_sources, ms_bfs_result* result);
+void ms_bfs(Graph64 graph, const Vertex* sources, int num_sources, ms_bfs_result* result);
+void ms_bfs(CompressedGraph graph, const Vertex* sources, int num_sources, ms_bfs_result* result);
+void ms_bfs(CompressedGraph64 graph, const Vertex* sources, int num_sources, ms_bfs_result* result);
+
+#endif
@@ -0,0 +1,41 @@
+#ifndef __BITMAP_H__
+#define __BITMAP_H__
+
+#include <stdint.h>
+
+// Bit-packed vertex sets, one bit per vertex, 64 vertices per word.
+// Bits past the last vertex in the final word are kept clear.
+
+#define BITMAP_WORD_BITS 64
+
+static inline long bitmap_words(long num_bits)
+{
+    return (num_bits + BITMAP_WORD_BITS - 1) / BITMAP_WORD_BITS;
+}
+
+static inline bool bitmap_test(const uint64_t* bitmap, long i)
+{
+    return (bitmap[i / BITMAP_WORD_BITS] >> (i % BITMAP_WORD_BITS)) & 1;
+}
+
+// Not safe against concurrent writers of the same word
+static inline void bitmap_set(uint64_t* bitmap, long i)
+{
+    bitmap[i / BITMAP_WORD_BITS] |= (uint64_t) 1 << (i % BITMAP_WORD_BITS);
+}
+
+// Safe against concurrent writers; returns true if the bit was clear
+static inline bool bitmap_set_atomic(uint64_t* bitmap, long i)
+{
+    uint64_t bit = (uint64_t) 1 << (i % BITMAP_WORD_BITS);
+    return !(__sync_fetch_and_or(&bitmap[i / BITMAP_WORD_BITS], bit) & bit);
+}
+
+// Mask of the bits of word w that correspond to vertices below num_bits
+static inline uint64_t bitmap_valid_mask(long num_bits, long w)
+{
+    long rest = num_bits - w * BITMAP_WORD_BITS;
+    return rest >= BITMAP_WORD_BITS ? ~(uint64_t) 0 : ((uint64_t) 1 << rest) - 1;
+}
+
+#endif /* __BITMAP_H__ */
@@ -0,0 +1,154 @@
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#include <vector>
+
+#include <omp.h>
+
+#include "compressed_graph.h"
+#include "edge_partition.h"
+#include "memory_policy.h"
+
+static inline int varint_size(uint64_t value)
+{
+    int size = 1;
+    while (value >= 0x80) {
+        value >>= 7;
+        size++;
+    }
+    return size;
+}
+
+static inline uint8_t* varint_encode(uint8_t* p, uint64_t value)
+{
+    while (value >= 0x80) {
+        *p++ = (uint8_t)(value | 0x80);
+        value >>= 7;
+    }
+    *p++ = (uint8_t) value;
+    return p;
+}
+
+static inline uint64_t zigzag_encode(int64_t value)
+{
+    return ((uint64_t) value << 1) ^ (uint64_t)(value >> 63);
+}
+
+// Encoded size of one sorted neighbor list
+template <typename V>
+static uint64_t encoded_size(V v, const V* neighbors, int64_t count)
+{
+    if (count == 0)
+        return 0;
+
+    uint64_t size = varint_size(zigzag_encode((int64_t) neighbors[0] - v));
+    for (int64_t k = 1; k < count; k++)
+        size += varint_size((uint64_t)(neighbors[k] - neighbors[k - 1]));
+    return size;
+}
+
+template <typename V>
+static void encode(uint8_t* p, V v, const V* neighbors, int64_t count)
+{
+    if (count == 0)
+        return;
+
+    p = varint_encode(p, zigzag_encode((int64_t) neighbors[0] - v));
+    for (int64_t k = 1; k < count; k++)
+        p = varint_encode(p, (uint64_t)(neighbors[k] - neighbors[k - 1]));
+}
+
+// Compresses one CSR direction.  Neighbor lists are sorted into a
+// per-thread scratch buffer first, since the source arrays may be a
+// read-only mapping.
+template <typename V, typename O>
+static void compress_direction(V num_nodes, const O* starts, const V* edges,
+                               O** out_starts, uint64_t** out_byte_starts, uint8_t** out_bytes)
+{
+    O* new_starts = (O*) policy_alloc(sizeof(O) * ((size_t) num_nodes + 1));
+    uint64_t* byte_starts = (uint64_t*) policy_alloc(sizeof(uint64_t) * ((size_t) num_nodes + 1));
+    memcpy(new_starts, starts, sizeof(O) * ((size_t) num_nodes + 1));
+
+    // size pass
+    #pragma omp parallel
+    {
+        std::vector<V> scratch;
+        #pragma omp for schedule(dynamic, 1024)
+        for (V v = 0; v < num_nodes; v++) {
+            scratch.assign(edges + starts[v], edges + starts[v + 1]);
+            std::sort(scratch.begin(), scratch.end());
+            byte_starts[v] = encoded_size(v, scratch.data(), (int64_t) scratch.size());
+        }
+    }
+
+    uint64_t total = 0;
+    for (V v = 0; v < num_nodes; v++) {
+        uint64_t size = byte_starts[v];
+        byte_starts[v] = total;
+        total += size;
+    }
+    byte_starts[num_nodes] = total;
+
+    // one spare byte so that an edgeless graph still gets a buffer
+    uint8_t* bytes = (uint8_t*) policy_alloc(total + 1);
+    bytes[total] = 0;
+
+    // encode pass
+    #pragma omp parallel
+    {
+        std::vector<V> scratch;
+        #pragma omp for schedule(dynamic, 1024)
+        for (V v = 0; v < num_nodes; v++) {
+            scratch.assign(edges + starts[v], edges + starts[v + 1]);
+            std::sort(scratch.begin(), scratch.end());
+            encode(bytes + byte_starts[v], v, scratch.data(), (int64_t) scratch.size());
+        }
+    }
+
+    *out_starts = new_starts;
+    *out_byte_starts = byte_starts;
+    *out_bytes = bytes;
+}
+
+template <typename C, typename G>
+static C* compress_graph_impl(const G* g)
+{
+    C* c = (C*) calloc(1, sizeof(C));
+    c->num_nodes = g->num_nodes;
+    c->num_edges = g->num_edges;
+
+    compress_direction(g->num_nodes, g->outgoing_starts, g->outgoing_edges,
+                       &c->outgoing_starts, &c->outgoing_byte_starts, &c->outgoing_bytes);
+    compress_direction(g->num_nodes, g->incoming_starts, g->incoming_edges,
+                       &c->incoming_starts, &c->incoming_byte_starts, &c->incoming_bytes);
+    return c;
+}
+
+CompressedGraph compress_graph(const graph* g) { return compress_graph_impl<compressed_graph>(g); }
+CompressedGraph64 compress_graph(const graph64* g) { return compress_graph_impl<compressed_graph64>(g); }
+
+template <typename C>
+static uint64_t compressed_adjacency_bytes_impl(const C* c)
+{
+    uint64_t offsets = 2 * sizeof(uint64_t) * ((uint64_t) c->num_nodes + 1);
+    return offsets + c->outgoing_byte_starts[c->num_nodes] + c->incoming_byte_starts[c->num_nodes];
+}
+
+uint64_t compressed_adjacency_bytes(const compressed_graph* c) { return compressed_adjacency_bytes_impl(c); }
+uint64_t compressed_adjacency_bytes(const compressed_graph64* c) { return compressed_adjacency_bytes_impl(c); }
+
+template <typename C>
+static void free_compressed_graph(C* c)
+{
+    free_edge_partition(c->incoming_partition);
+    policy_free(c->outgoing_starts);
+    policy_free(c->outgoing_byte_starts);
+    policy_free(c->outgoing_bytes);
+    policy_free(c->incoming_starts);
+    policy_free(c->incoming_byte_starts);
+    policy_free(c->incoming_bytes);
+    free(c);
+}
+
+void free_graph(CompressedGraph c) { free_compressed_graph(c); }
+void free_graph(CompressedGraph64 c) { free_compressed_graph(c); }
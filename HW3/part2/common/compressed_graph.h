@@ -0,0 +1,149 @@
+#ifndef __COMPRESSED_GRAPH_H__
+#define __COMPRESSED_GRAPH_H__
+
+#include <stdint.h>
+
+#include "graph.h"
+
+// Compressed CSR graph.  Each vertex's neighbor list is sorted and
+// stored as byte-oriented varints (7 payload bits per byte, high bit set
+// on every byte but the last):
+//
+//   zigzag(first_neighbor - v), then neighbor[k] - neighbor[k - 1]
+//
+// The starts arrays are kept uncompressed (num_nodes + 1 entries, as in
+// struct graph) so degrees stay O(1); the byte_starts arrays give the
+// offset of each vertex's encoded list in the bytes arrays.
+template <typename VertexT, typename OffsetT>
+struct basic_compressed_graph
+{
+    using vertex_type = VertexT;
+    using offset_type = OffsetT;
+
+    OffsetT num_edges;
+    VertexT num_nodes;
+
+    OffsetT* outgoing_starts;
+    uint64_t* outgoing_byte_starts;
+    uint8_t* outgoing_bytes;
+
+    OffsetT* incoming_starts;
+    uint64_t* incoming_byte_starts;
+    uint8_t* incoming_bytes;
+
+    // Cached by incoming_partition (see edge_partition.h), or NULL
+    edge_partition* incoming_partition;
+};
+
+struct compressed_graph : basic_compressed_graph<Vertex, int> {};
+struct compressed_graph64 : basic_compressed_graph<Vertex, int64_t> {};
+
+using CompressedGraph = compressed_graph*;
+using CompressedGraph64 = compressed_graph64*;
+
+static inline uint64_t varint_decode(const uint8_t*& p)
+{
+    uint64_t byte = *p++;
+    if (byte < 0x80)
+        return byte;
+
+    uint64_t value = byte & 0x7f;
+    int shift = 7;
+    do {
+        byte = *p++;
+        value |= (byte & 0x7f) << shift;
+        shift += 7;
+    } while (byte >= 0x80);
+    return value;
+}
+
+static inline int64_t zigzag_decode(uint64_t value)
+{
+    return (int64_t)(value >> 1) ^ -(int64_t)(value & 1);
+}
+
+// Forward iterator that decodes a neighbor list in place
+template <typename V>
+struct varint_iterator
+{
+    const uint8_t* pos;
+    int64_t remaining;
+    V value;
+
+    V operator*() const { return value; }
+
+    varint_iterator& operator++()
+    {
+        if (--remaining > 0)
+            value += (V) varint_decode(pos);
+        return *this;
+    }
+
+    bool operator!=(const varint_iterator& other) const { return remaining != other.remaining; }
+    bool operator==(const varint_iterator& other) const { return remaining == other.remaining; }
+};
+
+// A compressed neighbor list, for use in range-based for loops
+template <typename V>
+struct varint_range
+{
+    const uint8_t* bytes;
+    int64_t count;
+    V vertex;
+
+    varint_iterator<V> begin() const
+    {
+        varint_iterator<V> it = { bytes, count, 0 };
+        if (count > 0)
+            it.value = (V)(vertex + zigzag_decode(varint_decode(it.pos)));
+        return it;
+    }
+
+    varint_iterator<V> end() const { return varint_iterator<V>{ NULL, 0, 0 }; }
+    int64_t size() const { return count; }
+};
+
+/* Getters, mirroring the ones in graph.h */
+template <typename V, typename O>
+static inline V num_nodes(const basic_compressed_graph<V, O>* g) { return g->num_nodes; }
+
+template <typename V, typename O>
+static inline O num_edges(const basic_compressed_graph<V, O>* g) { return g->num_edges; }
+
+template <typename V, typename O>
+static inline O outgoing_size(const basic_compressed_graph<V, O>* g, typename basic_compressed_graph<V, O>::vertex_type v)
+{
+    return g->outgoing_starts[v + 1] - g->outgoing_starts[v];
+}
+
+template <typename V, typename O>
+static inline O incoming_size(const basic_compressed_graph<V, O>* g, typename basic_compressed_graph<V, O>::vertex_type v)
+{
+    return g->incoming_starts[v + 1] - g->incoming_starts[v];
+}
+
+template <typename V, typename O>
+static inline varint_range<V> outgoing_neighbors(const basic_compressed_graph<V, O>* g, typename basic_compressed_graph<V, O>::vertex_type v)
+{
+    return varint_range<V>{ g->outgoing_bytes + g->outgoing_byte_starts[v], outgoing_size(g, v), v };
+}
+
+template <typename V, typename O>
+static inline varint_range<V> incoming_neighbors(const basic_compressed_graph<V, O>* g, typename basic_compressed_graph<V, O>::vertex_type v)
+{
+    return varint_range<V>{ g->incoming_bytes + g->incoming_byte_starts[v], incoming_size(g, v), v };
+}
+
+// Builds the compressed form of a graph, in parallel.  The source graph
+// is left untouched and can be freed afterwards.
+CompressedGraph compress_graph(const graph*);
+CompressedGraph64 compress_graph(const graph64*);
+
+// Bytes taken by the compressed adjacency (byte offsets and varints)
+uint64_t compressed_adjacency_bytes(const compressed_graph*);
+uint64_t compressed_adjacency_bytes(const compressed_graph64*);
+
+void free_graph(CompressedGraph);
+void free_graph(CompressedGraph64);
+
+#endif /* __COMPRESSED_GRAPH_H__ */
@@ -0,0 +1,108 @@
+#include "edge_partition.h"
+
+#include <stdlib.h>
+
+#include <algorithm>
+
+static bool balance_edges = true;
+
+void set_edge_balancing(bool enable)
+{
+    balance_edges = enable;
+}
+
+bool edge_balancing_enabled()
+{
+    return balance_edges;
+}
+
+// First vertex v whose weight before it, starts[v] + v, reaches target,
+// rounded down to EDGE_PARTITION_ALIGN
+template <typename O>
+static Vertex find_boundary(const O* starts, Vertex num_nodes, int64_t target)
+{
+    Vertex low = 0, high = num_nodes;
+    while (low < high) {
+        Vertex mid = low + (high - low) / 2;
+        if ((int64_t) starts[mid] + mid < target)
+            low = mid + 1;
+        else
+            high = mid;
+    }
+    return low - low % EDGE_PARTITION_ALIGN;
+}
+
+template <typename O>
+static void split_by_edges_impl(const O* starts, Vertex num_nodes, int num_parts, Vertex* boundaries)
+{
+    int64_t total = (int64_t) starts[num_nodes] + num_nodes;
+    boundaries[0] = 0;
+    for (int p = 1; p < num_parts; p++)
+        boundaries[p] = std::max(find_boundary(starts, num_nodes, total * p / num_parts), boundaries[p - 1]);
+    boundaries[num_parts] = num_nodes;
+}
+
+void split_by_edges(const int* starts, Vertex num_nodes, int num_parts, Vertex* boundaries)
+{
+    split_by_edges_impl(starts, num_nodes, num_parts, boundaries);
+}
+
+void split_by_edges(const int64_t* starts, Vertex num_nodes, int num_parts, Vertex* boundaries)
+{
+    split_by_edges_impl(starts, num_nodes, num_parts, boundaries);
+}
+
+template <typename G>
+static const edge_partition* incoming_partition_impl(G* g, int num_threads)
+{
+    int num_parts = balance_edges ? num_threads * EDGE_PARTITION_PARTS_PER_THREAD : num_threads;
+    edge_partition* partition = g->incoming_partition;
+    if (partition && partition->num_parts == num_parts && partition->balance_edges == balance_edges)
+        return partition;
+
+    free_edge_partition(partition);
+    partition = (edge_partition*) malloc(sizeof(edge_partition));
+    partition->num_parts = num_parts;
+    partition->starts = (Vertex*) malloc(sizeof(Vertex) * (num_parts + 1));
+    partition->balance_edges = balance_edges;
+
+    Vertex n = g->num_nodes;
+    if (balance_edges) {
+        split_by_edges(g->incoming_starts, n, num_parts, partition->starts);
+    } else {
+        for (int p = 0; p < num_parts; p++)
+            partition->starts[p] = (Vertex)((int64_t) n * p / num_parts / EDGE_PARTITION_ALIGN * EDGE_PARTITION_ALIGN);
+        partition->starts[num_parts] = n;
+    }
+
+    g->incoming_partition = partition;
+    return partition;
+}
+
+const edge_partition* incoming_partition(Graph g, int num_threads)
+{
+    return incoming_partition_impl(g, num_threads);
+}
+
+const edge_partition* incoming_partition(Graph64 g, int num_threads)
+{
+    return incoming_partition_impl(g, num_threads);
+}
+
+const edge_partition* incoming_partition(CompressedGraph g, int num_threads)
+{
+    return incoming_partition_impl(g, num_threads);
+}
+
+const edge_partition* incoming_partition(CompressedGraph64 g, int num_threads)
+{
+    return incoming_partition_impl(g, num_threads);
+}
+
+void free_edge_partition(edge_partition* partition)
+{
+    if (!partition)
+        return;
+    free(partition->starts);
+    free(partition);
+}
@@ -0,0 +1,57 @@
+#ifndef __EDGE_PARTITION_H__
+#define __EDGE_PARTITION_H__
+
+#include "graph.h"
+#include "compressed_graph.h"
+
+// Vertex ranges for pull-style kernels, which visit every vertex and
+// scan its incoming edges.  On power-law graphs equal vertex counts can
+// differ in incoming edges by orders of magnitude, so the ranges are cut
+// at equal shares of incoming_size(v) + 1 summed over their vertices
+// (the + 1 is the per-vertex work).  Kernels hand out the ranges with
+// schedule(dynamic, 1).
+
+// Ranges per thread; more than one lets a thread that finished early
+// take over work where the edge count misjudges the cost
+#define EDGE_PARTITION_PARTS_PER_THREAD 8
+
+// Range boundaries are multiples of this, so ranges own whole bitmap
+// words and whole cache lines of per-vertex arrays
+#define EDGE_PARTITION_ALIGN 64
+
+struct edge_partition
+{
+    // num_parts + 1 entries: range p is [starts[p], starts[p + 1]).
+    // Ranges may be empty.
+    int num_parts;
+    Vertex* starts;
+    // false if the ranges hold equal vertex counts instead
+    bool balance_edges;
+};
+
+// Turns edge balancing on (the default) or off.  With it off, kernels
+// get one range of equal vertex count per thread, as a static schedule
+// would give them, so the two can be compared.
+void set_edge_balancing(bool enable);
+bool edge_balancing_enabled();
+
+// Ranges over g's vertices for num_threads threads.  The partition is
+// built on first use and cached in the graph until the thread count or
+// the balancing setting changes, and freed by free_graph.  Not thread
+// safe: call it outside parallel regions.
+const edge_partition* incoming_partition(Graph g, int num_threads);
+const edge_partition* incoming_partition(Graph64 g, int num_threads);
+const edge_partition* incoming_partition(CompressedGraph g, int num_threads);
+const edge_partition* incoming_partition(CompressedGraph64 g, int num_threads);
+
+void free_edge_partition(edge_partition* partition);
+
+// Fills boundaries[0..num_parts] with the starts of num_parts ranges of
+// roughly equal starts[v + 1] - starts[v] + 1 summed over their
+// vertices, aligned like the ranges above.  starts is any CSR starts
+// array of num_nodes + 1 entries, e.g. outgoing_starts for push-style
+// kernels, which split their sources with it.
+void split_by_edges(const int* starts, Vertex num_nodes, int num_parts, Vertex* boundaries);
+void split_by_edges(const int64_t* starts, Vertex num_nodes, int num_parts, Vertex* boundaries);
+
+#endif /* __EDGE_PARTITION_H__ */
@@ -56,8 +56,8 @@ static void printTimingApp(std::ostream& timing, const char* appName)
  * Correctness checkers
  */
 
-template <class T>
-bool compareArrays(Graph graph, T* ref, T* stu)
+template <class T, class G>
+bool compareArrays(G* graph, T* ref, T* stu)
 {
   for (int i = 0; i < graph->num_nodes; i++) {
     if (ref[i] != stu[i]) {
@@ -69,8 +69,8 @@ bool compareArrays(Graph graph, T* ref, T* stu)
   return true;
 }
 
-template <class T>
-bool compareApprox(Graph graph, T* ref, T* stu)
+template <class T, class G>
+bool compareApprox(G* graph, T* ref, T* stu)
 {
   for (int i = 0; i < graph->num_nodes; i++) {
     if (fabs(ref[i] - stu[i]) > EPSILON) {
@@ -82,8 +82,8 @@ bool compareApprox(Graph graph, T* ref, T* stu)
   return true;
 }
 
-template <class T>
-bool compareArraysAndDisplay(Graph graph, T* ref, T*stu) 
+template <class T, class G>
+bool compareArraysAndDisplay(G* graph, T* ref, T*stu) 
 {
   printf("\n----------------------------------\n");
   printf("Visualization of student results");
@@ -111,8 +111,8 @@ bool compareArraysAndDisplay(Graph graph, T* ref, T*stu)
   return compareArrays<T>(graph, ref, stu);
 }
 
-template <class T>
-bool compareArraysAndRadiiEst(Graph graph, T* ref, T* stu) 
+template <class T, class G>
+bool compareArraysAndRadiiEst(G* graph, T* ref, T* stu) 
 {
   bool isCorrect = true;
   for (int i = 0; i < graph->num_nodes; i++) {
@@ -1,243 +1,736 @@
 #include <string>
 #include <iostream>
-#include <fstream>
-#include <sstream>
 #include <cstdlib>
+#include <cstring>
+#include <cctype>
+#include <climits>
+#include <limits>
+#include <algorithm>
+#include <charconv>
+#include <string_view>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <omp.h>
 
 #include "graph.h"
 #include "graph_internal.h"
+#include "graph_binary.h"
+#include "edge_partition.h"
+#include "memory_policy.h"
+#include "parallel_scan.h"
 
-#define GRAPH_HEADER_TOKEN ((int) 0xDEADBEEF)
 
-
-void free_graph(Graph graph)
+template <typename G>
+static void free_graph_impl(G* graph)
 {
-  free(graph->outgoing_starts);
-  free(graph->outgoing_edges);
+  free_edge_partition(graph->incoming_partition);
 
-  free(graph->incoming_starts);
-  free(graph->incoming_edges);
-  free(graph);
-}
+  if (graph->mapping) {
+    munmap(graph->mapping, graph->mapping_size);
+    free(graph);
+    return;
+  }
 
+  policy_free(graph->outgoing_starts);
+  policy_free(graph->outgoing_edges);
 
-void build_start(graph* graph, int* scratch)
-{
-  int num_nodes = graph->num_nodes;
-  graph->outgoing_starts = (int*)malloc(sizeof(int) * num_nodes);
-  for(int i = 0; i < num_nodes; i++)
-  {
-    graph->outgoing_starts[i] = scratch[i];
-  }
+  policy_free(graph->incoming_starts);
+  policy_free(graph->incoming_edges);
+  free(graph);
 }
 
-void build_edges(graph* graph, int* scratch)
-{
-  int num_nodes = graph->num_nodes;
-  graph->outgoing_edges = (int*)malloc(sizeof(int) * graph->num_edges);
-  for(int i = 0; i < graph->num_edges; i++)
-  {
-    graph->outgoing_edges[i] = scratch[num_nodes + i];
-  }
-}
+void free_graph(Graph graph) { free_graph_impl(graph); }
+void free_graph(Graph64 graph) { free_graph_impl(graph); }
+
 
 // Given an outgoing edge adjacency list representation for a directed
-// graph, build an incoming adjacency list representation
-void build_incoming_edges(graph* graph) {
-
-    //printf("Beginning build_incoming... (%d nodes)\n", graph->num_nodes);
-
-    int num_nodes = graph->num_nodes;
-    int* node_counts = (int*)malloc(sizeof(int) * num_nodes);
-    int* node_scatter = (int*)malloc(sizeof(int) * num_nodes);
-
-    graph->incoming_starts = (int*)malloc(sizeof(int) * num_nodes);
-    graph->incoming_edges = (int*)malloc(sizeof(int) * graph->num_edges);
-
-    for (int i=0; i<num_nodes; i++)
-        node_counts[i] = node_scatter[i] = 0;
-
-    int total_edges = 0;
-    // compute number of incoming edges per node
-    for (int i=0; i<num_nodes; i++) {
-        int start_edge = graph->outgoing_starts[i];
-        int end_edge = (i == graph->num_nodes-1) ? graph->num_edges : graph->outgoing_starts[i+1];
-        for (int j=start_edge; j<end_edge; j++) {
-            int target_node = graph->outgoing_edges[j];
-            node_counts[target_node]++;
-            total_edges++;
+// graph, build an incoming adjacency list representation.
+//
+// The source vertices are split into blocks of roughly equal edge
+// counts and every block gets its own in-degree histogram.  A pass over
+// the vertices turns the histograms into per-block write cursors, so
+// each block scatters its sources into a private slice of every
+// incoming segment.  Blocks are ordered by source id, which keeps each
+// incoming segment sorted by source exactly as a serial transpose would.
+//
+// The histograms take num_blocks * num_nodes offsets, so the number of
+// blocks is capped to keep them within twice the size of the edge
+// array; graphs with a very low average degree fall back to fewer
+// blocks than threads.
+template <typename G>
+static void build_incoming_edges_impl(G* graph) {
+
+    using V = typename G::vertex_type;
+    using O = typename G::offset_type;
+
+    V num_nodes = graph->num_nodes;
+    O num_edges = graph->num_edges;
+
+    graph->incoming_starts = (O*)policy_alloc(sizeof(O) * ((size_t) num_nodes + 1));
+    graph->incoming_edges = (V*)policy_alloc(sizeof(V) * num_edges);
+
+    long budget_blocks = 2L * num_edges / (num_nodes > 0 ? num_nodes : 1);
+    int num_blocks = omp_get_max_threads();
+    if (num_blocks > budget_blocks)
+        num_blocks = budget_blocks;
+    if (num_blocks < 1)
+        num_blocks = 1;
+
+    // first source vertex of each block, chosen on edge boundaries
+    V* block_begin = (V*)malloc(sizeof(V) * (num_blocks + 1));
+    for (int b = 0; b < num_blocks; b++) {
+        O target_edge = (int64_t) num_edges * b / num_blocks;
+        block_begin[b] = std::lower_bound(graph->outgoing_starts,
+                                          graph->outgoing_starts + num_nodes,
+                                          target_edge) - graph->outgoing_starts;
+    }
+    block_begin[0] = 0;
+    block_begin[num_blocks] = num_nodes;
+
+    O* histograms = (O*)malloc(sizeof(O) * (size_t) num_blocks * num_nodes);
+
+    // compute number of incoming edges per node, per block
+    #pragma omp parallel for schedule(static, 1)
+    for (int b = 0; b < num_blocks; b++) {
+        O* counts = histograms + (size_t) b * num_nodes;
+        memset(counts, 0, sizeof(O) * num_nodes);
+        for (V i = block_begin[b]; i < block_begin[b + 1]; i++) {
+            for (V v : outgoing_neighbors(graph, i))
+                counts[v]++;
         }
     }
-    //printf("Total edges: %d\n", total_edges);
-    //printf("Computed incoming edge counts.\n");
 
-    // build the starts array
-    graph->incoming_starts[0] = 0;
-    for (int i=1; i<num_nodes; i++) {
-        graph->incoming_starts[i] = graph->incoming_starts[i-1] + node_counts[i-1];
-        //printf("%d: %d ", i, graph->incoming_starts[i]);
+    // turn the histograms into per-block offsets inside each incoming
+    // segment, leaving the total in-degree in incoming_starts
+    #pragma omp parallel for schedule(static)
+    for (V i = 0; i < num_nodes; i++) {
+        O running = 0;
+        for (int b = 0; b < num_blocks; b++) {
+            O* count = histograms + (size_t) b * num_nodes + i;
+            O c = *count;
+            *count = running;
+            running += c;
+        }
+        graph->incoming_starts[i] = running;
     }
-    //printf("\n");
-    //printf("Last edge=%d\n", graph->incoming_starts[num_nodes-1] + node_counts[num_nodes-1]);
 
-    //printf("Computed per-node incoming starts.\n");
+    // build the starts array
+    graph->incoming_starts[num_nodes] =
+        parallel_exclusive_scan(graph->incoming_starts, graph->incoming_starts, num_nodes);
 
     // now perform the scatter
-    for (int i=0; i<num_nodes; i++) {
-        int start_edge = graph->outgoing_starts[i];
-        int end_edge = (i == graph->num_nodes-1) ? graph->num_edges : graph->outgoing_starts[i+1];
-        for (int j=start_edge; j<end_edge; j++) {
-            int target_node = graph->outgoing_edges[j];
-            graph->incoming_edges[graph->incoming_starts[target_node] + node_scatter[target_node]] = i;
-            node_scatter[target_node]++;
+    #pragma omp parallel for schedule(static, 1)
+    for (int b = 0; b < num_blocks; b++) {
+        O* cursors = histograms + (size_t) b * num_nodes;
+        for (V i = block_begin[b]; i < block_begin[b + 1]; i++) {
+            for (V target_node : outgoing_neighbors(graph, i))
+                graph->incoming_edges[graph->incoming_starts[target_node] + cursors[target_node]++] = i;
         }
     }
 
-    /*
-    // verify
-    printf("Verifying graph...\n");
+    free(histograms);
+    free(block_begin);
+}
 
-    for (int i=0; i<num_nodes; i++) {
-        int outgoing_starts = graph->outgoing_starts[i];
-        int end_node = (i == graph->num_nodes-1) ? graph->num_edges : graph->outgoing_starts[i+1];
-        for (int j=outgoing_starts; j<end_node; j++) {
+void build_incoming_edges(Graph graph) { build_incoming_edges_impl(graph); }
+void build_incoming_edges(Graph64 graph) { build_incoming_edges_impl(graph); }
 
-            bool verified = false;
+template <typename G>
+static G* permute_graph_impl(const G* g, const Vertex* new_ids)
+{
+    using V = typename G::vertex_type;
+    using O = typename G::offset_type;
 
-            // make sure that i is a neighbor of target_node
-            int target_node = graph->outgoing_edges[j];
-            int j_start_edge = graph->incoming_starts[target_node];
-            int j_end_edge = (target_node == graph->num_nodes-1) ? graph->num_edges : graph->incoming_starts[target_node+1];
-            for (int k=j_start_edge; k<j_end_edge; k++) {
-                if (graph->incoming_edges[k] == i) {
-                    verified = true;
-                    break;
-                }
-            }
+    V num_nodes = g->num_nodes;
 
-            if (!verified) {
-                fprintf(stderr,"Error: %d,%d did not verify\n", i, target_node);
-            }
-        }
+    G* out = (G*)(calloc(1, sizeof(G)));
+    out->num_nodes = num_nodes;
+    out->num_edges = g->num_edges;
+    out->outgoing_starts = (O*)policy_alloc(sizeof(O) * ((size_t) num_nodes + 1));
+    out->outgoing_edges = (V*)policy_alloc(sizeof(V) * g->num_edges);
+
+    V* old_ids = (V*)malloc(sizeof(V) * num_nodes);
+
+    #pragma omp parallel for schedule(static)
+    for (V v = 0; v < num_nodes; v++) {
+        old_ids[new_ids[v]] = v;
+        out->outgoing_starts[new_ids[v]] = outgoing_size(g, v);
+    }
+
+    out->outgoing_starts[num_nodes] =
+        parallel_exclusive_scan(out->outgoing_starts, out->outgoing_starts, num_nodes);
+
+    #pragma omp parallel for schedule(dynamic, 1024)
+    for (V u = 0; u < num_nodes; u++) {
+        V* edges = out->outgoing_edges + out->outgoing_starts[u];
+        O k = 0;
+        for (V v : outgoing_neighbors(g, old_ids[u]))
+            edges[k++] = new_ids[v];
+        std::sort(edges, edges + k);
+    }
+
+    free(old_ids);
+
+    build_incoming_edges_impl(out);
+    return out;
+}
+
+Graph permute_graph(const graph* g, const Vertex* new_ids) { return permute_graph_impl(g, new_ids); }
+Graph64 permute_graph(const graph64* g, const Vertex* new_ids) { return permute_graph_impl(g, new_ids); }
+
+void store_permutation(const char* filename, const Vertex* new_ids, Vertex num_nodes)
+{
+    FILE* output = fopen(filename, "wb");
+
+    if (!output) {
+        fprintf(stderr, "Could not open: %s\n", filename);
+        exit(1);
     }
 
-    printf("Done verifying\n");
-    */
+    int64_t header[2] = { PERMUTATION_HEADER_TOKEN, num_nodes };
+    if (fwrite(header, sizeof(int64_t), 2, output) != 2 ||
+        fwrite(new_ids, sizeof(Vertex), num_nodes, output) != (size_t) num_nodes) {
+        fprintf(stderr, "Error writing permutation.\n");
+        exit(1);
+    }
 
-    free(node_counts);
-    free(node_scatter);
+    fclose(output);
 }
 
-void get_meta_data(std::ifstream& file, graph* graph)
+Vertex* load_permutation(const char* filename, Vertex* num_nodes)
 {
-  // going back to the beginning of the file
-  file.clear();
-  file.seekg(0, std::ios::beg);
-  std::string buffer;
-  std::getline(file, buffer);
-  if ((buffer.compare(std::string("AdjacencyGraph"))))
-  {
-    std::cout << "Invalid input file" << buffer << std::endl;
+    FILE* input = fopen(filename, "rb");
+
+    if (!input) {
+        fprintf(stderr, "Could not open: %s\n", filename);
+        exit(1);
+    }
+
+    int64_t header[2];
+    if (fread(header, sizeof(int64_t), 2, input) != 2 || header[0] != PERMUTATION_HEADER_TOKEN) {
+        fprintf(stderr, "Invalid permutation file header. File may be corrupt.\n");
+        exit(1);
+    }
+
+    *num_nodes = header[1];
+    Vertex* new_ids = (Vertex*)malloc(sizeof(Vertex) * header[1]);
+    if (fread(new_ids, sizeof(Vertex), header[1], input) != (size_t) header[1]) {
+        fprintf(stderr, "Error reading permutation.\n");
+        exit(1);
+    }
+
+    fclose(input);
+    return new_ids;
+}
+
+// A read-only view of a text graph file, cursor-style.
+struct text_cursor
+{
+    const char* pos;
+    const char* end;
+};
+
+// Returns the next line (without its newline) and advances past it.
+static std::string_view next_line(text_cursor* cursor)
+{
+    const char* begin = cursor->pos;
+    const char* newline = (const char*) memchr(begin, '\n', cursor->end - begin);
+    const char* end = newline ? newline : cursor->end;
+    cursor->pos = newline ? newline + 1 : cursor->end;
+    return std::string_view(begin, end - begin);
+}
+
+// Returns the next line that is neither empty nor a comment.
+static std::string_view next_data_line(text_cursor* cursor)
+{
+    std::string_view line;
+    do {
+        if (cursor->pos == cursor->end) {
+            std::cout << "Invalid input file: unexpected end of header" << std::endl;
+            exit(1);
+        }
+        line = next_line(cursor);
+    } while (line.size() == 0 || line[0] == '#');
+    return line;
+}
+
+// Parses a header line holding one integer, surrounded by whitespace
+static int64_t parse_header_value(std::string_view line)
+{
+    const char* begin = line.data();
+    const char* end = line.data() + line.size();
+    while (begin != end && isspace((unsigned char) *begin))
+        begin++;
+    int64_t value = 0;
+    std::from_chars_result result = std::from_chars(begin, end, value);
+    const char* rest = result.ptr;
+    while (rest != end && isspace((unsigned char) *rest))
+        rest++;
+    if (result.ec != std::errc() || rest != end) {
+        std::cout << "Invalid input file: bad header line '" << line << "'" << std::endl;
+        exit(1);
+    }
+    return value;
+}
+
+// A text graph file mapped into memory, with its header parsed and the
+// cursor left at the first line of the body.
+struct text_graph_file
+{
+    const char* text;
+    size_t size;
+    int64_t num_nodes;
+    int64_t num_edges;
+    text_cursor body;
+};
+
+static void open_text_graph(const char* filename, text_graph_file* file)
+{
+  int fd = open(filename, O_RDONLY);
+  if (fd < 0) {
+    fprintf(stderr, "Could not open: %s\n", filename);
     exit(1);
   }
-  buffer.clear();
 
-  do {
-      std::getline(file, buffer);
-  } while (buffer.size() == 0 || buffer[0] == '#');
+  struct stat st;
+  if (fstat(fd, &st) != 0) {
+    fprintf(stderr, "Could not stat: %s\n", filename);
+    exit(1);
+  }
 
-  graph->num_nodes = atoi(buffer.c_str());
-  buffer.clear();
+  file->size = st.st_size;
+  file->text = (const char*) mmap(NULL, file->size > 0 ? file->size : 1, PROT_READ, MAP_PRIVATE, fd, 0);
+  if (file->text == MAP_FAILED) {
+    fprintf(stderr, "Could not mmap: %s\n", filename);
+    exit(1);
+  }
+  close(fd);
+  madvise((void*) file->text, file->size, MADV_SEQUENTIAL);
 
-  do {
-      std::getline(file, buffer);
-  } while (buffer.size() == 0 || buffer[0] == '#');
+  text_cursor cursor = { file->text, file->text + file->size };
+  std::string_view magic = next_line(&cursor);
+  if (magic != "AdjacencyGraph")
+  {
+    std::cout << "Invalid input file" << magic << std::endl;
+    exit(1);
+  }
 
-  graph->num_edges = atoi(buffer.c_str());
+  file->num_nodes = parse_header_value(next_data_line(&cursor));
+  file->num_edges = parse_header_value(next_data_line(&cursor));
+  file->body = cursor;
+}
 
+static void close_text_graph(text_graph_file* file)
+{
+  munmap((void*) file->text, file->size > 0 ? file->size : 1);
 }
 
-void read_graph_file(std::ifstream& file, int* scratch)
+// Destination of the parsed body: the first num_starts integers are
+// the outgoing starts, the rest are the outgoing edges.  Starts must lie
+// in [0, num_edges] and edges in [0, num_starts).
+template <typename V, typename O>
+struct body_sink
 {
-  std::string buffer;
-  int idx = 0;
-  while(!file.eof())
-  {
-    buffer.clear();
-    std::getline(file, buffer);
-
-    if (buffer.size() > 0 && buffer[0] == '#')
-        continue;
-
-    std::stringstream parse(buffer);
-    while (!parse.fail()) {
-        int v;
-        parse >> v;
-        if (parse.fail())
-        {
-            break;
+    O* starts;
+    V* edges;
+    int64_t num_starts;
+    int64_t num_edges;
+};
+
+// Parses the integers in [begin, end), which must start at the
+// beginning of a line, writing them to sink from index first onwards.
+// Lines starting with '#' are skipped.  If sink is NULL the integers
+// are only counted.  base is the start of the file, for error offsets.
+template <typename V, typename O>
+static int64_t parse_integers(const char* begin, const char* end, const char* base,
+                              const body_sink<V, O>* sink, int64_t first)
+{
+    int64_t count = 0;
+    const char* p = begin;
+    bool line_start = true;
+
+    while (p < end) {
+        char c = *p;
+        if (c == '\n') {
+            line_start = true;
+            p++;
+        } else if (line_start && c == '#') {
+            const char* newline = (const char*) memchr(p, '\n', end - p);
+            p = newline ? newline : end;
+        } else if (c == ' ' || c == '\t' || c == '\r' || c == '\v' || c == '\f') {
+            line_start = false;
+            p++;
+        } else {
+            line_start = false;
+            int64_t value;
+            std::from_chars_result result = std::from_chars(p, end, value);
+            if (result.ec != std::errc()) {
+                fprintf(stderr, "Invalid token in graph file at byte %ld.\n", (long)(p - base));
+                exit(1);
+            }
+            if (sink) {
+                int64_t index = first + count;
+                bool is_start = index < sink->num_starts;
+                int64_t limit = is_start ? sink->num_edges + 1 : sink->num_starts;
+                if (value < 0 || value >= limit) {
+                    fprintf(stderr, "%s %ld out of range in graph file at byte %ld.\n",
+                            is_start ? "Edge offset" : "Vertex id", (long) value, (long)(p - base));
+                    exit(1);
+                }
+                if (is_start)
+                    sink->starts[index] = (O) value;
+                else
+                    sink->edges[index - sink->num_starts] = (V) value;
+            }
+            count++;
+            p = result.ptr;
         }
-        scratch[idx] = v;
-        idx++;
     }
-  }
+    return count;
+}
+
+// Returns the first vertex v with starts[v] > starts[v + 1], or -1.
+// Transposing or scanning a CSR with decreasing starts runs off its
+// arrays, so loaders check this before using one.
+template <typename O>
+static int64_t find_decreasing_start(const O* starts, int64_t num_nodes)
+{
+    int64_t first = num_nodes;
+    #pragma omp parallel for schedule(static) reduction(min:first)
+    for (int64_t v = 0; v < num_nodes; v++)
+        if (starts[v] > starts[v + 1] && v < first)
+            first = v;
+    return first < num_nodes ? first : -1;
+}
+
+// Parses the body of a text graph file (starts followed by edges) on
+// every thread.  The body is cut into one chunk per thread on line
+// boundaries; a counting pass sizes each chunk so that the second pass
+// can write its integers straight into outgoing_starts/outgoing_edges.
+template <typename G>
+static void parse_graph_body(G* graph, const char* base, const char* begin, const char* end)
+{
+    using V = typename G::vertex_type;
+    using O = typename G::offset_type;
+
+    int num_chunks = omp_get_max_threads();
+    std::vector<const char*> bounds(num_chunks + 1);
+    std::vector<int64_t> offsets(num_chunks + 1, 0);
+
+    bounds[0] = begin;
+    bounds[num_chunks] = end;
+    for (int c = 1; c < num_chunks; c++) {
+        const char* p = begin + (end - begin) * c / num_chunks;
+        if (p < bounds[c - 1])
+            p = bounds[c - 1];
+        const char* newline = (const char*) memchr(p, '\n', end - p);
+        bounds[c] = newline ? newline + 1 : end;
+    }
+
+    #pragma omp parallel for schedule(static, 1)
+    for (int c = 0; c < num_chunks; c++)
+        offsets[c + 1] = parse_integers<V, O>(bounds[c], bounds[c + 1], base, NULL, 0);
+
+    for (int c = 0; c < num_chunks; c++)
+        offsets[c + 1] += offsets[c];
+
+    int64_t expected = (int64_t) graph->num_nodes + graph->num_edges;
+    if (offsets[num_chunks] != expected) {
+        fprintf(stderr, "Graph file has %ld values, expected %ld.\n", (long) offsets[num_chunks], (long) expected);
+        exit(1);
+    }
+
+    graph->outgoing_starts = (O*) policy_alloc(sizeof(O) * ((size_t) graph->num_nodes + 1));
+    graph->outgoing_edges = (V*) policy_alloc(sizeof(V) * graph->num_edges);
+    body_sink<V, O> sink = { graph->outgoing_starts, graph->outgoing_edges, graph->num_nodes, graph->num_edges };
+
+    #pragma omp parallel for schedule(static, 1)
+    for (int c = 0; c < num_chunks; c++)
+        parse_integers(bounds[c], bounds[c + 1], base, &sink, offsets[c]);
+
+    // the text format has no sentinel, add it
+    graph->outgoing_starts[graph->num_nodes] = graph->num_edges;
+
+    int64_t v = find_decreasing_start(graph->outgoing_starts, graph->num_nodes);
+    if (v >= 0) {
+        fprintf(stderr, "Graph file offsets decrease after vertex %ld (%ld > %ld).\n", (long) v,
+                (long) graph->outgoing_starts[v], (long) graph->outgoing_starts[v + 1]);
+        exit(1);
+    }
 }
 
-void print_graph(const graph* graph)
+template <typename G>
+static void print_graph_impl(const G* graph)
 {
+    using V = typename G::vertex_type;
 
     printf("Graph pretty print:\n");
-    printf("num_nodes=%d\n", graph->num_nodes);
-    printf("num_edges=%d\n", graph->num_edges);
+    printf("num_nodes=%ld\n", (long) graph->num_nodes);
+    printf("num_edges=%ld\n", (long) graph->num_edges);
 
-    for (int i=0; i<graph->num_nodes; i++) {
+    for (V i=0; i<graph->num_nodes; i++) {
 
-        int start_edge = graph->outgoing_starts[i];
-        int end_edge = (i == graph->num_nodes-1) ? graph->num_edges : graph->outgoing_starts[i+1];
-        printf("node %02d: out=%d: ", i, end_edge - start_edge);
-        for (int j=start_edge; j<end_edge; j++) {
-            int target = graph->outgoing_edges[j];
-            printf("%d ", target);
+        printf("node %02ld: out=%ld: ", (long) i, (long) outgoing_size(graph, i));
+        for (V v : outgoing_neighbors(graph, i)) {
+            printf("%ld ", (long) v);
         }
         printf("\n");
 
-        start_edge = graph->incoming_starts[i];
-        end_edge = (i == graph->num_nodes-1) ? graph->num_edges : graph->incoming_starts[i+1];
-        printf("         in=%d: ", end_edge - start_edge);
-        for (int j=start_edge; j<end_edge; j++) {
-            int target = graph->incoming_edges[j];
-            printf("%d ", target);
+        printf("         in=%ld: ", (long) incoming_size(graph, i));
+        for (V v : incoming_neighbors(graph, i)) {
+            printf("%ld ", (long) v);
         }
         printf("\n");
     }
 }
 
-Graph load_graph(const char* filename)
+void print_graph(const graph* graph) { print_graph_impl(graph); }
+void print_graph(const graph64* graph) { print_graph_impl(graph); }
+
+template <typename G>
+static G* load_graph_impl(const char* filename)
 {
-  graph* graph = (struct graph*)(malloc(sizeof(struct graph)));
+  using O = typename G::offset_type;
+
+  text_graph_file file;
+  open_text_graph(filename, &file);
+
+  using V = typename G::vertex_type;
 
-  // open the file
-  std::ifstream graph_file;
-  graph_file.open(filename);
-  get_meta_data(graph_file, graph);
+  if (file.num_nodes < 0 || file.num_nodes > std::numeric_limits<V>::max() || file.num_edges < 0) {
+    fprintf(stderr, "%s has an invalid header: %ld nodes, %ld edges.\n",
+            filename, (long) file.num_nodes, (long) file.num_edges);
+    exit(1);
+  }
+  if (file.num_edges > std::numeric_limits<O>::max()) {
+    fprintf(stderr, "%s has %ld edges, too many for %zu-byte edge offsets.\n",
+            filename, (long) file.num_edges, sizeof(O));
+    exit(1);
+  }
 
-  int* scratch = (int*) malloc(sizeof(int) * (graph->num_nodes + graph->num_edges));
-  read_graph_file(graph_file, scratch);
+  G* graph = (G*)(calloc(1, sizeof(G)));
+  graph->num_nodes = file.num_nodes;
+  graph->num_edges = file.num_edges;
 
-  build_start(graph, scratch);
-  build_edges(graph, scratch);
-  free(scratch);
+  parse_graph_body(graph, file.text, file.body.pos, file.body.end);
+  close_text_graph(&file);
 
-  build_incoming_edges(graph);
+  build_incoming_edges_impl(graph);
 
   //print_graph(graph);
 
   return graph;
 }
 
-Graph load_graph_binary(const char* filename)
+Graph load_graph(const char* filename) { return load_graph_impl<graph>(filename); }
+Graph64 load_graph64(const char* filename) { return load_graph_impl<graph64>(filename); }
+
+// Reads count on-disk values of width file_bytes starting at byte
+// offset and stores them widened (or narrowed) into out.
+template <typename T>
+static void read_array(const char* base, uint64_t offset, uint32_t file_bytes, T* out, uint64_t count)
+{
+    if (file_bytes == sizeof(T)) {
+        memcpy(out, base + offset, sizeof(T) * count);
+    } else if (file_bytes == sizeof(int32_t)) {
+        const int32_t* in = (const int32_t*)(base + offset);
+        #pragma omp parallel for schedule(static)
+        for (uint64_t i = 0; i < count; i++)
+            out[i] = in[i];
+    } else {
+        const int64_t* in = (const int64_t*)(base + offset);
+        #pragma omp parallel for schedule(static)
+        for (uint64_t i = 0; i < count; i++)
+            out[i] = in[i];
+    }
+}
+
+// Reads entry index of the starts array of width file_bytes at byte
+// offset of the file
+static bool pread_offset(int fd, uint64_t offset, uint32_t file_bytes, uint64_t index, int64_t* value)
 {
-    graph* graph = (struct graph*)(malloc(sizeof(struct graph)));
+    off_t position = offset + index * file_bytes;
+    if (file_bytes == sizeof(int32_t)) {
+        int32_t narrow;
+        if (pread(fd, &narrow, sizeof(narrow), position) != (ssize_t) sizeof(narrow))
+            return false;
+        *value = narrow;
+        return true;
+    }
+    return pread(fd, value, sizeof(*value), position) == (ssize_t) sizeof(*value);
+}
+
+// Checks what the v2 loader relies on when it uses the arrays in place:
+// the file holds the whole layout the header's dimensions imply, and
+// both starts arrays run from 0 to num_edges.  Returns NULL or the
+// problem.
+static const char* v2_layout_error(int fd, const graph_file_header* header, uint64_t file_size)
+{
+    if (file_size < header->file_size)
+        return "Graph file is truncated";
+    if (!graph_file_layout_matches(header, file_size))
+        return "Graph file header does not match its array layout";
+
+    for (uint64_t offset : { header->outgoing_starts_offset, header->incoming_starts_offset }) {
+        int64_t first, last;
+        if (!pread_offset(fd, offset, header->offset_bytes, 0, &first) ||
+            !pread_offset(fd, offset, header->offset_bytes, header->num_nodes, &last) ||
+            first != 0 || last != (int64_t) header->num_edges)
+            return "Graph file starts do not run from 0 to the edge count";
+    }
+    return NULL;
+}
+
+// Checks the contents of one CSR direction: num_starts offsets that
+// never decrease and stay within [0, num_edges], and num_edges vertex
+// ids within [0, num_nodes).  The kernels index with both unchecked, so
+// binary loaders run this over the whole file.  Returns NULL or the
+// problem.
+template <typename O, typename V>
+static const char* csr_content_error(const O* starts, int64_t num_starts, const V* edges,
+                                     int64_t num_nodes, int64_t num_edges)
+{
+    if (num_starts > 0 && (starts[0] < 0 || starts[num_starts - 1] > num_edges))
+        return "Graph file offsets lie outside the edge array";
+    if (num_starts > 1 && find_decreasing_start(starts, num_starts - 1) >= 0)
+        return "Graph file offsets decrease";
+
+    bool bad = false;
+    #pragma omp parallel for schedule(static) reduction(||:bad)
+    for (int64_t i = 0; i < num_edges; i++)
+        bad = bad || edges[i] < 0 || edges[i] >= num_nodes;
+    if (bad)
+        return "Graph file has edges to vertex ids outside [0, num_nodes)";
+    return NULL;
+}
+
+// csr_content_error for both directions of a mapped v2 file, whose
+// vertex ids are Vertex wide
+static const char* v2_content_error(const char* base, const graph_file_header* header)
+{
+    int64_t n = header->num_nodes, m = header->num_edges;
+    uint64_t directions[2][2] = {
+        { header->outgoing_starts_offset, header->outgoing_edges_offset },
+        { header->incoming_starts_offset, header->incoming_edges_offset },
+    };
+    for (auto& direction : directions) {
+        const Vertex* edges = (const Vertex*)(base + direction[1]);
+        const char* error = header->offset_bytes == sizeof(int32_t)
+            ? csr_content_error((const int32_t*)(base + direction[0]), n + 1, edges, n, m)
+            : csr_content_error((const int64_t*)(base + direction[0]), n + 1, edges, n, m);
+        if (error)
+            return error;
+    }
+    return NULL;
+}
+
+// Loads a v2 binary graph file.  If the file's index widths match the
+// layout of G, it is mapped read-only and the CSR arrays point straight
+// into the mapping.  Otherwise, or when a memory policy is set (page
+// cache pages cannot be placed or backed by huge pages), the arrays are
+// copied into policy_alloc memory and converted to G's widths.
+template <typename G>
+static G* load_graph_binary_v2(const char* filename)
+{
+    using V = typename G::vertex_type;
+    using O = typename G::offset_type;
+
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0) {
+        fprintf(stderr, "Could not open: %s\n", filename);
+        exit(1);
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        fprintf(stderr, "Could not stat: %s\n", filename);
+        exit(1);
+    }
+
+    graph_file_header header;
+    if (pread(fd, &header, sizeof(header), 0) != (ssize_t) sizeof(header)) {
+        fprintf(stderr, "Error reading header.\n");
+        exit(1);
+    }
+
+    if (header.version != GRAPH_FORMAT_VERSION) {
+        fprintf(stderr, "Unsupported graph file version %u.\n", header.version);
+        exit(1);
+    }
+
+    if (header.vertex_bytes != sizeof(V) ||
+        (header.offset_bytes != sizeof(int32_t) && header.offset_bytes != sizeof(int64_t))) {
+        fprintf(stderr, "Unsupported graph index width (%u-byte vertices, %u-byte offsets).\n",
+                header.vertex_bytes, header.offset_bytes);
+        exit(1);
+    }
+
+    if (header.num_edges > (uint64_t) std::numeric_limits<O>::max()) {
+        fprintf(stderr, "%s has %lu edges, too many for %zu-byte edge offsets.\n",
+                filename, (unsigned long) header.num_edges, sizeof(O));
+        exit(1);
+    }
+
+    if (header.num_nodes > (uint64_t) std::numeric_limits<V>::max()) {
+        fprintf(stderr, "%s has %lu nodes, too many for %zu-byte vertex ids.\n",
+                filename, (unsigned long) header.num_nodes, sizeof(V));
+        exit(1);
+    }
+
+    if (const char* error = v2_layout_error(fd, &header, st.st_size)) {
+        fprintf(stderr, "%s. File may be corrupt.\n", error);
+        exit(1);
+    }
+
+    char* base = (char*) mmap(NULL, header.file_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (base == MAP_FAILED) {
+        fprintf(stderr, "Could not mmap: %s\n", filename);
+        exit(1);
+    }
+    close(fd);
+
+    if (const char* error = v2_content_error(base, &header)) {
+        fprintf(stderr, "%s. File may be corrupt.\n", error);
+        exit(1);
+    }
+
+    G* graph = (G*)(calloc(1, sizeof(G)));
+    graph->num_nodes = header.num_nodes;
+    graph->num_edges = header.num_edges;
+
+    if (header.offset_bytes == sizeof(O) && memory_policy_is_default()) {
+        graph->outgoing_starts = (O*)(base + header.outgoing_starts_offset);
+        graph->outgoing_edges = (V*)(base + header.outgoing_edges_offset);
+        graph->incoming_starts = (O*)(base + header.incoming_starts_offset);
+        graph->incoming_edges = (V*)(base + header.incoming_edges_offset);
+        graph->mapping = base;
+        graph->mapping_size = header.file_size;
+        policy_note_file_mapping(header.file_size);
+        return graph;
+    }
+
+    graph->outgoing_starts = (O*)policy_alloc(sizeof(O) * (header.num_nodes + 1));
+    graph->outgoing_edges = (V*)policy_alloc(sizeof(V) * header.num_edges);
+    graph->incoming_starts = (O*)policy_alloc(sizeof(O) * (header.num_nodes + 1));
+    graph->incoming_edges = (V*)policy_alloc(sizeof(V) * header.num_edges);
+
+    read_array(base, header.outgoing_starts_offset, header.offset_bytes, graph->outgoing_starts, header.num_nodes + 1);
+    read_array(base, header.outgoing_edges_offset, header.vertex_bytes, graph->outgoing_edges, header.num_edges);
+    read_array(base, header.incoming_starts_offset, header.offset_bytes, graph->incoming_starts, header.num_nodes + 1);
+    read_array(base, header.incoming_edges_offset, header.vertex_bytes, graph->incoming_edges, header.num_edges);
+
+    munmap(base, header.file_size);
+    return graph;
+}
+
+template <typename G>
+static G* load_graph_binary_impl(const char* filename)
+{
+    using O = typename G::offset_type;
 
     FILE* input = fopen(filename, "rb");
 
@@ -253,18 +746,31 @@ Graph load_graph_binary(const char* filename)
         exit(1);
     }
 
+    if (header[0] == GRAPH_HEADER_TOKEN_V2) {
+        fclose(input);
+        return load_graph_binary_v2<G>(filename);
+    }
+
     if (header[0] != GRAPH_HEADER_TOKEN) {
         fprintf(stderr, "Invalid graph file header. File may be corrupt.\n");
         exit(1);
     }
 
+    if (header[1] < 0 || header[2] < 0) {
+        fprintf(stderr, "Invalid graph file header. File may be corrupt.\n");
+        exit(1);
+    }
+
+    G* graph = (G*)(calloc(1, sizeof(G)));
+
     graph->num_nodes = header[1];
     graph->num_edges = header[2];
 
-    graph->outgoing_starts = (int*)malloc(sizeof(int) * graph->num_nodes);
-    graph->outgoing_edges = (int*)malloc(sizeof(int) * graph->num_edges);
+    // v1 files always store 32-bit starts, without the sentinel
+    int* starts = (int*)policy_alloc(sizeof(int) * ((size_t) graph->num_nodes + 1));
+    graph->outgoing_edges = (int*)policy_alloc(sizeof(int) * graph->num_edges);
 
-    if (fread(graph->outgoing_starts, sizeof(int), graph->num_nodes, input) != (size_t) graph->num_nodes) {
+    if (fread(starts, sizeof(int), graph->num_nodes, input) != (size_t) graph->num_nodes) {
         fprintf(stderr, "Error reading nodes.\n");
         exit(1);
     }
@@ -276,39 +782,177 @@ Graph load_graph_binary(const char* filename)
 
     fclose(input);
 
-    build_incoming_edges(graph);
+    if (sizeof(O) == sizeof(int)) {
+        graph->outgoing_starts = (O*) starts;
+    } else {
+        graph->outgoing_starts = (O*)policy_alloc(sizeof(O) * ((size_t) graph->num_nodes + 1));
+        read_array((const char*) starts, 0, sizeof(int), graph->outgoing_starts, graph->num_nodes);
+        policy_free(starts);
+    }
+    graph->outgoing_starts[graph->num_nodes] = graph->num_edges;
+
+    if (const char* error = csr_content_error(graph->outgoing_starts, (int64_t) graph->num_nodes + 1,
+                                              graph->outgoing_edges, graph->num_nodes, graph->num_edges)) {
+        fprintf(stderr, "%s. File may be corrupt.\n", error);
+        exit(1);
+    }
+
+    build_incoming_edges_impl(graph);
     //print_graph(graph);
     return graph;
 }
 
-void store_graph_binary(const char* filename, Graph graph) {
+Graph load_graph_binary(const char* filename) { return load_graph_binary_impl<graph>(filename); }
+Graph64 load_graph_binary64(const char* filename) { return load_graph_binary_impl<graph64>(filename); }
 
-    FILE* output = fopen(filename, "wb");
+const char* binary_graph_file_error(const char* filename)
+{
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0)
+        return "Could not open the graph file";
+
+    struct stat st;
+    graph_file_header header;
+    memset(&header, 0, sizeof(header));
+    const char* error = NULL;
+
+    if (fstat(fd, &st) != 0 || pread(fd, &header, sizeof(header), 0) < (ssize_t)(3 * sizeof(int))) {
+        error = "Not a binary graph file";
+    } else if (header.token == GRAPH_HEADER_TOKEN) {
+        // v1: num_nodes and num_edges follow the token, then both arrays
+        const int* v1 = (const int*) &header;
+        if (v1[1] < 0 || v1[2] < 0)
+            error = "Graph file header is invalid";
+        else if ((uint64_t) st.st_size < sizeof(int) * (3 + (uint64_t) v1[1] + v1[2]))
+            error = "Graph file is truncated";
+    } else if (header.token == GRAPH_HEADER_TOKEN_V2) {
+        if ((uint64_t) st.st_size < sizeof(header))
+            error = "Graph file is truncated";
+        else if (header.version != GRAPH_FORMAT_VERSION)
+            error = "Unsupported graph file version";
+        else if (header.vertex_bytes != sizeof(Vertex))
+            error = "Unsupported graph vertex id width";
+        else if (header.num_nodes > (uint64_t) std::numeric_limits<Vertex>::max())
+            error = "Graph file has too many nodes for its vertex ids";
+        else
+            error = v2_layout_error(fd, &header, st.st_size);
+    } else {
+        error = "Not a binary graph file";
+    }
 
-    if (!output) {
+    // the header is sound, now the arrays it describes
+    if (!error) {
+        const char* base = (const char*) mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (base == MAP_FAILED) {
+            error = "Could not map the graph file";
+        } else {
+            if (header.token == GRAPH_HEADER_TOKEN) {
+                const int* v1 = (const int*) base;
+                const int* starts = v1 + 3;
+                error = csr_content_error(starts, v1[1], starts + v1[1], v1[1], v1[2]);
+            } else {
+                error = v2_content_error(base, &header);
+            }
+            munmap((void*) base, st.st_size);
+        }
+    }
+
+    close(fd);
+    return error;
+}
+
+bool graph_file_needs_wide_offsets(const char* filename)
+{
+    FILE* input = fopen(filename, "rb");
+
+    if (!input) {
         fprintf(stderr, "Could not open: %s\n", filename);
         exit(1);
     }
 
-    int header[3];
-    header[0] = GRAPH_HEADER_TOKEN;
-    header[1] = graph->num_nodes;
-    header[2] = graph->num_edges;
+    graph_file_header header;
+    size_t read = fread(&header, 1, sizeof(header), input);
+    fclose(input);
+
+    if (read >= sizeof(int) && header.token == GRAPH_HEADER_TOKEN)
+        return false;
+
+    if (read == sizeof(header) && header.token == GRAPH_HEADER_TOKEN_V2)
+        return header.num_edges > INT_MAX;
+
+    // otherwise it has to be a text graph
+    text_graph_file file;
+    open_text_graph(filename, &file);
+    close_text_graph(&file);
+    return file.num_edges > INT_MAX;
+}
 
-    if (fwrite(header, sizeof(int), 3, output) != 3) {
-        fprintf(stderr, "Error writing header.\n");
+static void write_array(FILE* output, const void* data, size_t size, size_t count,
+                        const char* what)
+{
+    if (fwrite(data, size, count, output) != count) {
+        fprintf(stderr, "Error writing %s.\n", what);
         exit(1);
     }
+}
 
-    if (fwrite(graph->outgoing_starts, sizeof(int), graph->num_nodes, output) != (size_t) graph->num_nodes) {
-        fprintf(stderr, "Error writing nodes.\n");
-        exit(1);
+// Pads the file with zeros from an array of the given byte size up to
+// the next multiple of alignment.
+static void write_padding(FILE* output, uint64_t written, uint64_t alignment)
+{
+    static const char zeros[4096] = {0};
+    uint64_t padding = graph_file_align(written, alignment) - written;
+    while (padding > 0) {
+        size_t chunk = padding < sizeof(zeros) ? padding : sizeof(zeros);
+        write_array(output, zeros, 1, chunk, "padding");
+        padding -= chunk;
     }
+}
+
+// Writes a starts array (num_nodes offsets plus the num_edges
+// sentinel), padded to alignment.
+template <typename V, typename O>
+static void write_starts(FILE* output, const O* starts, V num_nodes, uint64_t alignment)
+{
+    write_array(output, starts, sizeof(O), (size_t) num_nodes + 1, "nodes");
+    write_padding(output, sizeof(O) * ((uint64_t) num_nodes + 1), alignment);
+}
+
+template <typename V, typename O>
+static void write_edges(FILE* output, const V* edges, O num_edges, uint64_t alignment)
+{
+    write_array(output, edges, sizeof(V), num_edges, "edges");
+    write_padding(output, sizeof(V) * (uint64_t) num_edges, alignment);
+}
+
+template <typename G>
+static void store_graph_binary_impl(const char* filename, const G* graph) {
+
+    using V = typename G::vertex_type;
+    using O = typename G::offset_type;
+
+    FILE* output = fopen(filename, "wb");
 
-    if (fwrite(graph->outgoing_edges, sizeof(int), graph->num_edges, output) != (size_t) graph->num_edges) {
-        fprintf(stderr, "Error writing edges.\n");
+    if (!output) {
+        fprintf(stderr, "Could not open: %s\n", filename);
         exit(1);
     }
 
+    graph_file_header header;
+    memset(&header, 0, sizeof(header));
+    graph_file_layout(&header, graph->num_nodes, graph->num_edges,
+                      sizeof(V), sizeof(O), sysconf(_SC_PAGESIZE));
+
+    write_array(output, &header, sizeof(header), 1, "header");
+    write_padding(output, sizeof(header), header.alignment);
+
+    write_starts(output, graph->outgoing_starts, graph->num_nodes, header.alignment);
+    write_edges(output, graph->outgoing_edges, graph->num_edges, header.alignment);
+    write_starts(output, graph->incoming_starts, graph->num_nodes, header.alignment);
+    write_edges(output, graph->incoming_edges, graph->num_edges, header.alignment);
+
     fclose(output);
 }
+
+void store_graph_binary(const char* filename, Graph graph) { store_graph_binary_impl(filename, graph); }
+void store_graph_binary(const char* filename, Graph64 graph) { store_graph_binary_impl(filename, graph); }
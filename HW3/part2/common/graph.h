@@ -1,50 +1,167 @@
 #ifndef __GRAPH_H__
 #define __GRAPH_H__
 
+#include <stddef.h>
+#include <stdint.h>
+
 using Vertex = int;
 
-struct graph
+struct edge_partition;
+
+// CSR graph, generic over the type of a vertex id and the type of an
+// edge offset (an index into the edges arrays).
+template <typename VertexT, typename OffsetT>
+struct basic_graph
 {
+    using vertex_type = VertexT;
+    using offset_type = OffsetT;
+
     // Number of edges in the graph
-    int num_edges;
+    OffsetT num_edges;
     // Number of vertices in the graph
-    int num_nodes;
+    VertexT num_nodes;
 
     // The node reached by vertex i's first outgoing edge is given by
-    // outgoing_edges[outgoing_starts[i]].  To iterate over all
+    // outgoing_edges[outgoing_starts[i]].  Both starts arrays hold
+    // num_nodes + 1 entries, the last one being num_edges, so vertex
+    // i's edges always end at starts[i + 1].  To iterate over all
     // outgoing edges, please see the top-down bfs implementation.
-    int* outgoing_starts;
-    Vertex* outgoing_edges;
+    OffsetT* outgoing_starts;
+    VertexT* outgoing_edges;
 
-    int* incoming_starts;
-    Vertex* incoming_edges;
+    OffsetT* incoming_starts;
+    VertexT* incoming_edges;
+
+    // When the graph was loaded from a v2 binary file, all four
+    // arrays above point into this read-only file mapping instead of
+    // owning their own heap buffers.
+    void* mapping;
+    size_t mapping_size;
+
+    // Cached by incoming_partition (see edge_partition.h), or NULL
+    edge_partition* incoming_partition;
 };
 
+// The compact layout: 32-bit vertex ids and 32-bit edge offsets.  Used
+// for every graph with fewer than 2^31 edges, and the only layout the
+// reference implementations understand.
+struct graph : basic_graph<Vertex, int> {};
+
+// 32-bit vertex ids with 64-bit edge offsets, for graphs with 2^31
+// edges or more.
+struct graph64 : basic_graph<Vertex, int64_t> {};
+
 using Graph = graph*;
+using Graph64 = graph64*;
 
-/* Getters */
-static inline int num_nodes(const Graph);
-static inline int num_edges(const Graph);
+// A vertex's neighbor list as a range, for use in range-based for loops
+template <typename V>
+struct vertex_range
+{
+    const V* first;
+    const V* last;
 
-static inline const Vertex* outgoing_begin(const Graph, Vertex);
-static inline const Vertex* outgoing_end(const Graph, Vertex);
-static inline int outgoing_size(const Graph, Vertex);
+    const V* begin() const { return first; }
+    const V* end() const { return last; }
+    size_t size() const { return last - first; }
+};
 
-static inline const Vertex* incoming_begin(const Graph, Vertex);
-static inline const Vertex* incoming_end(const Graph, Vertex);
-static inline int incoming_size(const Graph, Vertex);
+/* Getters */
+template <typename V, typename O>
+static inline V num_nodes(const basic_graph<V, O>*);
+template <typename V, typename O>
+static inline O num_edges(const basic_graph<V, O>*);
+
+template <typename V, typename O>
+static inline const V* outgoing_begin(const basic_graph<V, O>*, typename basic_graph<V, O>::vertex_type);
+template <typename V, typename O>
+static inline const V* outgoing_end(const basic_graph<V, O>*, typename basic_graph<V, O>::vertex_type);
+template <typename V, typename O>
+static inline O outgoing_size(const basic_graph<V, O>*, typename basic_graph<V, O>::vertex_type);
+
+template <typename V, typename O>
+static inline const V* incoming_begin(const basic_graph<V, O>*, typename basic_graph<V, O>::vertex_type);
+template <typename V, typename O>
+static inline const V* incoming_end(const basic_graph<V, O>*, typename basic_graph<V, O>::vertex_type);
+template <typename V, typename O>
+static inline O incoming_size(const basic_graph<V, O>*, typename basic_graph<V, O>::vertex_type);
+
+template <typename V, typename O>
+static inline vertex_range<V> outgoing_neighbors(const basic_graph<V, O>*, typename basic_graph<V, O>::vertex_type);
+template <typename V, typename O>
+static inline vertex_range<V> incoming_neighbors(const basic_graph<V, O>*, typename basic_graph<V, O>::vertex_type);
 
 
 /* IO */
+
+// Text (AdjacencyGraph) loaders.  load_graph fails on graphs with 2^31
+// edges or more; use load_graph64 for those.
 Graph load_graph(const char* filename);
+Graph64 load_graph64(const char* filename);
+
+// Loads either binary format: v1 files (0xDEADBEEF header, outgoing
+// CSR only) are read into the heap and get their incoming CSR rebuilt,
+// v2 files are mmap'ed read-only with no copy when their index widths
+// match the requested layout, and widened on load otherwise.
 Graph load_graph_binary(const char* filename);
+Graph64 load_graph_binary64(const char* filename);
+
+// Checks a binary graph file without loading it: its header, layout and
+// the contents of its CSR arrays (offsets that never decrease, edges to
+// valid vertices).  NULL if load_graph_binary64 accepts it (and
+// load_graph_binary too, unless graph_file_needs_wide_offsets), else
+// what is wrong.  The loaders exit on bad files; this lets long-running
+// callers refuse them instead.
+const char* binary_graph_file_error(const char* filename);
+
+// True if the text or binary graph file has too many edges for the
+// compact layout, i.e. it must be loaded as a graph64.
+bool graph_file_needs_wide_offsets(const char* filename);
+
+// Always writes the v2 format, see graph_binary.h for the layout.  The
+// offset width on disk matches the in-memory layout.
 void store_graph_binary(const char* filename, Graph);
+void store_graph_binary(const char* filename, Graph64);
 
 void print_graph(const graph*);
+void print_graph(const graph64*);
+
+
+/* Construction */
+
+// Builds incoming_starts/incoming_edges from the outgoing CSR.  Each
+// incoming list comes out sorted by source vertex.
+void build_incoming_edges(Graph);
+void build_incoming_edges(Graph64);
+
+
+/* Vertex relabeling */
+
+// Returns a copy of the graph with vertex v renamed to new_ids[v].
+// new_ids must be a permutation of [0, num_nodes).  Neighbor lists of
+// the result are sorted.
+Graph permute_graph(const graph*, const Vertex* new_ids);
+Graph64 permute_graph(const graph64*, const Vertex* new_ids);
+
+// Permutation files hold the new_ids array of a relabeled graph, so
+// results computed on it can be mapped back to the original ids.
+void store_permutation(const char* filename, const Vertex* new_ids, Vertex num_nodes);
+Vertex* load_permutation(const char* filename, Vertex* num_nodes);
+
+// Maps a per-vertex result computed on a relabeled graph back to the
+// original vertex ids: original[v] = relabeled[new_ids[v]].
+template <typename T>
+void unpermute(const T* relabeled, T* original, const Vertex* new_ids, Vertex num_nodes)
+{
+    #pragma omp parallel for schedule(static)
+    for (Vertex v = 0; v < num_nodes; v++)
+        original[v] = relabeled[new_ids[v]];
+}
 
 
 /* Deallocation */
 void free_graph(Graph);
+void free_graph(Graph64);
 
 
 /* Included here to enable inlining. Don't look. */
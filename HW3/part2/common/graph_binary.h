@@ -0,0 +1,102 @@
+#ifndef __GRAPH_BINARY_H__
+#define __GRAPH_BINARY_H__
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+// Legacy (v1) binary graph files start with this token, followed by
+// num_nodes, num_edges, the num_nodes outgoing starts and the
+// outgoing edges, all as 32-bit ints.
+#define GRAPH_HEADER_TOKEN ((int) 0xDEADBEEF)
+
+// v2 binary graph files start with this token.  The file stores both
+// CSR directions and every array begins on a page boundary, so the
+// whole file can be mmap'ed and used in place:
+//
+//   [header, zero padded to alignment]
+//   outgoing_starts  (num_nodes + 1 offsets, last one == num_edges)
+//   outgoing_edges   (num_edges vertex ids)
+//   incoming_starts  (num_nodes + 1 offsets, last one == num_edges)
+//   incoming_edges   (num_edges vertex ids)
+//
+// Each array is zero padded up to the next multiple of alignment.
+#define GRAPH_HEADER_TOKEN_V2 ((int) 0xDEADBEF2)
+#define GRAPH_FORMAT_VERSION 2
+
+// Permutation files (see store_permutation) start with this token,
+// followed by the vertex count as an int64 and the new_ids array.
+#define PERMUTATION_HEADER_TOKEN ((int64_t) 0x5045524d55544531)
+
+struct graph_file_header
+{
+    int32_t token;
+    uint32_t version;
+    // Width in bytes of a vertex id and of an edge offset
+    uint32_t vertex_bytes;
+    uint32_t offset_bytes;
+    uint64_t num_nodes;
+    uint64_t num_edges;
+    uint64_t alignment;
+    // Byte offsets of the four arrays from the start of the file
+    uint64_t outgoing_starts_offset;
+    uint64_t outgoing_edges_offset;
+    uint64_t incoming_starts_offset;
+    uint64_t incoming_edges_offset;
+    // Total file size, used to detect truncated files
+    uint64_t file_size;
+};
+
+static inline uint64_t graph_file_align(uint64_t size, uint64_t alignment)
+{
+    return (size + alignment - 1) / alignment * alignment;
+}
+
+// Fills in every field of a v2 header from the graph dimensions.
+static inline void graph_file_layout(graph_file_header* header,
+                                     uint64_t num_nodes, uint64_t num_edges,
+                                     uint32_t vertex_bytes, uint32_t offset_bytes,
+                                     uint64_t alignment)
+{
+    uint64_t starts_size = graph_file_align((num_nodes + 1) * offset_bytes, alignment);
+    uint64_t edges_size = graph_file_align(num_edges * vertex_bytes, alignment);
+
+    header->token = GRAPH_HEADER_TOKEN_V2;
+    header->version = GRAPH_FORMAT_VERSION;
+    header->vertex_bytes = vertex_bytes;
+    header->offset_bytes = offset_bytes;
+    header->num_nodes = num_nodes;
+    header->num_edges = num_edges;
+    header->alignment = alignment;
+    header->outgoing_starts_offset = graph_file_align(sizeof(graph_file_header), alignment);
+    header->outgoing_edges_offset = header->outgoing_starts_offset + starts_size;
+    header->incoming_starts_offset = header->outgoing_edges_offset + edges_size;
+    header->incoming_edges_offset = header->incoming_starts_offset + starts_size;
+    header->file_size = header->incoming_edges_offset + edges_size;
+}
+
+// True if header is exactly what graph_file_layout writes for its own
+// dimensions, widths and alignment, and the file (file_size bytes) holds
+// all of it.  Loaders check this before trusting any array offset.
+static inline bool graph_file_layout_matches(const graph_file_header* header, uint64_t file_size)
+{
+    uint64_t alignment = header->alignment;
+    if (alignment == 0 || (alignment & (alignment - 1)) != 0 || alignment > file_size)
+        return false;
+    if ((header->vertex_bytes != 4 && header->vertex_bytes != 8) ||
+        (header->offset_bytes != 4 && header->offset_bytes != 8))
+        return false;
+    // arrays larger than the file cannot fit; this also keeps the sizes
+    // computed by graph_file_layout from overflowing
+    if (header->num_nodes >= file_size / header->offset_bytes ||
+        header->num_edges > file_size / header->vertex_bytes)
+        return false;
+
+    graph_file_header expected;
+    memset(&expected, 0, sizeof(expected));
+    graph_file_layout(&expected, header->num_nodes, header->num_edges,
+                      header->vertex_bytes, header->offset_bytes, alignment);
+    return memcmp(&expected, header, sizeof(expected)) == 0 && expected.file_size <= file_size;
+}
+
+#endif /* __GRAPH_BINARY_H__ */
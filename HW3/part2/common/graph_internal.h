@@ -4,68 +4,84 @@
 #include <stdlib.h>
 #include "contracts.h"
 
-static inline int num_nodes(const Graph graph)
+template <typename V, typename O>
+static inline V num_nodes(const basic_graph<V, O>* graph)
 {
   REQUIRES(graph != NULL);
   return graph->num_nodes;
 }
 
-static inline int num_edges(const Graph graph)
+template <typename V, typename O>
+static inline O num_edges(const basic_graph<V, O>* graph)
 {
   REQUIRES(graph != NULL);
   return graph->num_edges;
 }
 
-static inline const Vertex* outgoing_begin(const Graph g, Vertex v)
+template <typename V, typename O>
+static inline const V* outgoing_begin(const basic_graph<V, O>* g, typename basic_graph<V, O>::vertex_type v)
 {
   REQUIRES(g != NULL);
   REQUIRES(0 <= v && v < num_nodes(g));
   return g->outgoing_edges + g->outgoing_starts[v];
 }
 
-static inline const Vertex* outgoing_end(const Graph g, Vertex v)
+template <typename V, typename O>
+static inline const V* outgoing_end(const basic_graph<V, O>* g, typename basic_graph<V, O>::vertex_type v)
 {
   REQUIRES(g != NULL);
   REQUIRES(0 <= v && v < num_nodes(g));
-  int offset = (v == g->num_nodes - 1) ? g->num_edges : g->outgoing_starts[v + 1];
-  return g->outgoing_edges + offset;
+  return g->outgoing_edges + g->outgoing_starts[v + 1];
 }
 
-static inline int outgoing_size(const Graph g, Vertex v)
+template <typename V, typename O>
+static inline O outgoing_size(const basic_graph<V, O>* g, typename basic_graph<V, O>::vertex_type v)
 {
   REQUIRES(g != NULL);
   REQUIRES(0 <= v && v < num_nodes(g));
-  if (v == g->num_nodes - 1) {
-    return g->num_edges - g->outgoing_starts[v];
-  } else {
-    return g->outgoing_starts[v + 1] - g->outgoing_starts[v];
-  }
+  return g->outgoing_starts[v + 1] - g->outgoing_starts[v];
 }
 
-static inline const Vertex* incoming_begin(const Graph g, Vertex v)
+template <typename V, typename O>
+static inline const V* incoming_begin(const basic_graph<V, O>* g, typename basic_graph<V, O>::vertex_type v)
 {
   REQUIRES(g != NULL);
   REQUIRES(0 <= v && v < num_nodes(g));
   return g->incoming_edges + g->incoming_starts[v];
 }
 
-static inline const Vertex* incoming_end(const Graph g, Vertex v)
+template <typename V, typename O>
+static inline const V* incoming_end(const basic_graph<V, O>* g, typename basic_graph<V, O>::vertex_type v)
 {
   REQUIRES(g != NULL);
   REQUIRES(0 <= v && v < num_nodes(g));
-  int offset = (v == g->num_nodes - 1) ? g->num_edges : g->incoming_starts[v + 1];
-  return g->incoming_edges + offset;
+  return g->incoming_edges + g->incoming_starts[v + 1];
 }
 
-static inline int incoming_size(const Graph g, Vertex v)
+template <typename V, typename O>
+static inline O incoming_size(const basic_graph<V, O>* g, typename basic_graph<V, O>::vertex_type v)
 {
   REQUIRES(g != NULL);
   REQUIRES(0 <= v && v < num_nodes(g));
-  if (v == g->num_nodes - 1) {
-    return g->num_edges - g->incoming_starts[v];
-  } else {
-    return g->incoming_starts[v + 1] - g->incoming_starts[v];
-  }
+  return g->incoming_starts[v + 1] - g->incoming_starts[v];
+}
+
+template <typename V, typename O>
+static inline vertex_range<V> outgoing_neighbors(const basic_graph<V, O>* g, typename basic_graph<V, O>::vertex_type v)
+{
+  REQUIRES(g != NULL);
+  REQUIRES(0 <= v && v < num_nodes(g));
+  return vertex_range<V>{ g->outgoing_edges + g->outgoing_starts[v],
+                          g->outgoing_edges + g->outgoing_starts[v + 1] };
+}
+
+template <typename V, typename O>
+static inline vertex_range<V> incoming_neighbors(const basic_graph<V, O>* g, typename basic_graph<V, O>::vertex_type v)
+{
+  REQUIRES(g != NULL);
+  REQUIRES(0 <= v && v < num_nodes(g));
+  return vertex_range<V>{ g->incoming_edges + g->incoming_starts[v],
+                          g->incoming_edges + g->incoming_starts[v + 1] };
 }
 
 #endif // __GRAPH_INTERNAL_H__
@@ -0,0 +1,303 @@
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <string_view>
+
+#include <linux/mempolicy.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <omp.h>
+
+#include "memory_policy.h"
+
+#define HUGE_PAGE_SIZE ((size_t) 2 << 20)
+#ifndef MAP_HUGE_2MB
+#define MAP_HUGE_2MB (21 << 26)
+#endif
+
+// Room for 1024 NUMA nodes in mbind/get_mempolicy masks
+#define NODE_MASK_WORDS 16
+#define NODE_MASK_BITS (NODE_MASK_WORDS * 8 * sizeof(unsigned long))
+
+// Every allocation is preceded by this header, one cache line long, so
+// policy_free knows how the block was obtained.
+struct alloc_header
+{
+    // size of the mapping starting at the header, or 0 for malloc
+    uint64_t mapped_bytes;
+    uint64_t padding[7];
+};
+
+static memory_policy current_policy = { PLACEMENT_DEFAULT, PAGES_DEFAULT };
+
+// Bytes handed out with each outcome, for print_memory_policy_report
+static struct
+{
+    uint64_t interleaved;
+    uint64_t first_touch;
+    uint64_t default_placement;
+    uint64_t interleave_refused;
+    uint64_t explicit_huge;
+    uint64_t transparent_huge;
+    uint64_t small_pages;
+    uint64_t explicit_huge_refused;
+    uint64_t file_mapped;
+} applied;
+
+static void count(uint64_t* counter, uint64_t bytes)
+{
+    __sync_fetch_and_add(counter, bytes);
+}
+
+static const char* placement_name(page_placement placement)
+{
+    switch (placement) {
+    case PLACEMENT_INTERLEAVE: return "interleave";
+    case PLACEMENT_FIRST_TOUCH: return "local";
+    default: return "default";
+    }
+}
+
+static const char* backing_name(page_backing pages)
+{
+    switch (pages) {
+    case PAGES_TRANSPARENT_HUGE: return "thp";
+    case PAGES_EXPLICIT_HUGE: return "huge";
+    default: return "small";
+    }
+}
+
+bool parse_memory_policy(const char* spec, memory_policy* policy)
+{
+    memory_policy result = { PLACEMENT_DEFAULT, PAGES_DEFAULT };
+    std::string_view rest(spec);
+
+    while (!rest.empty()) {
+        size_t comma = rest.find(',');
+        std::string_view word = rest.substr(0, comma);
+        rest = comma == std::string_view::npos ? std::string_view() : rest.substr(comma + 1);
+
+        if (word == "default")
+            result.placement = PLACEMENT_DEFAULT;
+        else if (word == "interleave")
+            result.placement = PLACEMENT_INTERLEAVE;
+        else if (word == "local")
+            result.placement = PLACEMENT_FIRST_TOUCH;
+        else if (word == "small")
+            result.pages = PAGES_DEFAULT;
+        else if (word == "thp")
+            result.pages = PAGES_TRANSPARENT_HUGE;
+        else if (word == "huge")
+            result.pages = PAGES_EXPLICIT_HUGE;
+        else
+            return false;
+    }
+
+    *policy = result;
+    return true;
+}
+
+void set_memory_policy(const memory_policy* policy)
+{
+    current_policy = *policy;
+}
+
+memory_policy get_memory_policy()
+{
+    return current_policy;
+}
+
+bool memory_policy_is_default()
+{
+    return current_policy.placement == PLACEMENT_DEFAULT && current_policy.pages == PAGES_DEFAULT;
+}
+
+static size_t align_up(size_t size, size_t alignment)
+{
+    return (size + alignment - 1) / alignment * alignment;
+}
+
+// Fills mask with the nodes this process may allocate on and returns
+// how many there are, or 0 if the kernel would not say.
+static int allowed_nodes(unsigned long* mask)
+{
+    memset(mask, 0, sizeof(unsigned long) * NODE_MASK_WORDS);
+    if (syscall(SYS_get_mempolicy, NULL, mask, NODE_MASK_BITS, NULL, MPOL_F_MEMS_ALLOWED) != 0)
+        return 0;
+
+    int nodes = 0;
+    for (int w = 0; w < NODE_MASK_WORDS; w++)
+        nodes += __builtin_popcountl(mask[w]);
+    return nodes;
+}
+
+// Maps an anonymous region of at least bytes with the page size asked
+// for by the current policy.  Blocks smaller than a huge page always
+// get small pages.
+static char* map_pages(size_t bytes, size_t* mapped)
+{
+    int protection = PROT_READ | PROT_WRITE;
+    int flags = MAP_PRIVATE | MAP_ANONYMOUS;
+    bool huge = current_policy.pages != PAGES_DEFAULT && bytes >= HUGE_PAGE_SIZE;
+
+    if (huge && current_policy.pages == PAGES_EXPLICIT_HUGE) {
+        size_t size = align_up(bytes, HUGE_PAGE_SIZE);
+        void* p = mmap(NULL, size, protection, flags | MAP_HUGETLB | MAP_HUGE_2MB, -1, 0);
+        if (p != MAP_FAILED) {
+            count(&applied.explicit_huge, bytes);
+            *mapped = size;
+            return (char*) p;
+        }
+        count(&applied.explicit_huge_refused, bytes);
+    }
+
+    if (huge) {
+        // over-allocate, then trim the region to a huge page boundary so
+        // khugepaged can back all of it
+        size_t size = align_up(bytes, HUGE_PAGE_SIZE);
+        char* raw = (char*) mmap(NULL, size + HUGE_PAGE_SIZE, protection, flags, -1, 0);
+        if (raw == MAP_FAILED)
+            return NULL;
+
+        char* p = (char*) align_up((size_t) raw, HUGE_PAGE_SIZE);
+        if (p > raw)
+            munmap(raw, p - raw);
+        if (raw + HUGE_PAGE_SIZE > p)
+            munmap(p + size, raw + HUGE_PAGE_SIZE - p);
+
+        if (madvise(p, size, MADV_HUGEPAGE) == 0)
+            count(&applied.transparent_huge, bytes);
+        else
+            count(&applied.small_pages, bytes);
+        *mapped = size;
+        return p;
+    }
+
+    size_t size = align_up(bytes, sysconf(_SC_PAGESIZE));
+    void* p = mmap(NULL, size, protection, flags, -1, 0);
+    if (p == MAP_FAILED)
+        return NULL;
+    count(&applied.small_pages, bytes);
+    *mapped = size;
+    return (char*) p;
+}
+
+// Touches every page of the region from a static OpenMP schedule, so
+// the same threads that later run schedule(static) loops over the array
+// fault its pages in on their own nodes.  Allocations know nothing of
+// the graph, so this cannot follow the edge_partition ranges that the
+// dynamically scheduled kernels use (see PLACEMENT_FIRST_TOUCH).
+static void touch_pages(char* base, size_t bytes)
+{
+    long page = sysconf(_SC_PAGESIZE);
+    long pages = (bytes + page - 1) / page;
+
+    #pragma omp parallel for schedule(static)
+    for (long i = 0; i < pages; i++)
+        base[i * page] = 0;
+}
+
+void* policy_alloc(size_t bytes)
+{
+    size_t total = bytes + sizeof(alloc_header);
+
+    if (memory_policy_is_default()) {
+        alloc_header* header = (alloc_header*) malloc(total);
+        if (!header) {
+            fprintf(stderr, "Out of memory allocating %zu bytes.\n", bytes);
+            exit(1);
+        }
+        header->mapped_bytes = 0;
+        count(&applied.default_placement, bytes);
+        count(&applied.small_pages, bytes);
+        return header + 1;
+    }
+
+    size_t mapped = 0;
+    char* base = map_pages(total, &mapped);
+    if (!base) {
+        fprintf(stderr, "Out of memory mapping %zu bytes.\n", bytes);
+        exit(1);
+    }
+
+    // placement has to be settled before anything (including the
+    // header) touches the pages
+    if (current_policy.placement == PLACEMENT_INTERLEAVE) {
+        unsigned long mask[NODE_MASK_WORDS];
+        if (allowed_nodes(mask) > 0 &&
+            syscall(SYS_mbind, base, mapped, MPOL_INTERLEAVE, mask, NODE_MASK_BITS, 0) == 0)
+            count(&applied.interleaved, bytes);
+        else
+            count(&applied.interleave_refused, bytes);
+    } else if (current_policy.placement == PLACEMENT_FIRST_TOUCH) {
+        touch_pages(base, mapped);
+        count(&applied.first_touch, bytes);
+    } else {
+        count(&applied.default_placement, bytes);
+    }
+
+    alloc_header* header = (alloc_header*) base;
+    header->mapped_bytes = mapped;
+    return header + 1;
+}
+
+void policy_free(void* ptr)
+{
+    if (!ptr)
+        return;
+
+    alloc_header* header = (alloc_header*) ptr - 1;
+    if (header->mapped_bytes == 0)
+        free(header);
+    else
+        munmap(header, header->mapped_bytes);
+}
+
+void policy_note_file_mapping(size_t bytes)
+{
+    count(&applied.file_mapped, bytes);
+}
+
+// Reads the bracketed mode out of the transparent huge page sysfs knob
+static void transparent_huge_page_mode(char* mode, size_t size)
+{
+    snprintf(mode, size, "unknown");
+    FILE* f = fopen("/sys/kernel/mm/transparent_hugepage/enabled", "r");
+    if (!f)
+        return;
+
+    char line[128];
+    if (fgets(line, sizeof(line), f)) {
+        char* open = strchr(line, '[');
+        char* close = open ? strchr(open, ']') : NULL;
+        if (open && close)
+            snprintf(mode, size, "%.*s", (int)(close - open - 1), open + 1);
+    }
+    fclose(f);
+}
+
+void print_memory_policy_report(FILE* out)
+{
+    const double MB = 1 << 20;
+    unsigned long mask[NODE_MASK_WORDS];
+    char thp_mode[32];
+    transparent_huge_page_mode(thp_mode, sizeof(thp_mode));
+
+    fprintf(out, "Memory policy: placement=%s pages=%s\n",
+            placement_name(current_policy.placement), backing_name(current_policy.pages));
+    fprintf(out, "  NUMA nodes allowed: %d, transparent huge pages: %s\n",
+            allowed_nodes(mask), thp_mode);
+    fprintf(out, "  Placement: %.1f MB interleaved, %.1f MB first touch, %.1f MB default",
+            applied.interleaved / MB, applied.first_touch / MB, applied.default_placement / MB);
+    if (applied.interleave_refused)
+        fprintf(out, ", %.1f MB refused interleaving", applied.interleave_refused / MB);
+    fprintf(out, "\n");
+    fprintf(out, "  Pages: %.1f MB explicit 2MB, %.1f MB transparent huge, %.1f MB small",
+            applied.explicit_huge / MB, applied.transparent_huge / MB, applied.small_pages / MB);
+    if (applied.explicit_huge_refused)
+        fprintf(out, ", %.1f MB fell back from explicit huge pages", applied.explicit_huge_refused / MB);
+    fprintf(out, "\n");
+    if (applied.file_mapped)
+        fprintf(out, "  File mapped in place (page cache, no policy): %.1f MB\n", applied.file_mapped / MB);
+}
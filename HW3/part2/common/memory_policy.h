@@ -0,0 +1,63 @@
+#ifndef __MEMORY_POLICY_H__
+#define __MEMORY_POLICY_H__
+
+#include <stddef.h>
+#include <stdio.h>
+
+// How the pages of large arrays are spread over NUMA nodes
+enum page_placement
+{
+    // whatever the kernel does, usually first touch by the loading thread
+    PLACEMENT_DEFAULT,
+    // pages interleaved round-robin over all allowed nodes (mbind)
+    PLACEMENT_INTERLEAVE,
+    // pages touched in parallel with a static OpenMP schedule, so each
+    // thread's share of a schedule(static) vertex loop lands on its own
+    // node.  The pull PageRank loop and bottom-up BFS steps hand out
+    // edge_partition ranges dynamically instead, so for them this only
+    // spreads the pages over the nodes, like interleave.
+    PLACEMENT_FIRST_TOUCH,
+};
+
+// Page size used to back large arrays
+enum page_backing
+{
+    PAGES_DEFAULT,
+    // 2MB-aligned mapping with madvise(MADV_HUGEPAGE)
+    PAGES_TRANSPARENT_HUGE,
+    // MAP_HUGETLB 2MB pages from the hugetlbfs pool; falls back to
+    // transparent huge pages when the pool is empty
+    PAGES_EXPLICIT_HUGE,
+};
+
+struct memory_policy
+{
+    page_placement placement;
+    page_backing pages;
+};
+
+// Parses a comma separated list such as "interleave,thp".  Placements
+// are default, interleave and local; page sizes are small, thp and
+// huge.  Returns false on an unknown word.
+bool parse_memory_policy(const char* spec, memory_policy* policy);
+
+// Sets the policy used by every later policy_alloc, including the ones
+// made by the graph loaders.  Select it before loading the graph.
+void set_memory_policy(const memory_policy* policy);
+memory_policy get_memory_policy();
+bool memory_policy_is_default();
+
+// Allocates bytes under the current policy.  The memory is not zeroed
+// unless the policy touches it.  Only release it with policy_free.
+void* policy_alloc(size_t bytes);
+void policy_free(void* ptr);
+
+// Records bytes used in place from a read-only file mapping, which no
+// policy applies to, so the report accounts for them.
+void policy_note_file_mapping(size_t bytes);
+
+// Prints the requested policy and what was actually applied, by bytes:
+// interleaving or huge pages can be refused by the kernel.
+void print_memory_policy_report(FILE* out);
+
+#endif /* __MEMORY_POLICY_H__ */
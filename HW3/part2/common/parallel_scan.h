@@ -0,0 +1,55 @@
+#ifndef __PARALLEL_SCAN_H__
+#define __PARALLEL_SCAN_H__
+
+#include <stdlib.h>
+#include <omp.h>
+
+// Exclusive prefix sum of in[0..n) into out[0..n), returning the
+// total.  Each thread scans one contiguous block, then the block sums
+// are scanned serially and added back in a second parallel pass.  in
+// and out may alias.  block_sums is scratch for omp_get_max_threads()
+// + 1 values; callers on a hot path pass their own, otherwise it is
+// allocated.
+template <typename T>
+static T parallel_exclusive_scan(const T* in, T* out, long n, T* block_sums = NULL)
+{
+    int num_threads = omp_get_max_threads();
+    T* allocated = block_sums ? NULL : (T*)malloc(sizeof(T) * (num_threads + 1));
+    if (allocated)
+        block_sums = allocated;
+    block_sums[0] = 0;
+    T total = 0;
+
+    #pragma omp parallel num_threads(num_threads)
+    {
+        int tid = omp_get_thread_num();
+        int threads = omp_get_num_threads();
+        long begin = n * tid / threads;
+        long end = n * (tid + 1) / threads;
+
+        T sum = 0;
+        for (long i = begin; i < end; i++) {
+            T value = in[i];
+            out[i] = sum;
+            sum += value;
+        }
+        block_sums[tid + 1] = sum;
+
+        #pragma omp barrier
+        #pragma omp single
+        {
+            for (int t = 1; t <= threads; t++)
+                block_sums[t] += block_sums[t - 1];
+            total = block_sums[threads];
+        }
+
+        T offset = block_sums[tid];
+        for (long i = begin; i < end; i++)
+            out[i] += offset;
+    }
+
+    free(allocated);
+    return total;
+}
+
+#endif /* __PARALLEL_SCAN_H__ */
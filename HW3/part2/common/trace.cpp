@@ -0,0 +1,154 @@
+#include "trace.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#include "CycleTimer.h"
+
+bool trace_is_enabled = false;
+
+static double trace_origin;
+static int trace_runs;
+static std::vector<trace_step> steps;
+static std::vector<double> busy_slots;
+
+void trace_enable(bool enable)
+{
+    if (enable && !trace_is_enabled)
+        trace_origin = CycleTimer::currentSeconds();
+    trace_is_enabled = enable;
+}
+
+int trace_begin_run()
+{
+    return trace_runs++;
+}
+
+double* trace_busy_slots(int num_threads)
+{
+    if (!trace_is_enabled)
+        return NULL;
+    busy_slots.assign(num_threads, 0.0);
+    return busy_slots.data();
+}
+
+double trace_now()
+{
+    return CycleTimer::currentSeconds() - trace_origin;
+}
+
+void trace_record(const char* name, int run, int step, long frontier, long edges, const char* direction,
+                  double residual, double start, double seconds)
+{
+    if (!trace_is_enabled)
+        return;
+
+    trace_step s;
+    s.name = name;
+    s.run = run;
+    s.step = step;
+    s.frontier = frontier;
+    s.edges = edges;
+    s.direction = direction;
+    s.residual = residual;
+    s.start = start;
+    s.seconds = seconds;
+    s.busy = busy_slots;
+    steps.push_back(s);
+    busy_slots.clear();
+}
+
+const std::vector<trace_step>& trace_steps()
+{
+    return steps;
+}
+
+void trace_clear()
+{
+    steps.clear();
+    trace_runs = 0;
+}
+
+void trace_write_json(FILE* out)
+{
+    fprintf(out, "[\n");
+    for (size_t i = 0; i < steps.size(); i++) {
+        const trace_step& s = steps[i];
+        fprintf(out, "  {\"name\": \"%s\", \"run\": %d, \"step\": %d, \"frontier\": %ld, \"edges\": %ld, "
+                "\"direction\": \"%s\", \"residual\": %.9g, \"start\": %.9f, \"seconds\": %.9f, \"busy\": [",
+                s.name, s.run, s.step, s.frontier, s.edges, s.direction, s.residual, s.start, s.seconds);
+        for (size_t t = 0; t < s.busy.size(); t++)
+            fprintf(out, "%s%.9f", t ? ", " : "", s.busy[t]);
+        fprintf(out, "]}%s\n", i + 1 < steps.size() ? "," : "");
+    }
+    fprintf(out, "]\n");
+}
+
+void trace_write_csv(FILE* out)
+{
+    // busy times are one column, separated by semicolons, as the thread
+    // count differs between runs
+    fprintf(out, "name,run,step,frontier,edges,direction,residual,start,seconds,busy\n");
+    for (const trace_step& s : steps) {
+        fprintf(out, "%s,%d,%d,%ld,%ld,%s,%.9g,%.9f,%.9f,", s.name, s.run, s.step, s.frontier, s.edges,
+                s.direction, s.residual, s.start, s.seconds);
+        for (size_t t = 0; t < s.busy.size(); t++)
+            fprintf(out, "%s%.9f", t ? ";" : "", s.busy[t]);
+        fprintf(out, "\n");
+    }
+}
+
+void trace_write_chrome(FILE* out)
+{
+    // times are in microseconds; each run is a process, its wall track
+    // is thread 0 and thread t's busy track is thread t + 1
+    fprintf(out, "{\"traceEvents\": [\n");
+    bool first = true;
+    int named_run = -1;
+
+    for (const trace_step& s : steps) {
+        if (s.run != named_run) {
+            fprintf(out, "%s  {\"ph\": \"M\", \"name\": \"process_name\", \"pid\": %d, \"args\": {\"name\": \"%s #%d\"}},\n",
+                    first ? "" : ",\n", s.run, s.name, s.run);
+            fprintf(out, "  {\"ph\": \"M\", \"name\": \"thread_name\", \"pid\": %d, \"tid\": 0, \"args\": {\"name\": \"wall\"}}",
+                    s.run);
+            for (size_t t = 0; t < s.busy.size(); t++)
+                fprintf(out, ",\n  {\"ph\": \"M\", \"name\": \"thread_name\", \"pid\": %d, \"tid\": %zu, "
+                        "\"args\": {\"name\": \"thread %zu\"}}", s.run, t + 1, t);
+            named_run = s.run;
+            first = false;
+        }
+
+        fprintf(out, "%s  {\"ph\": \"X\", \"name\": \"%s %d\", \"cat\": \"%s\", \"pid\": %d, \"tid\": 0, "
+                "\"ts\": %.3f, \"dur\": %.3f, \"args\": {\"frontier\": %ld, \"edges\": %ld, \"residual\": %.9g}}",
+                first ? "" : ",\n", s.direction, s.step, s.name, s.run, s.start * 1e6, s.seconds * 1e6,
+                s.frontier, s.edges, s.residual);
+        first = false;
+
+        for (size_t t = 0; t < s.busy.size(); t++)
+            fprintf(out, ",\n  {\"ph\": \"X\", \"name\": \"%s %d\", \"cat\": \"%s\", \"pid\": %d, \"tid\": %zu, "
+                    "\"ts\": %.3f, \"dur\": %.3f}",
+                    s.direction, s.step, s.name, s.run, t + 1, s.start * 1e6, s.busy[t] * 1e6);
+    }
+    fprintf(out, "\n]}\n");
+}
+
+void trace_save(const char* filename, bool chrome)
+{
+    FILE* out = fopen(filename, "w");
+    if (!out) {
+        fprintf(stderr, "Could not write trace %s: %s\n", filename, strerror(errno));
+        exit(1);
+    }
+
+    size_t length = strlen(filename);
+    if (chrome)
+        trace_write_chrome(out);
+    else if (length >= 4 && strcmp(filename + length - 4, ".csv") == 0)
+        trace_write_csv(out);
+    else
+        trace_write_json(out);
+
+    fclose(out);
+}
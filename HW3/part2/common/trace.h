@@ -0,0 +1,80 @@
+#ifndef __TRACE_H__
+#define __TRACE_H__
+
+#include <stdio.h>
+
+#include <vector>
+
+// Per-step tracing of the graph kernels: one record per BFS level or
+// PageRank iteration.  Tracing is compiled in and off by default; while
+// off, a traced kernel pays a flag test and a clock read per step.
+
+// One BFS level or PageRank iteration
+struct trace_step
+{
+    // kernel, e.g. "bfs_hybrid" or "pagerank"
+    const char* name;
+    // which traced call of any kernel this step belongs to
+    int run;
+    // BFS level or PageRank iteration
+    int step;
+    // vertices on the frontier the level expanded; for PageRank, the
+    // vertices updated
+    long frontier;
+    // edges the step examined
+    long edges;
+    // "top-down", "bottom-up", "pull" or "push"
+    const char* direction;
+    // PageRank: sum of the score changes; 0 for BFS
+    double residual;
+    // seconds from trace_enable to the start of the step, and its length
+    double start;
+    double seconds;
+    // seconds each thread spent working in the step's parallel loops,
+    // excluding the time it waited for the others
+    std::vector<double> busy;
+};
+
+// Set by trace_enable; read through trace_enabled
+extern bool trace_is_enabled;
+
+void trace_enable(bool enable);
+
+static inline bool trace_enabled()
+{
+    return trace_is_enabled;
+}
+
+// Starts a traced kernel call and returns its run number
+int trace_begin_run();
+
+// Zeroed per-thread busy time counters for the step about to run, or
+// NULL while tracing is off.  Each thread adds its own working time.
+double* trace_busy_slots(int num_threads);
+
+// Seconds since trace_enable, on the same clock as trace_step::start
+double trace_now();
+
+// Records a finished step, with the busy times from trace_busy_slots
+void trace_record(const char* name, int run, int step, long frontier, long edges, const char* direction,
+                  double residual, double start, double seconds);
+
+const std::vector<trace_step>& trace_steps();
+void trace_clear();
+
+// Writes every recorded step as a JSON array of objects or as CSV with
+// one row per step
+void trace_write_json(FILE* out);
+void trace_write_csv(FILE* out);
+
+// Writes the steps in the Chrome trace event format, for
+// chrome://tracing or ui.perfetto.dev: every step is a span on a "wall"
+// track, and each thread's busy time a span on the thread's own track
+// starting with the step, so stragglers stand out.
+void trace_write_chrome(FILE* out);
+
+// Writes the trace to filename, as CSV if it ends in ".csv" and as JSON
+// otherwise, or as a Chrome trace if chrome is set.  Exits on errors.
+void trace_save(const char* filename, bool chrome);
+
+#endif /* __TRACE_H__ */
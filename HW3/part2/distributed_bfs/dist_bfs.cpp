@@ -0,0 +1,344 @@
+#include "dist_bfs.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+
+#include "common/bitmap.h"
+
+#define NOT_VISITED_MARKER -1
+
+// A frontier list costs 32 bits per vertex and a bitmap one bit per
+// vertex, so the column expansion sends the list while fewer than
+// 1/DIST_SPARSE_FACTOR of all vertices are on the frontier.
+#define DIST_SPARSE_FACTOR 32
+
+// Buffers kept across the levels of one search
+struct dist_bfs_state
+{
+    const dist_graph* graph;
+    const dist_layout* layout;
+
+    // owned vertices visited so far, and on the current frontier
+    std::vector<uint64_t> owned_visited;
+    std::vector<Vertex> frontier;
+    std::vector<uint64_t> owned_frontier_bits;
+
+    // the frontier of the whole processor column, by column-local id
+    std::vector<Vertex> column_list;
+    std::vector<uint64_t> column_bits;
+
+    // row-local vertices this rank has already sent to their owners,
+    // and the visited bitmaps of the whole processor row
+    std::vector<uint64_t> sent;
+    std::vector<uint64_t> row_visited;
+
+    // (row-local vertex, parent) pairs per processor in the row
+    std::vector<std::vector<Vertex>> outgoing;
+    std::vector<Vertex> send_buffer;
+    std::vector<Vertex> recv_buffer;
+
+    long long bytes_sent;
+};
+
+// Position in the row communicator of the owner of a row-local vertex
+static inline int row_owner(const dist_layout* layout, Vertex v)
+{
+    const Vertex* first = &layout->block_starts[layout->row * layout->cols];
+    Vertex global = layout->row_begin + v;
+    return std::upper_bound(first + 1, first + layout->cols, global) - (first + 1);
+}
+
+// Gathers the frontiers of the column's ranks as a list of column-local
+// ids into column_list
+static void expand_sparse(dist_bfs_state* s)
+{
+    const dist_layout* layout = s->layout;
+    int rows = layout->rows;
+    Vertex offset = layout->col_piece_starts[layout->row] - layout->owned_begin;
+
+    std::vector<Vertex> mine(s->frontier.size());
+    for (size_t i = 0; i < s->frontier.size(); i++)
+        mine[i] = s->frontier[i] + offset;
+
+    int count = (int) mine.size();
+    std::vector<int> counts(rows), displs(rows);
+    MPI_Allgather(&count, 1, MPI_INT, counts.data(), 1, MPI_INT, layout->col_comm);
+
+    int total = 0;
+    for (int r = 0; r < rows; r++) {
+        displs[r] = total;
+        total += counts[r];
+    }
+    s->column_list.resize(total);
+    MPI_Allgatherv(mine.data(), count, MPI_INT, s->column_list.data(), counts.data(), displs.data(),
+                   MPI_INT, layout->col_comm);
+    s->bytes_sent += (long long) count * sizeof(Vertex) * (rows - 1);
+}
+
+// Gathers the frontiers of the column's ranks as a bitmap over column-local
+// ids into column_bits.  Every block but the graph's last is a whole
+// number of words, so the blocks' bitmaps line up end to end.
+static void expand_dense(dist_bfs_state* s)
+{
+    const dist_layout* layout = s->layout;
+    int rows = layout->rows;
+
+    std::fill(s->owned_frontier_bits.begin(), s->owned_frontier_bits.end(), 0);
+    for (Vertex v : s->frontier)
+        bitmap_set(s->owned_frontier_bits.data(), v - layout->owned_begin);
+
+    std::vector<int> counts(rows), displs(rows);
+    for (int r = 0; r < rows; r++) {
+        Vertex size = layout->col_piece_starts[r + 1] - layout->col_piece_starts[r];
+        counts[r] = (int) bitmap_words(size);
+        displs[r] = layout->col_piece_starts[r] / BITMAP_WORD_BITS;
+    }
+    MPI_Allgatherv(s->owned_frontier_bits.data(), counts[layout->row], MPI_UINT64_T, s->column_bits.data(),
+                   counts.data(), displs.data(), MPI_UINT64_T, layout->col_comm);
+    s->bytes_sent += (long long) counts[layout->row] * sizeof(uint64_t) * (rows - 1);
+}
+
+// Gathers the visited bitmaps of the row's ranks into row_visited
+static void gather_row_visited(dist_bfs_state* s)
+{
+    const dist_layout* layout = s->layout;
+    int cols = layout->cols;
+
+    std::vector<int> counts(cols), displs(cols);
+    for (int c = 0; c < cols; c++) {
+        int block = layout->row * cols + c;
+        counts[c] = (int) bitmap_words(layout->block_starts[block + 1] - layout->block_starts[block]);
+        displs[c] = (layout->block_starts[block] - layout->row_begin) / BITMAP_WORD_BITS;
+    }
+    MPI_Allgatherv(s->owned_visited.data(), counts[layout->col], MPI_UINT64_T, s->row_visited.data(),
+                   counts.data(), displs.data(), MPI_UINT64_T, layout->row_comm);
+    s->bytes_sent += (long long) counts[layout->col] * sizeof(uint64_t) * (cols - 1);
+}
+
+static inline void send_discovery(dist_bfs_state* s, Vertex v, Vertex parent)
+{
+    std::vector<Vertex>& out = s->outgoing[row_owner(s->layout, v)];
+    out.push_back(v);
+    out.push_back(parent);
+}
+
+static void top_down_local(dist_bfs_state* s, bool sparse)
+{
+    const dist_graph* g = s->graph;
+    const dist_layout* layout = s->layout;
+    uint64_t* sent = s->sent.data();
+
+    auto explore = [&](Vertex u) {
+        Vertex parent = -1;
+        for (int64_t e = g->out_starts[u]; e < g->out_starts[u + 1]; e++) {
+            Vertex v = g->out_edges[e];
+            if (bitmap_test(sent, v))
+                continue;
+            bitmap_set(sent, v);
+            if (parent < 0)
+                parent = column_global_id(layout, u);
+            send_discovery(s, v, parent);
+        }
+    };
+
+    if (sparse) {
+        for (Vertex u : s->column_list)
+            explore(u);
+    } else {
+        long words = s->column_bits.size();
+        for (long w = 0; w < words; w++) {
+            uint64_t bits = s->column_bits[w];
+            while (bits) {
+                explore(w * BITMAP_WORD_BITS + __builtin_ctzll(bits));
+                bits &= bits - 1;
+            }
+        }
+    }
+}
+
+static void bottom_up_local(dist_bfs_state* s)
+{
+    const dist_graph* g = s->graph;
+    const dist_layout* layout = s->layout;
+    const uint64_t* frontier = s->column_bits.data();
+    const uint64_t* visited = s->row_visited.data();
+    Vertex row_n = layout->row_end - layout->row_begin;
+
+    for (Vertex v = 0; v < row_n; v++) {
+        if (bitmap_test(visited, v))
+            continue;
+        for (int64_t e = g->in_starts[v]; e < g->in_starts[v + 1]; e++) {
+            Vertex u = g->in_edges[e];
+            if (bitmap_test(frontier, u)) {
+                send_discovery(s, v, column_global_id(layout, u));
+                break;
+            }
+        }
+    }
+}
+
+// Sends the discovered pairs to their owners, which keep the first parent
+// of every vertex not yet visited.  Returns the new frontier's size and
+// outgoing edges through the frontier list and *frontier_edges.
+static void fold(dist_bfs_state* s, int depth, int* distances, int* parents, long* frontier_edges)
+{
+    const dist_layout* layout = s->layout;
+    int cols = layout->cols;
+
+    std::vector<int> send_counts(cols), send_displs(cols), recv_counts(cols), recv_displs(cols);
+    int send_total = 0;
+    for (int c = 0; c < cols; c++) {
+        send_counts[c] = (int) s->outgoing[c].size();
+        send_displs[c] = send_total;
+        send_total += send_counts[c];
+    }
+    MPI_Alltoall(send_counts.data(), 1, MPI_INT, recv_counts.data(), 1, MPI_INT, layout->row_comm);
+
+    int recv_total = 0;
+    for (int c = 0; c < cols; c++) {
+        recv_displs[c] = recv_total;
+        recv_total += recv_counts[c];
+    }
+
+    s->send_buffer.resize(send_total);
+    for (int c = 0; c < cols; c++) {
+        std::copy(s->outgoing[c].begin(), s->outgoing[c].end(), s->send_buffer.begin() + send_displs[c]);
+        s->outgoing[c].clear();
+    }
+    s->recv_buffer.resize(recv_total);
+    MPI_Alltoallv(s->send_buffer.data(), send_counts.data(), send_displs.data(), MPI_INT,
+                  s->recv_buffer.data(), recv_counts.data(), recv_displs.data(), MPI_INT, layout->row_comm);
+    s->bytes_sent += (long long)(send_total - send_counts[layout->col]) * sizeof(Vertex);
+
+    s->frontier.clear();
+    long edges = 0;
+    Vertex offset = layout->row_begin - layout->owned_begin;
+    for (int i = 0; i < recv_total; i += 2) {
+        Vertex local = s->recv_buffer[i] + offset;
+        if (bitmap_test(s->owned_visited.data(), local))
+            continue;
+        bitmap_set(s->owned_visited.data(), local);
+        distances[local] = depth + 1;
+        if (parents)
+            parents[local] = s->recv_buffer[i + 1];
+        s->frontier.push_back(layout->owned_begin + local);
+        edges += s->graph->owned_degrees[local];
+    }
+    *frontier_edges = edges;
+}
+
+void dist_bfs(dist_graph* graph, Vertex root, bool hybrid, int* distances, int* parents,
+              dist_bfs_stats* stats)
+{
+    const dist_layout* layout = &graph->layout;
+    Vertex owned_n = layout->owned_end - layout->owned_begin;
+    Vertex row_n = layout->row_end - layout->row_begin;
+    Vertex column_n = layout->col_piece_starts[layout->rows];
+
+    dist_bfs_state s;
+    s.graph = graph;
+    s.layout = layout;
+    s.owned_visited.assign(bitmap_words(owned_n), 0);
+    s.owned_frontier_bits.assign(bitmap_words(owned_n), 0);
+    s.column_bits.assign(bitmap_words(column_n), 0);
+    s.sent.assign(bitmap_words(row_n), 0);
+    s.row_visited.assign(bitmap_words(row_n), 0);
+    s.outgoing.resize(layout->cols);
+    s.bytes_sent = 0;
+
+    for (Vertex i = 0; i < owned_n; i++) {
+        distances[i] = NOT_VISITED_MARKER;
+        if (parents)
+            parents[i] = -1;
+    }
+
+    long root_edges = 0;
+    if (root >= layout->owned_begin && root < layout->owned_end) {
+        Vertex local = root - layout->owned_begin;
+        bitmap_set(s.owned_visited.data(), local);
+        distances[local] = 0;
+        if (parents)
+            parents[local] = root;
+        s.frontier.push_back(root);
+        root_edges = graph->owned_degrees[local];
+    }
+    // the root's owner alone knows its degree
+    long frontier_edges;
+    MPI_Allreduce(&root_edges, &frontier_edges, 1, MPI_LONG, MPI_SUM, layout->comm);
+
+    hybrid_params params = get_hybrid_params();
+    stats->levels.clear();
+
+    long frontier_count = 1;
+    long unexplored_edges = layout->num_edges;
+    long previous_count = 0;
+    bool dense = false;
+
+    for (int depth = 0; frontier_count > 0; depth++) {
+
+        double start_time = MPI_Wtime();
+
+        hybrid_level level;
+        level.frontier_vertices = (int) frontier_count;
+        level.frontier_edges = frontier_edges;
+        level.unexplored_edges = unexplored_edges;
+        level.imbalance = 0;
+
+        // the same rule as bfs_hybrid, on global counts
+        bool was_dense = dense;
+        if (!hybrid)
+            dense = false;
+        else if (dense)
+            dense = frontier_count >= previous_count ||
+                    frontier_count > layout->num_nodes / params.beta;
+        else
+            dense = frontier_edges > unexplored_edges / params.alpha;
+        level.direction = dense ? BOTTOM_UP : TOP_DOWN;
+
+        unexplored_edges -= frontier_edges;
+
+        if (dense) {
+            expand_dense(&s);
+            gather_row_visited(&s);
+            bottom_up_local(&s);
+        } else {
+            // vertices found by the bottom-up levels need not be sent again
+            if (was_dense)
+                for (size_t w = 0; w < s.sent.size(); w++)
+                    s.sent[w] |= s.row_visited[w];
+
+            bool sparse = frontier_count * DIST_SPARSE_FACTOR < layout->num_nodes;
+            if (sparse)
+                expand_sparse(&s);
+            else
+                expand_dense(&s);
+            top_down_local(&s, sparse);
+        }
+
+        long local_edges;
+        fold(&s, depth, distances, parents, &local_edges);
+
+        long local_counts[2] = { (long) s.frontier.size(), local_edges };
+        long global_counts[2];
+        MPI_Allreduce(local_counts, global_counts, 2, MPI_LONG, MPI_SUM, layout->comm);
+
+        previous_count = frontier_count;
+        frontier_count = global_counts[0];
+        frontier_edges = global_counts[1];
+
+        level.seconds = MPI_Wtime() - start_time;
+        stats->levels.push_back(level);
+    }
+
+    std::vector<double> seconds(stats->levels.size());
+    for (size_t i = 0; i < seconds.size(); i++)
+        seconds[i] = stats->levels[i].seconds;
+    MPI_Allreduce(MPI_IN_PLACE, seconds.data(), (int) seconds.size(), MPI_DOUBLE, MPI_MAX, layout->comm);
+    for (size_t i = 0; i < seconds.size(); i++)
+        stats->levels[i].seconds = seconds[i];
+
+    MPI_Allreduce(&s.bytes_sent, &stats->bytes_sent, 1, MPI_LONG_LONG, MPI_SUM, layout->comm);
+}
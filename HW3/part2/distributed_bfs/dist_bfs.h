@@ -0,0 +1,34 @@
+#ifndef __DIST_BFS_H__
+#define __DIST_BFS_H__
+
+#include <vector>
+
+#include "breadth_first_search/bfs.h"
+#include "dist_graph.h"
+
+// Per-search statistics, identical on every rank
+struct dist_bfs_stats
+{
+    // Global frontier size, edges and direction of each level, with the
+    // level's time on the slowest rank
+    std::vector<hybrid_level> levels;
+    // Bytes all ranks sent to other ranks, including the frontier
+    // expansions, folds and row bitmaps but not the small reductions
+    long long bytes_sent;
+};
+
+// Searches the partitioned graph from root.  Each level gathers the
+// frontier along processor columns (as a list of vertices while it is
+// small, as a bitmap otherwise), explores the local edges, and folds the
+// discovered (vertex, parent) pairs to their owners along processor rows
+// with an all-to-all.  With hybrid set, levels switch between top-down
+// and bottom-up steps by the rule and hybrid_params of bfs_hybrid, using
+// global frontier and edge counts.
+//
+// distances and parents hold one entry per vertex in this rank's block
+// (owned_begin .. owned_end); parents may be NULL.  Collective over the
+// graph's ranks.
+void dist_bfs(dist_graph* graph, Vertex root, bool hybrid, int* distances, int* parents,
+              dist_bfs_stats* stats);
+
+#endif /* __DIST_BFS_H__ */
@@ -0,0 +1,237 @@
+#include "dist_graph.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+
+#include "common/graph_binary.h"
+
+// Edges read from the file at a time while filtering a rank's lists
+#define LOAD_CHUNK_EDGES (1 << 20)
+
+void choose_grid(int num_ranks, int* rows, int* cols)
+{
+    int r = 1;
+    for (int d = 1; d * d <= num_ranks; d++)
+        if (num_ranks % d == 0)
+            r = d;
+    *rows = r;
+    *cols = num_ranks / r;
+}
+
+int owner_block(const dist_layout* layout, Vertex v)
+{
+    const std::vector<Vertex>& starts = layout->block_starts;
+    return std::upper_bound(starts.begin(), starts.end(), v) - starts.begin() - 1;
+}
+
+Vertex column_local_id(const dist_layout* layout, Vertex v)
+{
+    int block = owner_block(layout, v);
+    return layout->col_piece_starts[block / layout->cols] + (v - layout->block_starts[block]);
+}
+
+Vertex column_global_id(const dist_layout* layout, Vertex local)
+{
+    const std::vector<Vertex>& pieces = layout->col_piece_starts;
+    int r = std::upper_bound(pieces.begin(), pieces.end(), local) - pieces.begin() - 1;
+    return layout->block_starts[r * layout->cols + layout->col] + (local - pieces[r]);
+}
+
+static void read_exact(int fd, void* buffer, size_t bytes, uint64_t offset, const char* filename)
+{
+    char* p = (char*) buffer;
+    while (bytes > 0) {
+        ssize_t n = pread(fd, p, bytes, offset);
+        if (n <= 0) {
+            fprintf(stderr, "Error reading %s: %s\n", filename, n < 0 ? strerror(errno) : "file truncated");
+            exit(1);
+        }
+        p += n;
+        bytes -= n;
+        offset += n;
+    }
+}
+
+// Reads offsets [begin, end] (end - begin + 1 values) of a starts array
+static std::vector<int64_t> read_starts(int fd, const graph_file_header* header, uint64_t array_offset,
+                                        Vertex begin, Vertex end, const char* filename)
+{
+    size_t count = (size_t)(end - begin) + 1;
+    std::vector<int64_t> starts(count);
+    uint64_t offset = array_offset + (uint64_t) begin * header->offset_bytes;
+
+    if (header->offset_bytes == sizeof(int64_t)) {
+        read_exact(fd, starts.data(), count * sizeof(int64_t), offset, filename);
+    } else {
+        std::vector<int32_t> narrow(count);
+        read_exact(fd, narrow.data(), count * sizeof(int32_t), offset, filename);
+        std::copy(narrow.begin(), narrow.end(), starts.begin());
+    }
+    return starts;
+}
+
+// Streams the lists of the vertices whose offsets are in starts (as
+// returned by read_starts) in chunks, calling visit(list, vertex) for
+// every edge in file order.
+template <typename F>
+static void scan_lists(int fd, uint64_t edges_offset, const std::vector<int64_t>& starts,
+                       const char* filename, F visit)
+{
+    std::vector<Vertex> buffer;
+    size_t lists = starts.size() - 1;
+    size_t first = 0;
+
+    while (first < lists) {
+        size_t last = first + 1;
+        while (last < lists && starts[last + 1] - starts[first] <= LOAD_CHUNK_EDGES)
+            last++;
+
+        int64_t count = starts[last] - starts[first];
+        buffer.resize(count);
+        read_exact(fd, buffer.data(), count * sizeof(Vertex),
+                   edges_offset + starts[first] * sizeof(Vertex), filename);
+
+        for (size_t list = first; list < last; list++)
+            for (int64_t e = starts[list]; e < starts[list + 1]; e++)
+                visit(list, buffer[e - starts[first]]);
+        first = last;
+    }
+}
+
+// Turns per-list counts into CSR offsets
+static void counts_to_starts(std::vector<int64_t>& starts)
+{
+    int64_t sum = 0;
+    for (size_t i = 0; i < starts.size(); i++) {
+        int64_t count = starts[i];
+        starts[i] = sum;
+        sum += count;
+    }
+}
+
+static void init_layout(dist_layout* layout, const graph_file_header* header, int rows, int cols,
+                        MPI_Comm comm)
+{
+    MPI_Comm_size(comm, &layout->num_ranks);
+    MPI_Comm_rank(comm, &layout->rank);
+    if (layout->num_ranks != rows * cols) {
+        if (layout->rank == 0)
+            fprintf(stderr, "A %d x %d grid needs %d ranks, not %d\n", rows, cols, rows * cols, layout->num_ranks);
+        MPI_Abort(comm, 1);
+    }
+
+    layout->rows = rows;
+    layout->cols = cols;
+    layout->row = layout->rank / cols;
+    layout->col = layout->rank % cols;
+    MPI_Comm_dup(comm, &layout->comm);
+    MPI_Comm_split(comm, layout->row, layout->col, &layout->row_comm);
+    MPI_Comm_split(comm, layout->col, layout->row, &layout->col_comm);
+
+    layout->num_nodes = (Vertex) header->num_nodes;
+    layout->num_edges = (int64_t) header->num_edges;
+
+    // blocks of whole bitmap words, so bitmaps of consecutive blocks
+    // can be gathered side by side
+    int blocks = layout->num_ranks;
+    layout->block_starts.resize(blocks + 1);
+    for (int k = 0; k <= blocks; k++) {
+        int64_t start = ((int64_t) layout->num_nodes * k / blocks + 63) / 64 * 64;
+        layout->block_starts[k] = (Vertex) std::min(start, (int64_t) layout->num_nodes);
+    }
+
+    layout->owned_begin = layout->block_starts[layout->rank];
+    layout->owned_end = layout->block_starts[layout->rank + 1];
+    layout->row_begin = layout->block_starts[layout->row * cols];
+    layout->row_end = layout->block_starts[layout->row * cols + cols];
+
+    layout->col_piece_starts.resize(rows + 1);
+    layout->col_piece_starts[0] = 0;
+    for (int r = 0; r < rows; r++) {
+        int block = r * cols + layout->col;
+        layout->col_piece_starts[r + 1] = layout->col_piece_starts[r] +
+            (layout->block_starts[block + 1] - layout->block_starts[block]);
+    }
+}
+
+dist_graph* load_graph_partition(const char* filename, int rows, int cols, MPI_Comm comm)
+{
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0) {
+        fprintf(stderr, "Could not open %s: %s\n", filename, strerror(errno));
+        exit(1);
+    }
+
+    graph_file_header header;
+    read_exact(fd, &header, sizeof(header), 0, filename);
+    if (header.token != GRAPH_HEADER_TOKEN_V2 || header.version != GRAPH_FORMAT_VERSION ||
+        header.vertex_bytes != sizeof(Vertex) ||
+        (header.offset_bytes != sizeof(int32_t) && header.offset_bytes != sizeof(int64_t))) {
+        fprintf(stderr, "%s is not a v2 binary graph (write one with graphTools), "
+                "which the partitioned loader needs for its incoming edges\n", filename);
+        exit(1);
+    }
+
+    dist_graph* graph = new dist_graph;
+    dist_layout* layout = &graph->layout;
+    init_layout(layout, &header, rows, cols, comm);
+
+    // outgoing lists of the column range, keeping targets in the row range
+    graph->out_starts.assign(layout->col_piece_starts[rows] + 1, 0);
+    for (int r = 0; r < rows; r++) {
+        int block = r * cols + layout->col;
+        Vertex begin = layout->block_starts[block];
+        Vertex end = layout->block_starts[block + 1];
+        if (begin == end)
+            continue;
+
+        std::vector<int64_t> starts = read_starts(fd, &header, header.outgoing_starts_offset, begin, end, filename);
+        int64_t* counts = &graph->out_starts[layout->col_piece_starts[r]];
+        scan_lists(fd, header.outgoing_edges_offset, starts, filename, [&](size_t list, Vertex v) {
+            if (v >= layout->row_begin && v < layout->row_end) {
+                graph->out_edges.push_back(v - layout->row_begin);
+                counts[list]++;
+            }
+        });
+    }
+    counts_to_starts(graph->out_starts);
+
+    // incoming lists of the row range, keeping sources in the column range
+    graph->in_starts.assign(layout->row_end - layout->row_begin + 1, 0);
+    if (layout->row_end > layout->row_begin) {
+        std::vector<int64_t> starts = read_starts(fd, &header, header.incoming_starts_offset,
+                                                  layout->row_begin, layout->row_end, filename);
+        scan_lists(fd, header.incoming_edges_offset, starts, filename, [&](size_t list, Vertex u) {
+            if (owner_block(layout, u) % cols == layout->col) {
+                graph->in_edges.push_back(column_local_id(layout, u));
+                graph->in_starts[list]++;
+            }
+        });
+    }
+    counts_to_starts(graph->in_starts);
+
+    graph->owned_degrees.resize(layout->owned_end - layout->owned_begin);
+    if (layout->owned_end > layout->owned_begin) {
+        std::vector<int64_t> starts = read_starts(fd, &header, header.outgoing_starts_offset,
+                                                  layout->owned_begin, layout->owned_end, filename);
+        for (size_t i = 0; i < graph->owned_degrees.size(); i++)
+            graph->owned_degrees[i] = starts[i + 1] - starts[i];
+    }
+
+    close(fd);
+    return graph;
+}
+
+void free_dist_graph(dist_graph* graph)
+{
+    MPI_Comm_free(&graph->layout.comm);
+    MPI_Comm_free(&graph->layout.row_comm);
+    MPI_Comm_free(&graph->layout.col_comm);
+    delete graph;
+}
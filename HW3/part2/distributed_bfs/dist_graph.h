@@ -0,0 +1,87 @@
+#ifndef __DIST_GRAPH_H__
+#define __DIST_GRAPH_H__
+
+#include <stdint.h>
+#include <mpi.h>
+
+#include <vector>
+
+#include "common/graph.h"
+
+// Partitioning of a graph over a rows x cols grid of MPI ranks.
+//
+// The vertices are cut into num_ranks blocks of consecutive ids, each
+// a multiple of 64 vertices except the last, and rank k = row * cols +
+// col owns block k.  Rank (row, col) holds the edges u -> v whose source
+// lies in its column range, the blocks col, cols + col, cols * 2 + col,
+// ..., and whose target lies in its row range, the consecutive blocks
+// row * cols .. row * cols + cols - 1.  Frontiers are then expanded
+// within a processor column and discovered vertices folded back to
+// their owners within a processor row.
+//
+// rows == 1 is the classic 1D partition: every rank holds the outgoing
+// edges of its own block and all exchanges are row-wide all-to-alls.
+// cols == 1 is the 1D partition by target: every rank holds the
+// incoming edges of its own block and frontiers are allgathered.
+struct dist_layout
+{
+    int num_ranks;
+    int rank;
+    int rows;
+    int cols;
+    int row;
+    int col;
+    MPI_Comm comm;
+    MPI_Comm row_comm;
+    MPI_Comm col_comm;
+
+    Vertex num_nodes;
+    int64_t num_edges;
+
+    // num_ranks + 1 block boundaries
+    std::vector<Vertex> block_starts;
+    Vertex owned_begin;
+    Vertex owned_end;
+    Vertex row_begin;
+    Vertex row_end;
+    // Column vertices are numbered by concatenating the column's blocks;
+    // col_piece_starts[r] is the column-local id of the first vertex of
+    // the block in processor row r, with rows + 1 entries.
+    std::vector<Vertex> col_piece_starts;
+};
+
+struct dist_graph
+{
+    dist_layout layout;
+
+    // Local edges by source: column-local source ids index out_starts,
+    // out_edges holds row-local target ids.
+    std::vector<int64_t> out_starts;
+    std::vector<Vertex> out_edges;
+
+    // The same edges by target: row-local target ids index in_starts,
+    // in_edges holds column-local source ids.
+    std::vector<int64_t> in_starts;
+    std::vector<Vertex> in_edges;
+
+    // Out-degree in the whole graph of each owned vertex
+    std::vector<int64_t> owned_degrees;
+};
+
+// Picks the most square rows x cols grid with rows <= cols
+void choose_grid(int num_ranks, int* rows, int* cols);
+
+// Every rank reads only the parts of a v2 binary graph file that cover
+// its row and column ranges and keeps only its own edges.  Collective
+// over comm, whose size must be rows * cols.
+dist_graph* load_graph_partition(const char* filename, int rows, int cols, MPI_Comm comm);
+void free_dist_graph(dist_graph* graph);
+
+// Block holding vertex v
+int owner_block(const dist_layout* layout, Vertex v);
+
+// Column-local id of a vertex in this rank's column range, and back
+Vertex column_local_id(const dist_layout* layout, Vertex v);
+Vertex column_global_id(const dist_layout* layout, Vertex local);
+
+#endif /* __DIST_GRAPH_H__ */
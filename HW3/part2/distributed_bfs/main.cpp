@@ -0,0 +1,283 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+#include <mpi.h>
+
+#include <iostream>
+#include <vector>
+
+#include "common/graph.h"
+#include "breadth_first_search/bfs.h"
+#include "dist_graph.h"
+#include "dist_bfs.h"
+
+// Parses "1d", "2d" or "RxC" into a grid for num_ranks ranks
+static bool parse_grid(const char* text, int num_ranks, int* rows, int* cols)
+{
+    if (strcmp(text, "1d") == 0) {
+        *rows = 1;
+        *cols = num_ranks;
+        return true;
+    }
+    if (strcmp(text, "2d") == 0) {
+        choose_grid(num_ranks, rows, cols);
+        return true;
+    }
+    return sscanf(text, "%dx%d", rows, cols) == 2 && *rows > 0 && *cols > 0;
+}
+
+static void print_levels(const dist_bfs_stats* stats)
+{
+    printf("  Level  Frontier    Frontier edges  Direction  Time\n");
+    for (size_t i = 0; i < stats->levels.size(); i++) {
+        const hybrid_level* level = &stats->levels[i];
+        printf("  %5zu  %-10d  %-14ld  %-9s  %.4f sec\n", i, level->frontier_vertices, level->frontier_edges,
+               level->direction == BOTTOM_UP ? "bottom-up" : "top-down", level->seconds);
+    }
+}
+
+// Collects a per-vertex array spread over the ranks' blocks on rank 0.
+// Blocks are numbered in rank order, so the pieces concatenate.
+static std::vector<int> gather_blocks(const dist_layout* layout, const int* owned)
+{
+    std::vector<int> counts(layout->num_ranks), displs(layout->num_ranks);
+    for (int k = 0; k < layout->num_ranks; k++) {
+        displs[k] = layout->block_starts[k];
+        counts[k] = layout->block_starts[k + 1] - layout->block_starts[k];
+    }
+    std::vector<int> all(layout->rank == 0 ? layout->num_nodes : 0);
+    MPI_Gatherv(owned, counts[layout->rank], MPI_INT, all.data(), counts.data(), displs.data(), MPI_INT,
+                0, layout->comm);
+    return all;
+}
+
+// Compares the distances with bfs_hybrid on the whole graph and checks
+// that every parent is one level closer to the root and has an edge to
+// its child.  Runs on rank 0.
+template <typename G>
+static bool check_against_shared(G g, Vertex root, const std::vector<int>& distances,
+                                 const std::vector<int>& parents)
+{
+    solution sol;
+    sol.distances = (int*)malloc(sizeof(int) * g->num_nodes);
+    bfs_hybrid(g, &sol, root);
+
+    bool ok = true;
+    for (Vertex v = 0; v < g->num_nodes && ok; v++) {
+        if (distances[v] != sol.distances[v]) {
+            fprintf(stderr, "*** Results disagree at %d: %d, %d\n", v, distances[v], sol.distances[v]);
+            ok = false;
+            break;
+        }
+
+        Vertex p = parents[v];
+        if (distances[v] <= 0) {
+            if (p != (distances[v] == 0 ? v : -1)) {
+                fprintf(stderr, "*** Bad parent %d of %d at distance %d\n", p, v, distances[v]);
+                ok = false;
+            }
+            continue;
+        }
+
+        bool edge = false;
+        if (p >= 0 && p < g->num_nodes && distances[p] == distances[v] - 1)
+            for (Vertex u : outgoing_neighbors(g, p))
+                if (u == v) {
+                    edge = true;
+                    break;
+                }
+        if (!edge) {
+            fprintf(stderr, "*** Bad parent %d of %d at distance %d\n", p, v, distances[v]);
+            ok = false;
+        }
+    }
+
+    free(sol.distances);
+    return ok;
+}
+
+static bool check_on_rank0(const char* filename, Vertex root, const std::vector<int>& distances,
+                           const std::vector<int>& parents)
+{
+    bool ok;
+    if (graph_file_needs_wide_offsets(filename)) {
+        Graph64 g = load_graph_binary64(filename);
+        ok = check_against_shared(g, root, distances, parents);
+        free_graph(g);
+    } else {
+        Graph g = load_graph_binary(filename);
+        ok = check_against_shared(g, root, distances, parents);
+        free_graph(g);
+    }
+    return ok;
+}
+
+int main(int argc, char** argv)
+{
+    MPI_Init(&argc, &argv);
+
+    int num_ranks, rank;
+    MPI_Comm_size(MPI_COMM_WORLD, &num_ranks);
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+    int rows = 0, cols = 0;
+    choose_grid(num_ranks, &rows, &cols);
+    bool hybrid = true;
+    Vertex root = ROOT_NODE_ID;
+    int runs = 3;
+    bool verify = false;
+    bool print_log = false;
+    hybrid_params params = get_hybrid_params();
+    bool usage = false;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "p:m:r:n:a:b:lv")) != -1) {
+        switch (opt) {
+        case 'p':
+            if (!parse_grid(optarg, num_ranks, &rows, &cols)) {
+                if (rank == 0)
+                    std::cerr << "Unknown partition: " << optarg << "\n";
+                usage = true;
+            }
+            break;
+        case 'm':
+            if (strcmp(optarg, "hybrid") == 0) {
+                hybrid = true;
+            } else if (strcmp(optarg, "top-down") == 0) {
+                hybrid = false;
+            } else {
+                if (rank == 0)
+                    std::cerr << "Unknown search mode: " << optarg << "\n";
+                usage = true;
+            }
+            break;
+        case 'r':
+            root = atoi(optarg);
+            break;
+        case 'n':
+            runs = atoi(optarg);
+            break;
+        case 'a':
+            params.alpha = atof(optarg);
+            break;
+        case 'b':
+            params.beta = atof(optarg);
+            break;
+        case 'l':
+            print_log = true;
+            break;
+        case 'v':
+            verify = true;
+            break;
+        default:
+            usage = true;
+        }
+    }
+
+    if (params.alpha <= 0 || params.beta <= 0 || runs <= 0) {
+        if (rank == 0)
+            std::cerr << "Hybrid alpha and beta and the number of runs must be positive\n";
+        usage = true;
+    }
+    if (!usage && rows * cols != num_ranks) {
+        if (rank == 0)
+            std::cerr << "A " << rows << "x" << cols << " grid needs " << rows * cols << " ranks, not " << num_ranks << "\n";
+        usage = true;
+    }
+
+    if (usage || argc - optind != 1) {
+        if (rank == 0) {
+            std::cerr << "Usage: mpirun -np N ./dist_bfs [-p 1d|2d|RxC] [-m hybrid|top-down] [-r root] [-n runs]\n";
+            std::cerr << "                [-a alpha] [-b beta] [-l] [-v] <path/to/graph.bin>\n";
+            std::cerr << "  e.g. mpirun -np 9 --hostfile ../../../HW4/part1/hosts ./dist_bfs -p 3x3 graph.bin\n";
+            std::cerr << "  The graph must be a v2 binary file (graphTools) readable by every rank.\n";
+            std::cerr << "  -p: 1d splits vertices by source over all ranks, 2d (default) uses the most\n";
+            std::cerr << "      square grid, RxC an explicit grid of R * C == N ranks\n";
+            std::cerr << "  -m: switch directions as bfs_hybrid does (default), or only go top-down\n";
+            std::cerr << "  -n: timed searches (default 3)\n";
+            std::cerr << "  -a, -b: hybrid switch parameters, as for bfs\n";
+            std::cerr << "  -l: print the levels of the last search\n";
+            std::cerr << "  -v: check distances and parents against bfs_hybrid on rank 0\n";
+        }
+        MPI_Finalize();
+        return 1;
+    }
+
+    const char* filename = argv[optind];
+    set_hybrid_params(&params);
+
+    MPI_Barrier(MPI_COMM_WORLD);
+    double start = MPI_Wtime();
+    dist_graph* graph = load_graph_partition(filename, rows, cols, MPI_COMM_WORLD);
+    double local_load = MPI_Wtime() - start;
+    const dist_layout* layout = &graph->layout;
+
+    if (root < 0 || root >= layout->num_nodes) {
+        if (rank == 0)
+            std::cerr << "Root " << root << " is not a vertex of the graph\n";
+        free_dist_graph(graph);
+        MPI_Finalize();
+        return 1;
+    }
+
+    double load_time;
+    long long local_edges = graph->out_edges.size();
+    long long min_edges, max_edges;
+    MPI_Reduce(&local_load, &load_time, 1, MPI_DOUBLE, MPI_MAX, 0, MPI_COMM_WORLD);
+    MPI_Reduce(&local_edges, &min_edges, 1, MPI_LONG_LONG, MPI_MIN, 0, MPI_COMM_WORLD);
+    MPI_Reduce(&local_edges, &max_edges, 1, MPI_LONG_LONG, MPI_MAX, 0, MPI_COMM_WORLD);
+
+    if (rank == 0) {
+        double mean_edges = (double) layout->num_edges / num_ranks;
+        printf("----------------------------------------------------------\n");
+        printf("Graph stats:\n");
+        printf("  Edges: %ld\n", (long) layout->num_edges);
+        printf("  Nodes: %d\n", layout->num_nodes);
+        printf("Ranks: %d as a %d x %d grid, %s search from %d\n", num_ranks, rows, cols,
+               hybrid ? "hybrid" : "top-down", root);
+        printf("Load: %.4f sec, edges per rank %lld..%lld (max/mean %.2f)\n", load_time, min_edges, max_edges,
+               mean_edges > 0 ? max_edges / mean_edges : 0.0);
+        printf("----------------------------------------------------------\n");
+    }
+
+    Vertex owned_n = layout->owned_end - layout->owned_begin;
+    std::vector<int> distances(owned_n), parents(owned_n);
+    dist_bfs_stats stats;
+    double best = 1e30;
+
+    for (int i = 0; i < runs; i++) {
+        MPI_Barrier(MPI_COMM_WORLD);
+        start = MPI_Wtime();
+        dist_bfs(graph, root, hybrid, distances.data(), parents.data(), &stats);
+        double local_time = MPI_Wtime() - start;
+        double time;
+        MPI_Allreduce(&local_time, &time, 1, MPI_DOUBLE, MPI_MAX, MPI_COMM_WORLD);
+        best = std::min(best, time);
+    }
+
+    // edges out of reached vertices, as counted for TEPS by the benchmark
+    long long local_traversed = 0, traversed;
+    for (Vertex i = 0; i < owned_n; i++)
+        if (distances[i] >= 0)
+            local_traversed += graph->owned_degrees[i];
+    MPI_Reduce(&local_traversed, &traversed, 1, MPI_LONG_LONG, MPI_SUM, 0, MPI_COMM_WORLD);
+
+    if (rank == 0) {
+        printf("Levels: %zu, sent %.2f MB\n", stats.levels.size(), stats.bytes_sent / 1e6);
+        printf("Best of %d: %.4f sec, %.2f MTEPS\n", runs, best, traversed / best / 1e6);
+        if (print_log)
+            print_levels(&stats);
+    }
+
+    if (verify) {
+        std::vector<int> all_distances = gather_blocks(layout, distances.data());
+        std::vector<int> all_parents = gather_blocks(layout, parents.data());
+        if (rank == 0)
+            printf("Check: %s\n", check_on_rank0(filename, root, all_distances, all_parents) ? "correct" : "WRONG");
+    }
+
+    free_dist_graph(graph);
+    MPI_Finalize();
+    return 0;
+}
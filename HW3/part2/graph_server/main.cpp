@@ -0,0 +1,525 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <unistd.h>
+#include <getopt.h>
+#include <omp.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/un.h>
+
+#include <algorithm>
+#include <iostream>
+#include <map>
+#include <queue>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "common/CycleTimer.h"
+#include "common/graph.h"
+#include "common/memory_policy.h"
+#include "breadth_first_search/bfs.h"
+#include "breadth_first_search/ms_bfs.h"
+#include "page_rank/page_rank.h"
+
+// Defaults of the pr binary
+#define DEFAULT_DAMPING 0.3
+#define DEFAULT_CONVERGENCE 1e-7
+
+// Most sources one msbfs query may name
+#define MAX_QUERY_SOURCES 4096
+
+// Socket clients are served one at a time; one that sends nothing for
+// this long is disconnected so that it cannot hold up the others
+#define CLIENT_IDLE_SECONDS 30
+
+// A graph kept in memory between queries, with the BFS workspace and
+// result arrays its queries reuse.  bfs queries allocate nothing of the
+// graph's size; msbfs and pr still allocate their kernels' scratch
+// arrays on every call.
+struct resident_graph
+{
+    std::string path;
+    // exactly one of the two is set
+    Graph g;
+    Graph64 g64;
+    bfs_workspace workspace;
+    int* distances;
+    int* parents;
+    double* scores;
+    double load_seconds;
+};
+
+// Latencies of every answered query, by command
+static std::map<std::string, std::vector<double>> latencies;
+
+static std::map<std::string, resident_graph*> graphs;
+
+// Calls f with the graph as Graph or Graph64
+template <typename F>
+static void with_graph(resident_graph* rg, F f)
+{
+    if (rg->g)
+        f(rg->g);
+    else
+        f(rg->g64);
+}
+
+static long vertex_count(resident_graph* rg)
+{
+    return rg->g ? rg->g->num_nodes : rg->g64->num_nodes;
+}
+
+static long edge_count(resident_graph* rg)
+{
+    return rg->g ? (long) rg->g->num_edges : (long) rg->g64->num_edges;
+}
+
+static void free_resident(resident_graph* rg)
+{
+    if (rg->g)
+        free_graph(rg->g);
+    else
+        free_graph(rg->g64);
+    bfs_workspace_free(&rg->workspace);
+    policy_free(rg->distances);
+    policy_free(rg->parents);
+    policy_free(rg->scores);
+    delete rg;
+}
+
+static bool load_resident(const std::string& name, const std::string& path, std::ostream& reply)
+{
+    // the loaders exit on malformed files, which would take the server
+    // down, so the file is checked first
+    if (const char* error = binary_graph_file_error(path.c_str())) {
+        reply << "error " << path << ": " << error;
+        return false;
+    }
+
+    double start = CycleTimer::currentSeconds();
+    resident_graph* rg = new resident_graph();
+    rg->path = path;
+    rg->g = NULL;
+    rg->g64 = NULL;
+    if (graph_file_needs_wide_offsets(path.c_str()))
+        rg->g64 = load_graph_binary64(path.c_str());
+    else
+        rg->g = load_graph_binary(path.c_str());
+
+    long n = vertex_count(rg);
+    bfs_workspace_init(&rg->workspace);
+    bfs_workspace_reserve(&rg->workspace, n, omp_get_max_threads());
+    rg->distances = (int*)policy_alloc(sizeof(int) * n);
+    rg->parents = (int*)policy_alloc(sizeof(int) * n);
+    rg->scores = (double*)policy_alloc(sizeof(double) * n);
+    rg->load_seconds = CycleTimer::currentSeconds() - start;
+
+    if (graphs.count(name))
+        free_resident(graphs[name]);
+    graphs[name] = rg;
+
+    reply << "ok load " << name << " nodes=" << n << " edges=" << edge_count(rg)
+          << " load_ms=" << rg->load_seconds * 1e3;
+    return true;
+}
+
+static resident_graph* find_graph(const std::string& name, std::ostream& reply)
+{
+    auto it = graphs.find(name);
+    if (it == graphs.end()) {
+        reply << "error no graph named " << name;
+        return NULL;
+    }
+    return it->second;
+}
+
+static bool parse_vertex(const std::string& word, resident_graph* rg, Vertex* v, std::ostream& reply)
+{
+    char* end;
+    long value = strtol(word.c_str(), &end, 10);
+    if (word.empty() || *end != '\0' || value < 0 || value >= vertex_count(rg)) {
+        reply << "error bad vertex " << word;
+        return false;
+    }
+    *v = (Vertex) value;
+    return true;
+}
+
+// bfs <graph> <root> [top-down|bottom-up|hybrid] [vertex...]
+// Reports the vertices reached, the depth of the search, and the
+// distance and parent of every listed vertex.
+static double query_bfs(std::istringstream& args, std::ostream& reply)
+{
+    std::string name, word;
+    args >> name >> word;
+    resident_graph* rg = find_graph(name, reply);
+    Vertex root;
+    if (!rg || !parse_vertex(word, rg, &root, reply))
+        return 0;
+
+    std::string mode = "hybrid";
+    std::vector<Vertex> targets;
+    while (args >> word) {
+        Vertex v;
+        if (word == "top-down" || word == "bottom-up" || word == "hybrid")
+            mode = word;
+        else if (parse_vertex(word, rg, &v, reply))
+            targets.push_back(v);
+        else
+            return 0;
+    }
+
+    solution sol;
+    sol.distances = rg->distances;
+    sol.parents = rg->parents;
+
+    double start = CycleTimer::currentSeconds();
+    with_graph(rg, [&](auto g) {
+        if (mode == "top-down")
+            bfs_top_down(g, &sol, root, &rg->workspace);
+        else if (mode == "bottom-up")
+            bfs_bottom_up(g, &sol, root, &rg->workspace);
+        else
+            bfs_hybrid(g, &sol, root, &rg->workspace);
+    });
+    double kernel = CycleTimer::currentSeconds() - start;
+
+    long n = vertex_count(rg);
+    long reached = 0;
+    int depth = 0;
+    #pragma omp parallel for reduction(+:reached) reduction(max:depth)
+    for (long v = 0; v < n; v++) {
+        if (sol.distances[v] >= 0) {
+            reached++;
+            depth = std::max(depth, sol.distances[v]);
+        }
+    }
+
+    reply << "ok bfs " << mode << " reached=" << reached << " depth=" << depth;
+    for (Vertex v : targets)
+        reply << " " << v << "=" << sol.distances[v] << "/" << sol.parents[v];
+    return kernel;
+}
+
+// msbfs <graph> <root> [root...]
+// Runs every search in one multi-source batch and reports the vertices
+// reached, eccentricity and closeness of each source.
+static double query_ms_bfs(std::istringstream& args, std::ostream& reply)
+{
+    std::string name, word;
+    args >> name;
+    resident_graph* rg = find_graph(name, reply);
+    if (!rg)
+        return 0;
+
+    std::vector<Vertex> sources;
+    while (args >> word) {
+        Vertex v;
+        if (!parse_vertex(word, rg, &v, reply))
+            return 0;
+        sources.push_back(v);
+    }
+    if (sources.empty() || sources.size() > MAX_QUERY_SOURCES) {
+        reply << "error msbfs takes 1 to " << MAX_QUERY_SOURCES << " sources";
+        return 0;
+    }
+
+    int count = sources.size();
+    std::vector<int> eccentricity(count), reached(count);
+    std::vector<double> closeness(count);
+    ms_bfs_result result = { NULL, eccentricity.data(), reached.data(), closeness.data() };
+
+    double start = CycleTimer::currentSeconds();
+    with_graph(rg, [&](auto g) { ms_bfs(g, sources.data(), count, &result); });
+    double kernel = CycleTimer::currentSeconds() - start;
+
+    reply << "ok msbfs sources=" << count;
+    for (int i = 0; i < count; i++)
+        reply << " " << sources[i] << "=" << reached[i] << "/" << eccentricity[i] << "/" << closeness[i];
+    return kernel;
+}
+
+// pr <graph> [damping [convergence [top]]]
+// Reports the top highest scoring vertices, 10 by default.
+static double query_page_rank(std::istringstream& args, std::ostream& reply)
+{
+    std::string name;
+    args >> name;
+    resident_graph* rg = find_graph(name, reply);
+    if (!rg)
+        return 0;
+
+    double damping = DEFAULT_DAMPING;
+    double convergence = DEFAULT_CONVERGENCE;
+    int top = 10;
+    if (args >> damping)
+        if (args >> convergence)
+            args >> top;
+    if (damping <= 0 || damping >= 1 || convergence <= 0 || top < 0) {
+        reply << "error pr needs 0 < damping < 1, convergence > 0 and top >= 0";
+        return 0;
+    }
+
+    double start = CycleTimer::currentSeconds();
+    with_graph(rg, [&](auto g) { pageRank(g, rg->scores, damping, convergence); });
+    double kernel = CycleTimer::currentSeconds() - start;
+
+    // a heap of the best top seen so far, the worst of them on top
+    long n = vertex_count(rg);
+    auto better = [&](Vertex a, Vertex b) { return rg->scores[a] > rg->scores[b]; };
+    std::priority_queue<Vertex, std::vector<Vertex>, decltype(better)> heap(better);
+    for (long v = 0; v < n && top > 0; v++) {
+        if ((long) heap.size() < top) {
+            heap.push(v);
+        } else if (better(v, heap.top())) {
+            heap.pop();
+            heap.push(v);
+        }
+    }
+    std::vector<Vertex> best(heap.size());
+    for (long i = best.size() - 1; i >= 0; i--) {
+        best[i] = heap.top();
+        heap.pop();
+    }
+
+    reply << "ok pr";
+    for (Vertex v : best)
+        reply << " " << v << "=" << rg->scores[v];
+    return kernel;
+}
+
+// Count, mean and quantiles of each command's latencies
+static void report_stats(std::ostream& reply)
+{
+    reply << "ok stats";
+    for (auto& entry : latencies) {
+        std::vector<double> times = entry.second;
+        std::sort(times.begin(), times.end());
+        double sum = 0;
+        for (double t : times)
+            sum += t;
+        reply << " " << entry.first << "=" << times.size() << "/" << sum / times.size() * 1e3
+              << "/" << times[times.size() / 2] * 1e3 << "/" << times[times.size() * 99 / 100] * 1e3
+              << "/" << times.back() * 1e3;
+    }
+}
+
+static void list_graphs(std::ostream& reply)
+{
+    reply << "ok graphs";
+    for (auto& entry : graphs)
+        reply << " " << entry.first << "=" << entry.second->path << "/" << vertex_count(entry.second)
+              << "/" << edge_count(entry.second);
+}
+
+static const char* help_text =
+    "ok commands, one per line; all but help are answered by one line starting with ok or error:\n"
+    "  load <name> <graph.bin>                load or replace a graph\n"
+    "  unload <name>\n"
+    "  graphs                                 name=path/nodes/edges of each graph\n"
+    "  bfs <name> <root> [top-down|bottom-up|hybrid] [vertex...]\n"
+    "                                         vertices reached, depth, and distance/parent\n"
+    "                                         of each listed vertex\n"
+    "  msbfs <name> <root> [root...]          root=reached/eccentricity/closeness\n"
+    "  pr <name> [damping [convergence [top]]]\n"
+    "                                         the top (10) vertex=score pairs\n"
+    "  stats                                  command=count/mean/p50/p99/max latency in ms\n"
+    "  quit                                   end this session\n"
+    "  shutdown                               stop the server\n"
+    "Every query answer ends with kernel_ms and total_ms.";
+
+// Answers one request line; returns false once the session should end,
+// and sets *shutdown if the server should stop
+static bool handle_line(const std::string& line, std::ostream& reply, bool* shutdown)
+{
+    double start = CycleTimer::currentSeconds();
+    std::istringstream args(line);
+    std::string command;
+    if (!(args >> command))
+        return true;
+
+    double kernel = -1;
+    if (command == "quit" || command == "shutdown") {
+        *shutdown = command == "shutdown";
+        reply << "ok bye\n";
+        return false;
+    } else if (command == "help") {
+        reply << help_text;
+    } else if (command == "load") {
+        std::string name, path;
+        if (args >> name >> path)
+            load_resident(name, path, reply);
+        else
+            reply << "error usage: load <name> <graph.bin>";
+    } else if (command == "unload") {
+        std::string name;
+        args >> name;
+        if (find_graph(name, reply)) {
+            free_resident(graphs[name]);
+            graphs.erase(name);
+            reply << "ok unload " << name;
+        }
+    } else if (command == "graphs") {
+        list_graphs(reply);
+    } else if (command == "stats") {
+        report_stats(reply);
+    } else if (command == "bfs") {
+        kernel = query_bfs(args, reply);
+    } else if (command == "msbfs") {
+        kernel = query_ms_bfs(args, reply);
+    } else if (command == "pr") {
+        kernel = query_page_rank(args, reply);
+    } else {
+        reply << "error unknown command " << command << ", try help";
+    }
+
+    // only successful queries count towards the latencies
+    if (kernel > 0) {
+        double total = CycleTimer::currentSeconds() - start;
+        latencies[command].push_back(total);
+        reply << " kernel_ms=" << kernel * 1e3 << " total_ms=" << total * 1e3;
+    }
+    reply << "\n";
+    return true;
+}
+
+// Serves requests from in until it ends or a client quits
+static void serve(FILE* in, FILE* out, bool* shutdown)
+{
+    char* line = NULL;
+    size_t capacity = 0;
+    ssize_t length;
+
+    while ((length = getline(&line, &capacity, in)) > 0) {
+        std::ostringstream reply;
+        reply.precision(6);
+        bool more = handle_line(std::string(line, length), reply, shutdown);
+        std::string text = reply.str();
+        if (fwrite(text.data(), 1, text.size(), out) != text.size() || fflush(out) != 0)
+            break;
+        if (!more)
+            break;
+    }
+    free(line);
+}
+
+// Accepts one client at a time on a Unix domain socket; queries use
+// every thread, so serving clients concurrently would gain nothing.
+// Clients that stay silent for CLIENT_IDLE_SECONDS are disconnected.
+static void serve_socket(const char* path)
+{
+    int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+    sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (listener < 0 || strlen(path) >= sizeof(address.sun_path)) {
+        fprintf(stderr, "Could not create socket %s\n", path);
+        exit(1);
+    }
+    strcpy(address.sun_path, path);
+    unlink(path);
+    if (bind(listener, (sockaddr*)&address, sizeof(address)) != 0 || listen(listener, 16) != 0) {
+        fprintf(stderr, "Could not listen on %s: %s\n", path, strerror(errno));
+        exit(1);
+    }
+    fprintf(stderr, "Listening on %s\n", path);
+
+    bool shutdown = false;
+    while (!shutdown) {
+        int client = accept(listener, NULL, NULL);
+        if (client < 0) {
+            if (errno == EINTR)
+                continue;
+            fprintf(stderr, "accept failed: %s\n", strerror(errno));
+            break;
+        }
+        timeval idle = { CLIENT_IDLE_SECONDS, 0 };
+        setsockopt(client, SOL_SOCKET, SO_RCVTIMEO, &idle, sizeof(idle));
+        FILE* in = fdopen(client, "r");
+        FILE* out = fdopen(dup(client), "w");
+        serve(in, out, &shutdown);
+        fclose(in);
+        fclose(out);
+    }
+
+    close(listener);
+    unlink(path);
+}
+
+// Runs an empty parallel region so the OpenMP threads exist before the
+// first query
+static void warm_thread_pool()
+{
+    int threads = 0;
+    #pragma omp parallel reduction(+:threads)
+    threads++;
+    fprintf(stderr, "%d threads ready\n", threads);
+}
+
+int main(int argc, char** argv)
+{
+    const char* socket_path = NULL;
+    memory_policy policy = get_memory_policy();
+    std::vector<std::string> preload;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "s:m:g:")) != -1) {
+        switch (opt) {
+        case 's':
+            socket_path = optarg;
+            break;
+        case 'm':
+            if (!parse_memory_policy(optarg, &policy)) {
+                std::cerr << "Unknown memory policy: " << optarg << "\n";
+                argc = 0;
+            }
+            break;
+        case 'g':
+            preload.push_back(optarg);
+            break;
+        default:
+            argc = 0;
+        }
+    }
+
+    if (argc == 0 || optind != argc) {
+        std::cerr << "Usage: [-s socket] [-m memory_policy] [-g name=graph.bin]...\n";
+        std::cerr << "  Keeps graphs loaded and answers BFS, multi-source BFS and PageRank\n";
+        std::cerr << "  queries, one per line, from stdin or from clients of a Unix socket.\n";
+        std::cerr << "  Send 'help' for the commands, e.g. with: socat - UNIX-CONNECT:socket\n";
+        std::cerr << "  -s: listen on this Unix domain socket instead of reading stdin.  Clients\n";
+        std::cerr << "      are served one at a time, and dropped after " << CLIENT_IDLE_SECONDS
+                  << " seconds without a request\n";
+        std::cerr << "  -m: placement and page size of graph and result arrays, as for bfs\n";
+        std::cerr << "  -g: load a graph under a name at startup, may be repeated\n";
+        exit(1);
+    }
+
+    set_memory_policy(&policy);
+    signal(SIGPIPE, SIG_IGN);
+    warm_thread_pool();
+
+    for (const std::string& spec : preload) {
+        size_t equals = spec.find('=');
+        std::ostringstream reply;
+        if (equals == std::string::npos)
+            reply << "error -g takes name=graph.bin";
+        else
+            load_resident(spec.substr(0, equals), spec.substr(equals + 1), reply);
+        fprintf(stderr, "%s\n", reply.str().c_str());
+    }
+
+    bool shutdown = false;
+    if (socket_path)
+        serve_socket(socket_path);
+    else
+        serve(stdin, stdout, &shutdown);
+
+    for (auto& entry : graphs)
+        free_resident(entry.second);
+    return 0;
+}
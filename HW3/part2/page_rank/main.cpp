@@ -1,18 +1,24 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <omp.h>
 #include <string>
 #include <getopt.h>
 
+#include <algorithm>
 #include <iostream>
 #include <sstream>
 #include <vector>
 
 #include "common/CycleTimer.h"
 #include "common/graph.h"
+#include "common/memory_policy.h"
+#include "common/edge_partition.h"
+#include "common/trace.h"
 #include "common/grade.h"
 
 #include "page_rank.h"
+#include "ppr.h"
 
 #define USE_BINARY_GRAPH 1
 
@@ -21,52 +27,379 @@
 
 void reference_pageRank(Graph g, double* solution, double damping, double convergence);
 
+static bool compare_balancing = false;
+static bool compare_kernels = false;
+
+// Personalized PageRank runs (-P, -e, -n, -o)
+static const char* ppr_seed_spec = NULL;
+static double ppr_epsilon = 0;
+static int ppr_top_k = 10;
+static const char* ppr_output = NULL;
+
+// Sets checked against one plain power iteration each in run_personalized
+#define PPR_CHECKED_SETS 4
+
+// The delta kernel stops on its residuals instead of the L1 change of an
+// iteration, so its scores are not those of the synchronous iterations
+// the reference runs.  Both are within convergence / (1 - damping) of
+// the exact scores in L1, which bounds their difference.
+#define DeltaTolerance (2 * PageRankConvergence / (1 - PageRankDampening))
+
+// Checks scores against the reference's, to EPSILON or, for the delta
+// kernel, to DeltaTolerance
+template <typename G>
+static bool check_scores(G* g, const double* ref, const double* stu) {
+    if (get_pagerank_kernel() != PAGERANK_DELTA)
+        return compareApprox(g, ref, stu);
+
+    for (int i = 0; i < g->num_nodes; i++) {
+        if (fabs(ref[i] - stu[i]) > DeltaTolerance) {
+            std::cerr << "*** Results disagree at " << i << " expected "
+                      << ref[i] << " found " << stu[i] << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
 
-int main(int argc, char** argv) {
 
-    int  num_threads = -1;
-    std::string graph_filename;
+// The reference library only understands the compact graph layout.
+// Graphs with 64-bit edge offsets are checked against our own
+// implementation instead, which only exercises timing.
+static void reference_pageRank(Graph64 g, double* solution, double damping, double convergence)
+{
+    pageRank(g, solution, damping, convergence);
+}
 
-    if (argc < 2)
-    {
-        std::cerr << "Usage: <path/to/graph/file> [num_threads]\n";
-        std::cerr << "  To run results for all thread counts: <path/to/graph/file>\n";
-        std::cerr << "  Run with a certain number of threads (no correctness run): <path/to/graph/file> <num_threads>\n";
-        exit(1);
+// When the graph was relabeled (see 'graphTools reorder'), rewrites the
+// scores in solution from new to original vertex ids.
+static void to_original_ids(double* solution, int num_nodes, const Vertex* new_ids, double* scratch)
+{
+    if (new_ids == NULL)
+        return;
+    unpermute(solution, scratch, new_ids, num_nodes);
+    memcpy(solution, scratch, sizeof(double) * num_nodes);
+}
+
+// Runs PageRank with vertex ranges of equal size and with ranges of
+// equal incoming edge counts, and prints each thread's time in the pull
+// loops summed over all iterations, from the per-iteration trace.
+template <typename G>
+static void run_balance_comparison(G* g, int thread_count) {
+    if (thread_count > 0)
+        omp_set_num_threads(thread_count);
+    int threads = omp_get_max_threads();
+    double* sol = (double*)policy_alloc(sizeof(double) * g->num_nodes);
+    bool tracing = trace_enabled();
+    trace_enable(true);
+
+    printf("\n");
+    printf("Graph stats:\n");
+    printf("  Edges: %ld\n", (long) g->num_edges);
+    printf("  Nodes: %d\n", g->num_nodes);
+    printf("----------------------------------------------------------\n");
+
+    // warm up the caches and page tables
+    pageRank(g, sol, PageRankDampening, PageRankConvergence);
+
+    std::vector<double> busy[2];
+    double seconds[2];
+    for (int balanced = 0; balanced < 2; balanced++) {
+        set_edge_balancing(balanced);
+        size_t first = trace_steps().size();
+        double start = CycleTimer::currentSeconds();
+        pageRank(g, sol, PageRankDampening, PageRankConvergence);
+        seconds[balanced] = CycleTimer::currentSeconds() - start;
+
+        busy[balanced].assign(threads, 0.0);
+        const std::vector<trace_step>& steps = trace_steps();
+        for (size_t i = first; i < steps.size(); i++)
+            for (size_t t = 0; t < steps[i].busy.size() && t < (size_t) threads; t++)
+                busy[balanced][t] += steps[i].busy[t];
     }
 
-    int thread_count = -1;
-    if (argc == 3)
-    {
-        thread_count = atoi(argv[2]);
+    printf("Busy seconds per thread in the pull loops, %d threads:\n", threads);
+    printf("Thread   Vertex ranges   Edge ranges\n");
+    double most[2] = { 0, 0 }, total[2] = { 0, 0 };
+    for (int t = 0; t < threads; t++) {
+        printf("%4d:   %13.4f   %11.4f\n", t, busy[0][t], busy[1][t]);
+        for (int b = 0; b < 2; b++) {
+            most[b] = std::max(most[b], busy[b][t]);
+            total[b] += busy[b][t];
+        }
     }
+    printf("Max/mean %13.2f   %11.2f\n", most[0] * threads / total[0], most[1] * threads / total[1]);
+    printf("Time     %13.4f   %11.4f\n", seconds[0], seconds[1]);
+    printf("----------------------------------------------------------\n");
 
-    graph_filename = argv[1];
+    set_edge_balancing(true);
+    trace_enable(tracing);
+    policy_free(sol);
+}
 
-    Graph g;
+// Runs every kernel to the usual tolerance and prints its iterations,
+// the vertices and edges it processed, its time to tolerance, and its
+// largest error against a pull run with a million times tighter
+// tolerance
+template <typename G>
+static void run_kernel_comparison(G* g, int thread_count) {
+    if (thread_count > 0)
+        omp_set_num_threads(thread_count);
+    long n = g->num_nodes;
+    double* exact = (double*)policy_alloc(sizeof(double) * n);
+    double* sol = (double*)policy_alloc(sizeof(double) * n);
+    pagerank_kernel saved = get_pagerank_kernel();
 
+    printf("\n");
+    printf("Graph stats:\n");
+    printf("  Edges: %ld\n", (long) g->num_edges);
+    printf("  Nodes: %d\n", g->num_nodes);
     printf("----------------------------------------------------------\n");
-    printf("Max system threads = %d\n", omp_get_max_threads());
-    if (thread_count > 0)
-    {
-        thread_count = std::min(thread_count, omp_get_max_threads());
-        printf("Running with %d threads\n", thread_count);
+
+    set_pagerank_kernel(PAGERANK_PULL);
+    pageRank(g, exact, PageRankDampening, PageRankConvergence * 1e-6);
+
+    printf("PageRank kernels with %d threads, damping %.2f, convergence %g:\n",
+           omp_get_max_threads(), (double) PageRankDampening, (double) PageRankConvergence);
+    printf("Kernel    Iterations  Vertices      Edges         Time      Max error\n");
+    for (pagerank_kernel kernel : { PAGERANK_PULL, PAGERANK_BLOCKING, PAGERANK_DELTA }) {
+        set_pagerank_kernel(kernel);
+        pageRank(g, sol, PageRankDampening, PageRankConvergence);
+        const pagerank_stats& stats = last_pagerank_stats();
+
+        double error = 0;
+        for (long i = 0; i < n; i++)
+            error = std::max(error, fabs(sol[i] - exact[i]));
+        printf("%-8s  %-10d  %-12ld  %-12ld  %.4f s  %.3g\n", pagerank_kernel_name(kernel),
+               stats.iterations, stats.vertices, stats.edges, stats.seconds, error);
     }
     printf("----------------------------------------------------------\n");
 
-    printf("Loading graph...\n");
-    if (USE_BINARY_GRAPH) {
-      g = load_graph_binary(graph_filename.c_str());
+    set_pagerank_kernel(saved);
+    policy_free(exact);
+    policy_free(sol);
+}
+
+// Reads the seed sets given to -P: a count n picks n single-vertex sets
+// spread over the vertices with outgoing edges, anything else names a
+// file with one set per line of whitespace-separated vertex ids.  Ids
+// in files are original ids, renamed by new_ids if set.
+template <typename G>
+static void read_seed_sets(G* g, const char* spec, const Vertex* new_ids,
+                           std::vector<Vertex>* seeds, std::vector<int>* seed_starts) {
+    char* end;
+    long count = strtol(spec, &end, 10);
+    seed_starts->assign(1, 0);
+
+    if (*end == '\0') {
+        for (long i = 0; i < count; i++) {
+            Vertex v = (Vertex)(i * g->num_nodes / count);
+            for (int tries = 0; tries < g->num_nodes && outgoing_size(g, v) == 0; tries++)
+                v = (v + 1) % g->num_nodes;
+            seeds->push_back(v);
+            seed_starts->push_back(seeds->size());
+        }
     } else {
-        g = load_graph(argv[1]);
-        printf("storing binary form of graph!\n");
-        store_graph_binary(graph_filename.append(".bin").c_str(), g);
-        free_graph(g);
+        FILE* f = fopen(spec, "r");
+        if (!f) {
+            fprintf(stderr, "Could not open seed file %s\n", spec);
+            exit(1);
+        }
+        char* line = NULL;
+        size_t capacity = 0;
+        while (getline(&line, &capacity, f) > 0) {
+            std::istringstream words(line);
+            long v;
+            while (words >> v) {
+                if (v < 0 || v >= g->num_nodes) {
+                    fprintf(stderr, "Seed %ld in %s is not a vertex\n", v, spec);
+                    exit(1);
+                }
+                seeds->push_back(new_ids ? new_ids[v] : (Vertex) v);
+            }
+            if ((int) seeds->size() > seed_starts->back())
+                seed_starts->push_back(seeds->size());
+        }
+        free(line);
+        fclose(f);
+    }
+
+    if (seed_starts->size() < 2) {
+        fprintf(stderr, "No seed sets in %s\n", spec);
         exit(1);
     }
+}
+
+// One set's personalized PageRank by plain power iteration, stopped
+// once an iteration changes the scores by less than convergence
+template <typename G>
+static void reference_ppr(G* g, const Vertex* first, const Vertex* last, double damping, double convergence,
+                          double* score) {
+    long n = g->num_nodes;
+    std::vector<Vertex> seeds(first, last);
+    std::sort(seeds.begin(), seeds.end());
+    seeds.erase(std::unique(seeds.begin(), seeds.end()), seeds.end());
+    std::vector<double> next(n);
+
+    for (long v = 0; v < n; v++)
+        score[v] = 0;
+    for (Vertex s : seeds)
+        score[s] = 1.0 / seeds.size();
+
+    double diff = convergence;
+    while (diff >= convergence) {
+        double dangling = 0;
+        for (long v = 0; v < n; v++)
+            if (outgoing_size(g, (Vertex) v) == 0)
+                dangling += score[v];
+
+        diff = 0;
+        #pragma omp parallel for
+        for (long v = 0; v < n; v++) {
+            double sum = 0;
+            for (Vertex u : incoming_neighbors(g, (Vertex) v))
+                sum += score[u] / outgoing_size(g, u);
+            next[v] = damping * sum;
+        }
+        for (Vertex s : seeds)
+            next[s] += (1.0 - damping + damping * dangling) / seeds.size();
+        for (long v = 0; v < n; v++) {
+            diff += fabs(next[v] - score[v]);
+            score[v] = next[v];
+        }
+    }
+}
+
+// Computes personalized PageRank for the seed sets of -P in one batch,
+// by power iteration and, with -e, by forward push.  The first
+// PPR_CHECKED_SETS sets are checked against reference_ppr, to within
+// the error bounds the batch reports, and the top-k lists are written
+// to the -o file.
+template <typename G>
+static void run_personalized(G* g, int thread_count, const Vertex* new_ids) {
+    long n = g->num_nodes;
+    std::vector<Vertex> seeds;
+    std::vector<int> seed_starts;
+    read_seed_sets(g, ppr_seed_spec, new_ids, &seeds, &seed_starts);
+    int num_sets = seed_starts.size() - 1;
+    int checked = std::min(num_sets, PPR_CHECKED_SETS);
+
+    if (thread_count > 0)
+        omp_set_num_threads(thread_count);
+
+    printf("\n");
+    printf("Graph stats:\n");
+    printf("  Edges: %ld\n", (long) g->num_edges);
+    printf("  Nodes: %d\n", g->num_nodes);
+    printf("----------------------------------------------------------\n");
+    printf("Personalized PageRank for %d seed sets, %d per pass, with %d threads\n",
+           num_sets, PPR_LANES, omp_get_max_threads());
+
+    std::vector<double> exact((long) checked * n);
+    std::vector<double> scores((long) checked * n);
+    for (int i = 0; i < checked; i++)
+        reference_ppr(g, &seeds[seed_starts[i]], &seeds[seed_starts[i + 1]], PageRankDampening,
+                      PageRankConvergence * 1e-3, &exact[(long) i * n]);
+    // what the batch saves: one set at a time, to the batch's convergence
+    double single_time = CycleTimer::currentSeconds();
+    reference_ppr(g, &seeds[0], &seeds[seed_starts[1]], PageRankDampening, PageRankConvergence,
+                  scores.data());
+    single_time = CycleTimer::currentSeconds() - single_time;
+    // the reference's own error, the iteration being a contraction by
+    // damping in L1
+    double reference_bound = PageRankConvergence * 1e-3 * PageRankDampening / (1 - PageRankDampening);
+
+    ppr_result result;
+    std::vector<Vertex> top_vertices((long) num_sets * ppr_top_k);
+    std::vector<double> top_scores((long) num_sets * ppr_top_k);
+    std::vector<double> error_bound(num_sets);
+    result.top_vertices = top_vertices.data();
+    result.top_scores = top_scores.data();
+    result.error_bound = error_bound.data();
+
+    ppr_params params;
+    params.damping = PageRankDampening;
+    params.convergence = PageRankConvergence;
+    params.epsilon = ppr_epsilon;
+    params.top_k = ppr_top_k;
+
+    bool check = true;
+    printf("Mode   Time          Sets/sec    Max error bound  Check\n");
+    for (ppr_mode mode : { PPR_POWER, PPR_PUSH }) {
+        if (mode == PPR_PUSH && ppr_epsilon <= 0)
+            continue;
+        params.mode = mode;
+
+        // the checked sets with full scores, then the whole batch timed
+        result.scores = scores.data();
+        personalized_page_rank(g, seeds.data(), seed_starts.data(), checked, &params, &result);
+        bool mode_check = true;
+        for (int i = 0; i < checked; i++) {
+            double distance = 0;
+            for (long v = 0; v < n; v++)
+                distance += fabs(scores[(long) i * n + v] - exact[(long) i * n + v]);
+            if (distance > error_bound[i] + reference_bound + 1e-12) {
+                fprintf(stderr, "*** Set %d is %g from the reference, bound %g\n", i, distance, error_bound[i]);
+                mode_check = false;
+            }
+        }
+        check = check && mode_check;
+
+        result.scores = NULL;
+        double start = CycleTimer::currentSeconds();
+        personalized_page_rank(g, seeds.data(), seed_starts.data(), num_sets, &params, &result);
+        double batch_time = CycleTimer::currentSeconds() - start;
+
+        double max_bound = *std::max_element(error_bound.begin(), error_bound.end());
+        printf("%-5s  %.4f sec    %-10.1f  %-15.3g  %s\n", mode == PPR_POWER ? "power" : "push",
+               batch_time, num_sets / batch_time, max_bound, mode_check ? "ok" : "FAILED");
+    }
+    printf("One set at a time (plain power iteration): %.4f sec per set, %.1f sets/sec\n",
+           single_time, 1 / single_time);
+    printf("----------------------------------------------------------\n");
+
+    if (ppr_output) {
+        FILE* out = fopen(ppr_output, "w");
+        if (!out) {
+            fprintf(stderr, "Could not write %s\n", ppr_output);
+            exit(1);
+        }
+        write_ppr_top_k(out, &result, num_sets, ppr_top_k, new_ids, g->num_nodes);
+        fclose(out);
+        printf("Wrote the top %d of each set to %s\n", ppr_top_k, ppr_output);
+    }
+    free_ppr_workspaces();
+    if (!check)
+        printf("Personalized PageRank is not Correct\n");
+}
+
+// Runs the student code on g and the reference code on ref_g, which is
+// the same graph in uncompressed form.  If new_ids is set the graph was
+// relabeled, and scores are mapped back to original ids before being
+// checked.
+template <typename G, typename R>
+static void run(G* g, R* ref_g, int thread_count, const Vertex* new_ids) {
+
+    if (compare_balancing) {
+        run_balance_comparison(g, thread_count);
+        return;
+    }
+
+    if (compare_kernels) {
+        run_kernel_comparison(g, thread_count);
+        return;
+    }
+
+    if (ppr_seed_spec) {
+        run_personalized(g, thread_count, new_ids);
+        return;
+    }
+
+    double* scratch = new_ids ? (double*)malloc(sizeof(double) * g->num_nodes) : NULL;
+
     printf("\n");
     printf("Graph stats:\n");
-    printf("  Edges: %d\n", g->num_edges);
+    printf("  Edges: %ld\n", (long) g->num_edges);
     printf("  Nodes: %d\n", g->num_nodes);
 
     //If we want to run on all threads
@@ -85,15 +418,15 @@ int main(int argc, char** argv) {
         int n_usage = num_threads.size();
 
         double* sol1;
-        sol1 = (double*)malloc(sizeof(double) * g->num_nodes);
+        sol1 = (double*)policy_alloc(sizeof(double) * g->num_nodes);
         double* sol2;
-        sol2 = (double*)malloc(sizeof(double) * g->num_nodes);
+        sol2 = (double*)policy_alloc(sizeof(double) * g->num_nodes);
         double* sol3;
-        sol3 = (double*)malloc(sizeof(double) * g->num_nodes);
+        sol3 = (double*)policy_alloc(sizeof(double) * g->num_nodes);
 
         //Solution sphere
         double* sol4;
-        sol4 = (double*)malloc(sizeof(double) * g->num_nodes);
+        sol4 = (double*)policy_alloc(sizeof(double) * g->num_nodes);
 
         double pagerank_base;
         double pagerank_time;
@@ -127,7 +460,7 @@ int main(int argc, char** argv) {
 
             //Run staff reference implementation
             start = CycleTimer::currentSeconds();
-            reference_pageRank(g, sol4, PageRankDampening, PageRankConvergence);
+            reference_pageRank(ref_g, sol4, PageRankDampening, PageRankConvergence);
             ref_pagerank_time = CycleTimer::currentSeconds() - start;
 
 	    // record single thread times in order to report speedup
@@ -136,8 +469,10 @@ int main(int argc, char** argv) {
                 ref_pagerank_base = ref_pagerank_time;
             }
 
+            to_original_ids(sol1, g->num_nodes, new_ids, scratch);
+            to_original_ids(sol4, g->num_nodes, new_ids, scratch);
             std::cout << "Testing Correctness of Page Rank\n";
-            if (!compareApprox(g, sol4, sol1)) {
+            if (!check_scores(g, sol4, sol1)) {
               pr_check = false;
             }
 
@@ -175,15 +510,15 @@ int main(int argc, char** argv) {
     {
         bool pr_check = true;
         double* sol1;
-        sol1 = (double*)malloc(sizeof(double) * g->num_nodes);
+        sol1 = (double*)policy_alloc(sizeof(double) * g->num_nodes);
         double* sol2;
-        sol2 = (double*)malloc(sizeof(double) * g->num_nodes);
+        sol2 = (double*)policy_alloc(sizeof(double) * g->num_nodes);
         double* sol3;
-        sol3 = (double*)malloc(sizeof(double) * g->num_nodes);
+        sol3 = (double*)policy_alloc(sizeof(double) * g->num_nodes);
 
         //Double* sphere
         double* sol4;
-        sol4 = (double*)malloc(sizeof(double) * g->num_nodes);
+        sol4 = (double*)policy_alloc(sizeof(double) * g->num_nodes);
 
         double pagerank_base;
         double pagerank_time;
@@ -210,11 +545,13 @@ int main(int argc, char** argv) {
 
         //Run reference implementation
         start = CycleTimer::currentSeconds();
-        reference_pageRank(g, sol4, PageRankDampening, PageRankConvergence);
+        reference_pageRank(ref_g, sol4, PageRankDampening, PageRankConvergence);
         ref_pagerank_time = CycleTimer::currentSeconds() - start;
 
+        to_original_ids(sol1, g->num_nodes, new_ids, scratch);
+        to_original_ids(sol4, g->num_nodes, new_ids, scratch);
         std::cout << "Testing Correctness of Page Rank\n";
-        if (!compareApprox(g, sol4, sol1)) {
+        if (!check_scores(g, sol4, sol1)) {
           pr_check = false;
         }
 
@@ -240,7 +577,199 @@ int main(int argc, char** argv) {
         printf("----------------------------------------------------------\n");
     }
 
+    print_memory_policy_report(stdout);
+    printf("----------------------------------------------------------\n");
+
+    free(scratch);
+}
+
+// Runs on the loaded graph, or on its compressed form if requested
+template <typename G>
+static void run_layout(G* g, bool compressed, int thread_count, const Vertex* new_ids) {
+    if (!compressed) {
+        run(g, g, thread_count, new_ids);
+        return;
+    }
+
+    printf("Compressing graph...\n");
+    auto cg = compress_graph(g);
+    printf("  Adjacency: %.1f MB -> %.1f MB\n",
+           2.0 * sizeof(Vertex) * g->num_edges / (1 << 20),
+           (double) compressed_adjacency_bytes(cg) / (1 << 20));
+    run(cg, g, thread_count, new_ids);
+    free_graph(cg);
+}
+
+template <typename G>
+static void check_permutation(G* g, const char* perm_filename, Vertex perm_nodes) {
+    if (perm_filename && perm_nodes != g->num_nodes) {
+        fprintf(stderr, "Permutation %s has %d vertices, graph has %d\n",
+                perm_filename, perm_nodes, g->num_nodes);
+        exit(1);
+    }
+}
+
+// Writes the iterations traced during the run to the files given by -t
+// and -T
+static void save_traces(const char* trace_filename, const char* chrome_trace_filename) {
+    if (trace_filename)
+        trace_save(trace_filename, false);
+    if (chrome_trace_filename)
+        trace_save(chrome_trace_filename, true);
+    if (trace_filename || chrome_trace_filename)
+        printf("Traced %zu iterations\n", trace_steps().size());
+}
+
+int main(int argc, char** argv) {
+
+    int  num_threads = -1;
+    std::string graph_filename;
+
+    bool compressed = false;
+    const char* perm_filename = NULL;
+    memory_policy policy = get_memory_policy();
+    const char* trace_filename = NULL;
+    const char* chrome_trace_filename = NULL;
+    pagerank_kernel kernel = get_pagerank_kernel();
+    int opt;
+    while ((opt = getopt(argc, argv, "bck:Kp:m:t:T:P:e:n:o:")) != -1) {
+        switch (opt) {
+        case 'b':
+            compare_balancing = true;
+            break;
+        case 'c':
+            compressed = true;
+            break;
+        case 'k':
+            if (!parse_pagerank_kernel(optarg, &kernel)) {
+                std::cerr << "Unknown PageRank kernel: " << optarg << "\n";
+                argc = 0;
+            }
+            break;
+        case 'K':
+            compare_kernels = true;
+            break;
+        case 'p':
+            perm_filename = optarg;
+            break;
+        case 'm':
+            if (!parse_memory_policy(optarg, &policy)) {
+                std::cerr << "Unknown memory policy: " << optarg << "\n";
+                argc = 0;
+            }
+            break;
+        case 'P':
+            ppr_seed_spec = optarg;
+            break;
+        case 'e':
+            ppr_epsilon = atof(optarg);
+            if (ppr_epsilon <= 0) {
+                std::cerr << "-e needs an epsilon > 0\n";
+                argc = 0;
+            }
+            break;
+        case 'n':
+            ppr_top_k = atoi(optarg);
+            if (ppr_top_k < 1) {
+                std::cerr << "-n needs a top-k length of at least 1\n";
+                argc = 0;
+            }
+            break;
+        case 'o':
+            ppr_output = optarg;
+            break;
+        case 't':
+            trace_filename = optarg;
+            break;
+        case 'T':
+            chrome_trace_filename = optarg;
+            break;
+        default:
+            argc = 0;
+        }
+    }
+
+    if (argc - optind < 1)
+    {
+        std::cerr << "Usage: [-b] [-c] [-k kernel] [-K] [-p perm_file] [-m memory_policy] [-t trace] [-T trace] [-P seeds [-e epsilon] [-n top_k] [-o file]] <path/to/graph/file> [num_threads]\n";
+        std::cerr << "  To run results for all thread counts: <path/to/graph/file>\n";
+        std::cerr << "  Run with a certain number of threads (no correctness run): <path/to/graph/file> <num_threads>\n";
+        std::cerr << "  -b: print each thread's busy time with vertex ranges of equal size and of\n";
+        std::cerr << "      equal incoming edge counts\n";
+        std::cerr << "  -c: run on the compressed (varint) adjacency layout\n";
+        std::cerr << "  -k: PageRank kernel: pull (default), blocking or delta\n";
+        std::cerr << "      blocking: propagation blocking, which streams contributions through\n";
+        std::cerr << "      cache-sized bins, for graphs far larger than the last-level cache\n";
+        std::cerr << "      delta: processes only vertices whose scores still change; checked to\n";
+        std::cerr << "      2 * convergence / (1 - damping) instead of EPSILON\n";
+        std::cerr << "  -K: run each kernel to tolerance and print its iterations, work and error\n";
+        std::cerr << "  -p: the graph was relabeled by 'graphTools reorder' with this permutation\n";
+        std::cerr << "  -m: placement and page size of graph and result arrays, e.g. interleave,thp\n";
+        std::cerr << "      placement: default, interleave, local (parallel first touch)\n";
+        std::cerr << "      pages:     small, thp (transparent 2MB), huge (explicit 2MB)\n";
+        std::cerr << "  -t: write every iteration of every run to this file, as CSV if it ends in\n";
+        std::cerr << "      .csv and as JSON otherwise\n";
+        std::cerr << "  -T: write the iterations as a Chrome trace (chrome://tracing, ui.perfetto.dev)\n";
+        std::cerr << "  -P: personalized PageRank for a batch of seed sets: a count of single-vertex\n";
+        std::cerr << "      sets, or a file with one set of vertex ids per line\n";
+        std::cerr << "  -e: also run forward push, to this residual per outgoing edge\n";
+        std::cerr << "  -n: length of the top-k lists (default 10)\n";
+        std::cerr << "  -o: write the top-k lists as tab-separated set, rank, vertex, score\n";
+        exit(1);
+    }
+
+    int thread_count = -1;
+    if (argc - optind == 2)
+    {
+        thread_count = atoi(argv[optind + 1]);
+    }
+
+    graph_filename = argv[optind];
+
+    Graph g;
+
+    printf("----------------------------------------------------------\n");
+    printf("Max system threads = %d\n", omp_get_max_threads());
+    if (thread_count > 0)
+    {
+        thread_count = std::min(thread_count, omp_get_max_threads());
+        printf("Running with %d threads\n", thread_count);
+    }
+    printf("----------------------------------------------------------\n");
+
+    Vertex* new_ids = NULL;
+    Vertex perm_nodes = 0;
+    if (perm_filename)
+        new_ids = load_permutation(perm_filename, &perm_nodes);
+
+    set_memory_policy(&policy);
+    set_pagerank_kernel(kernel);
+    trace_enable(trace_filename || chrome_trace_filename);
+
+    printf("Loading graph...\n");
+    if (USE_BINARY_GRAPH && graph_file_needs_wide_offsets(graph_filename.c_str())) {
+        Graph64 g64 = load_graph_binary64(graph_filename.c_str());
+        check_permutation(g64, perm_filename, perm_nodes);
+        run_layout(g64, compressed, thread_count, new_ids);
+        free_graph(g64);
+        free(new_ids);
+        save_traces(trace_filename, chrome_trace_filename);
+        return 0;
+    } else if (USE_BINARY_GRAPH) {
+      g = load_graph_binary(graph_filename.c_str());
+    } else {
+        g = load_graph(graph_filename.c_str());
+        printf("storing binary form of graph!\n");
+        store_graph_binary(graph_filename.append(".bin").c_str(), g);
+        free_graph(g);
+        exit(1);
+    }
+    check_permutation(g, perm_filename, perm_nodes);
+    run_layout(g, compressed, thread_count, new_ids);
+
     free_graph(g);
+    free(new_ids);
+    save_traces(trace_filename, chrome_trace_filename);
 
     return 0;
 }
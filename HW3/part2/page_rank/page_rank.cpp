@@ -1,5 +1,6 @@
 #include "page_rank.h"
 
+#include <algorithm>
 #include <cstring>
 #include <stdlib.h>
 #include <cmath>
@@ -9,76 +10,585 @@
 
 #include "../common/CycleTimer.h"
 #include "../common/graph.h"
+#include "../common/compressed_graph.h"
+#include "../common/edge_partition.h"
+#include "../common/memory_policy.h"
+#include "../common/trace.h"
 
-// pageRank --
-//
-// g:           graph to process (see common/graph.h)
-// solution:    array of per-vertex vertex scores (length of array is num_nodes(g))
-// damping:     page-rank algorithm's damping parameter
-// convergence: page-rank algorithm's convergence threshold
-//
-void pageRank(Graph g, double *solution, double damping, double convergence)
+// Vertices per propagation-blocking bin, as a power of two.  A bin's
+// sums take 8 bytes per vertex and should stay in L2.  At most 16, as
+// destinations are stored as 16-bit offsets within their bin.
+#define PAGERANK_BIN_BITS 15
+
+// Frontier vertices a thread collects before appending them to the
+// shared frontier, in the delta kernel
+#define FRONTIER_CHUNK 256
+
+// The delta kernel pushes a round while its frontier's outgoing edges
+// are at most 1 / DELTA_PUSH_FRACTION of the graph's, else it pulls
+#define DELTA_PUSH_FRACTION 16
+
+static pagerank_kernel current_pagerank_kernel = PAGERANK_PULL;
+static pagerank_stats last_stats;
+
+void set_pagerank_kernel(pagerank_kernel kernel)
 {
-    /*
-     For PP students: Implement the page rank algorithm here.  You
-     are expected to parallelize the algorithm using openMP.  Your
-     solution may need to allocate (and free) temporary arrays.
+    current_pagerank_kernel = kernel;
+}
 
-     Basic page rank pseudocode is provided below to get you started:
+pagerank_kernel get_pagerank_kernel()
+{
+    return current_pagerank_kernel;
+}
 
-     // initialization: see example code above
-    */
+const char* pagerank_kernel_name(pagerank_kernel kernel)
+{
+    switch (kernel) {
+    case PAGERANK_BLOCKING:
+        return "blocking";
+    case PAGERANK_DELTA:
+        return "delta";
+    default:
+        return "pull";
+    }
+}
+
+bool parse_pagerank_kernel(const char* name, pagerank_kernel* kernel)
+{
+    for (pagerank_kernel k : { PAGERANK_PULL, PAGERANK_BLOCKING, PAGERANK_DELTA }) {
+        if (strcmp(name, pagerank_kernel_name(k)) == 0) {
+            *kernel = k;
+            return true;
+        }
+    }
+    return false;
+}
+
+const pagerank_stats& last_pagerank_stats()
+{
+    return last_stats;
+}
+
+// Sets every score to 1 / num_nodes, fills inverse_degree with 1 /
+// outgoing_size(v), or 0 for vertices without outgoing edges, and contrib
+// with score * inverse_degree.  Returns the scores of the vertices
+// without outgoing edges, which are spread over all vertices instead.
+template <typename G>
+static double init_scores(G* g, double *score, double *contrib, double *inverse_degree)
+{
+    const int numNodes = num_nodes(g);
+    double equal_prob = 1.0 / numNodes;
+    double tail_sum = 0.0;
+
+    #pragma omp parallel for reduction(+:tail_sum)
+    for (int i = 0; i < numNodes; i++) {
+        long degree = outgoing_size(g, i);
+        inverse_degree[i] = degree ? 1.0 / degree : 0.0;
+        score[i] = equal_prob;
+        contrib[i] = equal_prob * inverse_degree[i];
+        if (degree == 0)
+            tail_sum += equal_prob;
+    }
+    return tail_sum;
+}
+
+// Pull PageRank: every vertex sums the contributions of its incoming
+// neighbors.
+template <typename G>
+static void pageRank_pull(G* g, double *solution, double damping, double convergence)
+{
     const int numNodes = num_nodes(g);
     bool converged = false;
 
-    // initialize vertex weights to uniform probability. Double
-    // precision scores are used to avoid underflow for large graphs
-    double *pr_t = (double *)malloc(sizeof(double) * numNodes);
-    double equal_prob = 1.0 / numNodes;
-    std::vector<Vertex> tail_nodes;
-    for (int i = 0; i < numNodes; ++i) {
-        pr_t[i] = equal_prob;
-        if (outgoing_size(g, i) == 0) {
-            tail_nodes.push_back(i);
+    // Scores are double buffered between solution and next_score, and
+    // each vertex's score is pushed to its edges as contrib[v] =
+    // score[v] / outgoing_size(v), so the inner loop reads one array and
+    // no degrees.  inverse_degree is 0 for vertices without outgoing
+    // edges, whose scores are spread over all vertices instead.  Double
+    // precision scores are used to avoid underflow for large graphs.
+    double *score = solution;
+    double *next_score = (double *)policy_alloc(sizeof(double) * numNodes);
+    double *contrib = (double *)policy_alloc(sizeof(double) * numNodes);
+    double *next_contrib = (double *)policy_alloc(sizeof(double) * numNodes);
+    double *inverse_degree = (double *)policy_alloc(sizeof(double) * numNodes);
+
+    double tail_sum = init_scores(g, score, contrib, inverse_degree);
+
+    // vertex ranges of equal incoming edge counts, see edge_partition.h
+    const edge_partition* partition = incoming_partition(g, omp_get_max_threads());
+
+    int run = trace_enabled() ? trace_begin_run() : 0;
+    int iteration = 0;
+
+    while (!converged) {
+        last_stats.iterations++;
+        double start_time = trace_now();
+        double *busy = trace_busy_slots(omp_get_max_threads());
+
+        // common score from the vertices without outgoing edges
+        double base_score = (1.0 - damping) / numNodes + damping * tail_sum / numNodes;
+
+        // One pass computes the new scores, how much they changed, and
+        // the contributions and tail sum of the next iteration
+        double global_diff = 0.0;
+        double next_tail_sum = 0.0;
+        #pragma omp parallel reduction(+:global_diff, next_tail_sum)
+        {
+            double thread_start = busy ? CycleTimer::currentSeconds() : 0;
+
+            #pragma omp for nowait schedule(dynamic, 1)
+            for (int p = 0; p < partition->num_parts; p++) {
+                for (int i = partition->starts[p]; i < partition->starts[p + 1]; i++) {
+                    double sum = 0.0;
+                    for (Vertex j : incoming_neighbors(g, i))
+                        sum += contrib[j];
+
+                    double s = base_score + damping * sum;
+                    next_score[i] = s;
+                    next_contrib[i] = s * inverse_degree[i];
+                    if (inverse_degree[i] == 0.0)
+                        next_tail_sum += s;
+
+                    // compute how much per-node scores have changed
+                    global_diff += std::fabs(s - score[i]);
+                }
+            }
+
+            if (busy)
+                busy[omp_get_thread_num()] += CycleTimer::currentSeconds() - thread_start;
         }
+
+        trace_record("pagerank", run, iteration++, numNodes, (long) num_edges(g), "pull", global_diff,
+                     start_time, trace_now() - start_time);
+        last_stats.vertices += numNodes;
+        last_stats.edges += (long) num_edges(g);
+
+        // quit once algorithm has converged
+        converged = (global_diff < convergence);
+
+        std::swap(score, next_score);
+        std::swap(contrib, next_contrib);
+        tail_sum = next_tail_sum;
     }
 
-    while (!converged) {
-        double *pr_t1 = (double *)malloc(sizeof(double) * numNodes);
+    // after an odd number of iterations the scores are in the scratch buffer
+    if (score != solution) {
+        memcpy(solution, score, sizeof(double) * numNodes);
+        next_score = score;
+    }
+    policy_free(next_score);
+    policy_free(contrib);
+    policy_free(next_contrib);
+    policy_free(inverse_degree);
+}
+
 
-        // Calculate common score for no outgoing nodes
-        double tail_score = 0.0;
-        #pragma omp parallel for reduction(+:tail_score)
-        for (int i = 0; i < tail_nodes.size(); i++) {
-            tail_score += pr_t[tail_nodes[i]];
+// Propagation-blocking PageRank (Beamer, Asanovic and Patterson,
+// "Reducing PageRank Communication via Propagation Blocking").  The pull
+// loop reads contrib[] at random, which misses the cache on every edge
+// once the vertex arrays outgrow it.  Here each iteration streams
+// instead:
+//
+//   binning:    every source appends its contribution, once per
+//               outgoing edge, to the bin of the edge's destination;
+//               bins are ranges of 2^PAGERANK_BIN_BITS vertices
+//   accumulate: every bin adds its contributions into a sum array the
+//               size of one bin, which stays in cache, then finishes the
+//               bin's scores as the pull loop does
+//
+// The destinations of a bin's entries are the same in every iteration,
+// so they are written once, as offsets within the bin, and binning only
+// writes contributions.  Sources are split into blocks of equal outgoing
+// edge counts, and each block's entries of a bin are contiguous, so
+// binning needs no atomics and every bin is one contiguous range.  The
+// bins cost 10 bytes per edge.
+template <typename G>
+static void pageRank_blocking(G* g, double *solution, double damping, double convergence)
+{
+    const int numNodes = num_nodes(g);
+    const long numEdges = (long) g->outgoing_starts[numNodes];
+    const int bin_size = 1 << PAGERANK_BIN_BITS;
+    const int num_bins = (numNodes + bin_size - 1) >> PAGERANK_BIN_BITS;
+    const int num_threads = omp_get_max_threads();
+    const int num_blocks = num_threads * EDGE_PARTITION_PARTS_PER_THREAD;
+    bool converged = false;
+
+    // Scores are updated in place: the accumulate phase reads a vertex's
+    // old score only where it writes the new one
+    double *score = solution;
+    double *contrib = (double *)policy_alloc(sizeof(double) * numNodes);
+    double *inverse_degree = (double *)policy_alloc(sizeof(double) * numNodes);
+    double tail_sum = init_scores(g, score, contrib, inverse_degree);
+
+    std::vector<Vertex> block_starts(num_blocks + 1);
+    split_by_edges(g->outgoing_starts, numNodes, num_blocks, block_starts.data());
+
+    // block_offsets[k * num_bins + b]: where block k's entries of bin b
+    // start.  Counted per block, then laid out bin by bin.
+    std::vector<long> block_offsets((long) num_blocks * num_bins + 1, 0);
+    #pragma omp parallel for schedule(dynamic, 1)
+    for (int k = 0; k < num_blocks; k++) {
+        long *counts = &block_offsets[(long) k * num_bins];
+        for (Vertex u = block_starts[k]; u < block_starts[k + 1]; u++)
+            for (Vertex v : outgoing_neighbors(g, u))
+                counts[v >> PAGERANK_BIN_BITS]++;
+    }
+    std::vector<long> bin_starts(num_bins + 1);
+    long running = 0;
+    for (int b = 0; b < num_bins; b++) {
+        bin_starts[b] = running;
+        for (int k = 0; k < num_blocks; k++) {
+            long count = block_offsets[(long) k * num_bins + b];
+            block_offsets[(long) k * num_bins + b] = running;
+            running += count;
         }
-        tail_score = tail_score * damping / numNodes;
+    }
+    bin_starts[num_bins] = running;
+
+    uint16_t *destinations = (uint16_t *)policy_alloc(sizeof(uint16_t) * numEdges);
+    double *values = (double *)policy_alloc(sizeof(double) * numEdges);
+    std::vector<long> cursors((long) num_threads * num_bins);
+    std::vector<double> sums((long) num_threads * bin_size);
+
+    #pragma omp parallel for schedule(dynamic, 1)
+    for (int k = 0; k < num_blocks; k++) {
+        long *cursor = &cursors[(long) omp_get_thread_num() * num_bins];
+        memcpy(cursor, &block_offsets[(long) k * num_bins], sizeof(long) * num_bins);
+        for (Vertex u = block_starts[k]; u < block_starts[k + 1]; u++)
+            for (Vertex v : outgoing_neighbors(g, u))
+                destinations[cursor[v >> PAGERANK_BIN_BITS]++] = v & (bin_size - 1);
+    }
+
+    int run = trace_enabled() ? trace_begin_run() : 0;
+    int iteration = 0;
+
+    while (!converged) {
+        last_stats.iterations++;
+        double start_time = trace_now();
+        double *busy = trace_busy_slots(num_threads);
+
+        // common score from the vertices without outgoing edges
+        double base_score = (1.0 - damping) / numNodes + damping * tail_sum / numNodes;
 
         double global_diff = 0.0;
-        #pragma omp parallel for reduction(+:global_diff)
-        for (int i = 0; i < numNodes; i++) {
-            double score = 0.0;
-
-            const Vertex* start = incoming_begin(g, i);
-            const Vertex* end = incoming_end(g, i);
-            for (const Vertex* j = start; j != end; j++) {
-                score += pr_t[*j] / outgoing_size(g, *j);
+        double next_tail_sum = 0.0;
+        #pragma omp parallel reduction(+:global_diff, next_tail_sum)
+        {
+            double thread_start = busy ? CycleTimer::currentSeconds() : 0;
+            int tid = omp_get_thread_num();
+
+            // binning
+            long *cursor = &cursors[(long) tid * num_bins];
+            #pragma omp for schedule(dynamic, 1)
+            for (int k = 0; k < num_blocks; k++) {
+                memcpy(cursor, &block_offsets[(long) k * num_bins], sizeof(long) * num_bins);
+                for (Vertex u = block_starts[k]; u < block_starts[k + 1]; u++) {
+                    double c = contrib[u];
+                    for (Vertex v : outgoing_neighbors(g, u))
+                        values[cursor[v >> PAGERANK_BIN_BITS]++] = c;
+                }
             }
 
-            pr_t1[i] = (1.0 - damping) / numNodes + (damping * score) + tail_score;
+            // accumulate, then finish the bin's scores and the
+            // contributions and tail sum of the next iteration
+            double *sum = &sums[(long) tid * bin_size];
+            #pragma omp for nowait schedule(dynamic, 1)
+            for (int b = 0; b < num_bins; b++) {
+                memset(sum, 0, sizeof(double) * bin_size);
+                for (long e = bin_starts[b]; e < bin_starts[b + 1]; e++)
+                    sum[destinations[e]] += values[e];
+
+                Vertex first = (Vertex) b << PAGERANK_BIN_BITS;
+                Vertex last = std::min(first + bin_size, numNodes);
+                for (Vertex i = first; i < last; i++) {
+                    double s = base_score + damping * sum[i - first];
+                    contrib[i] = s * inverse_degree[i];
+                    if (inverse_degree[i] == 0.0)
+                        next_tail_sum += s;
+
+                    // compute how much per-node scores have changed
+                    global_diff += std::fabs(s - score[i]);
+                    score[i] = s;
+                }
+            }
 
-            // compute how much per-node scores have changed
-            global_diff += abs(pr_t1[i] - pr_t[i]);
+            if (busy)
+                busy[tid] += CycleTimer::currentSeconds() - thread_start;
         }
 
+        trace_record("pagerank", run, iteration++, numNodes, numEdges, "push", global_diff,
+                     start_time, trace_now() - start_time);
+        last_stats.vertices += numNodes;
+        last_stats.edges += numEdges;
+
         // quit once algorithm has converged
         converged = (global_diff < convergence);
+        tail_sum = next_tail_sum;
+    }
+
+    policy_free(contrib);
+    policy_free(inverse_degree);
+    policy_free(destinations);
+    policy_free(values);
+}
+
+// Appends count vertices collected by one thread to the next frontier
+static void append_active(Vertex *frontier, int *count, const Vertex *chunk, int chunk_count)
+{
+    int index = __sync_fetch_and_add(count, chunk_count);
+    memcpy(frontier + index, chunk, sizeof(Vertex) * chunk_count);
+}
+
+// A share of residual sent to vertex in a push round of the delta kernel
+struct delta_message {
+    Vertex vertex;
+    double share;
+};
+
+// Delta PageRank (push-style Jacobi; see McSherry, "A uniform approach
+// to accelerated PageRank computation", and PageRankDelta in Ligra).
+// Every vertex holds a residual, the score it has been sent but not yet
+// passed on.  Processing a vertex moves its residual into its score and
+// sends damping * residual / outgoing_size to each outgoing neighbor,
+// or damping * residual / n to every vertex if it has none, as the pull
+// kernel spreads their scores.  That spread is held back as one pending
+// residual of all vertices, which pull rounds add as they visit every
+// vertex anyway.
+//
+// Scores start at 0 and residuals at the teleport share (1 - damping) /
+// n, but the first round moves 1 / n into every score instead, the pull
+// kernel's start.  Residuals then carry corrections of either sign,
+// which sum to 0 and largely cancel, rather than the whole score.
+//
+// A vertex is on the frontier while |residual| exceeds threshold *
+// (outgoing_size + 1), with threshold = convergence / (m + n), as in
+// Andersen, Chung and Lang's push: a vertex is processed only once its
+// residual pays for its edges.  The loop ends when the frontier empties
+// or the residuals sum to at most convergence in absolute value, which
+// bounds the error of the scores by convergence / (1 - damping).
+//
+// Rounds are bulk synchronous and need no atomics on scores: the
+// frontier first takes its residuals, then they are delivered one of two
+// ways, like the top-down and bottom-up steps of breadth-first search:
+//
+//   push: while the frontier's outgoing edges are at most m /
+//         DELTA_PUSH_FRACTION, every thread sends its shares to the
+//         thread owning their destination (v % num_threads), which adds
+//         them up after a barrier.  Messages cost at most 16 /
+//         DELTA_PUSH_FRACTION bytes per edge.
+//   pull: larger frontiers publish their shares, and every vertex sums
+//         the shares of its incoming neighbors, as the pull kernel does.
+template <typename G>
+static void pageRank_delta(G* g, double *solution, double damping, double convergence)
+{
+    const int numNodes = num_nodes(g);
+    const long numEdges = (long) num_edges(g);
+    const int num_threads = omp_get_max_threads();
+    const double threshold = convergence / ((double) numEdges + numNodes);
+    double *score = solution;
+    double *residual = (double *)policy_alloc(sizeof(double) * numNodes);
+    // damping * residual / outgoing_size of a pull round's frontier, else 0
+    double *share = (double *)policy_alloc(sizeof(double) * numNodes);
+    // whether a vertex is on the next frontier
+    char *queued = (char *)policy_alloc(numNodes);
+    Vertex *frontier = (Vertex *)policy_alloc(sizeof(Vertex) * numNodes);
+    Vertex *next_frontier = (Vertex *)policy_alloc(sizeof(Vertex) * numNodes);
+    // messages[sender * num_threads + owner], kept across rounds
+    std::vector<std::vector<delta_message>> messages((long) num_threads * num_threads);
+    const edge_partition* partition = incoming_partition(g, num_threads);
 
-        free(pr_t);
-        pr_t = pr_t1;
-        pr_t1 = NULL;
+    #pragma omp parallel for
+    for (int i = 0; i < numNodes; i++) {
+        score[i] = 0.0;
+        residual[i] = (1.0 - damping) / numNodes;
+        share[i] = 0.0;
+        queued[i] = 0;
+        frontier[i] = i;
     }
 
-    memcpy(solution, pr_t, sizeof(double) * numNodes);
-    free(pr_t);
+    int frontier_count = numNodes;
+    long frontier_edges = numEdges;
+    // the sum of |residual|, not counting spread, the residual pending
+    // at every vertex
+    double total_residual = 1.0 - damping;
+    double spread = 0.0;
+    bool first = true;
+
+    int run = trace_enabled() ? trace_begin_run() : 0;
+    int iteration = 0;
+
+    // an empty frontier still takes a pull round to add pending spread
+    while ((frontier_count > 0 || spread != 0.0) &&
+           total_residual + numNodes * std::fabs(spread) > convergence) {
+        last_stats.iterations++;
+        double start_time = trace_now();
+        double *busy = trace_busy_slots(num_threads);
+        const bool push = frontier_count > 0 && frontier_edges <= numEdges / DELTA_PUSH_FRACTION;
+
+        int next_count = 0;
+        long next_edges = 0;
+        double moved = 0.0;
+        double change = 0.0;
+        double fired_spread = 0.0;
+        #pragma omp parallel reduction(+:next_edges, moved, change)
+        {
+            double thread_start = busy ? CycleTimer::currentSeconds() : 0;
+            const int tid = omp_get_thread_num();
+            const int threads = omp_get_num_threads();
+            Vertex chunk[FRONTIER_CHUNK];
+            int chunk_count = 0;
+
+            // v joins the next frontier once, when its residual first
+            // exceeds its threshold
+            auto update = [&](Vertex v, double old, double value) {
+                residual[v] = value;
+                change += std::fabs(value) - std::fabs(old);
+                long degree = outgoing_size(g, v);
+                if (!queued[v] && std::fabs(value) > threshold * (degree + 1)) {
+                    queued[v] = 1;
+                    next_edges += degree;
+                    chunk[chunk_count++] = v;
+                    if (chunk_count == FRONTIER_CHUNK) {
+                        append_active(next_frontier, &next_count, chunk, chunk_count);
+                        chunk_count = 0;
+                    }
+                }
+            };
+
+            double thread_spread = 0.0;
+            #pragma omp for nowait schedule(dynamic, 64)
+            for (int k = 0; k < frontier_count; k++) {
+                Vertex u = frontier[k];
+                double old = residual[u];
+                double r = first ? 1.0 / numNodes : old;
+                queued[u] = 0;
+                if (first)
+                    update(u, old, old - r);
+                else {
+                    residual[u] = 0.0;
+                    change -= std::fabs(old);
+                }
+                score[u] += r;
+                moved += std::fabs(r);
+
+                long degree = outgoing_size(g, u);
+                if (degree == 0) {
+                    thread_spread += damping * r / numNodes;
+                    continue;
+                }
+                double s = damping * r / degree;
+                if (!push) {
+                    share[u] = s;
+                    continue;
+                }
+                std::vector<delta_message> *outbox = &messages[(long) tid * threads];
+                for (Vertex v : outgoing_neighbors(g, u))
+                    outbox[v % threads].push_back({ v, s });
+            }
+            #pragma omp atomic
+            fired_spread += thread_spread;
+            #pragma omp barrier
+
+            if (push) {
+                for (int t = 0; t < threads; t++) {
+                    std::vector<delta_message>& inbox = messages[(long) t * threads + tid];
+                    for (const delta_message& message : inbox) {
+                        Vertex v = message.vertex;
+                        update(v, residual[v], residual[v] + message.share);
+                    }
+                    inbox.clear();
+                }
+            } else {
+                #pragma omp for schedule(dynamic, 1)
+                for (int p = 0; p < partition->num_parts; p++) {
+                    for (int i = partition->starts[p]; i < partition->starts[p + 1]; i++) {
+                        double sum = spread + fired_spread;
+                        for (Vertex j : incoming_neighbors(g, i))
+                            sum += share[j];
+                        if (sum != 0.0)
+                            update(i, residual[i], residual[i] + sum);
+                    }
+                }
+
+                #pragma omp for nowait
+                for (int k = 0; k < frontier_count; k++)
+                    share[frontier[k]] = 0.0;
+            }
+            append_active(next_frontier, &next_count, chunk, chunk_count);
+
+            if (busy)
+                busy[tid] += CycleTimer::currentSeconds() - thread_start;
+        }
+
+        long edges = push ? frontier_edges : numEdges;
+        trace_record("pagerank", run, iteration++, frontier_count, edges, push ? "push" : "pull", moved,
+                     start_time, trace_now() - start_time);
+        last_stats.vertices += frontier_count;
+        last_stats.edges += edges;
+
+        std::swap(frontier, next_frontier);
+        frontier_count = next_count;
+        frontier_edges = next_edges;
+        total_residual += change;
+        spread = push ? spread + fired_spread : 0.0;
+        first = false;
+    }
+
+    policy_free(residual);
+    policy_free(share);
+    policy_free(queued);
+    policy_free(frontier);
+    policy_free(next_frontier);
+}
+
+// pageRank --
+//
+// g:           graph to process (see common/graph.h)
+// solution:    array of per-vertex vertex scores (length of array is num_nodes(g))
+// damping:     page-rank algorithm's damping parameter
+// convergence: page-rank algorithm's convergence threshold
+//
+template <typename G>
+static void pageRank_impl(G* g, double *solution, double damping, double convergence)
+{
+    /*
+     For PP students: Implement the page rank algorithm here.  You
+     are expected to parallelize the algorithm using openMP.  Your
+     solution may need to allocate (and free) temporary arrays.
+
+     Basic page rank pseudocode is provided below to get you started:
+
+     // initialization: see example code above
+    */
+    double start = CycleTimer::currentSeconds();
+    last_stats = pagerank_stats();
+
+    if (current_pagerank_kernel == PAGERANK_BLOCKING)
+        pageRank_blocking(g, solution, damping, convergence);
+    else if (current_pagerank_kernel == PAGERANK_DELTA)
+        pageRank_delta(g, solution, damping, convergence);
+    else
+        pageRank_pull(g, solution, damping, convergence);
+
+    last_stats.seconds = CycleTimer::currentSeconds() - start;
+}
+
+void pageRank(Graph g, double *solution, double damping, double convergence)
+{
+    pageRank_impl(g, solution, damping, convergence);
+}
+
+void pageRank(Graph64 g, double *solution, double damping, double convergence)
+{
+    pageRank_impl(g, solution, damping, convergence);
+}
+
+void pageRank(CompressedGraph g, double *solution, double damping, double convergence)
+{
+    pageRank_impl(g, solution, damping, convergence);
+}
+
+void pageRank(CompressedGraph64 g, double *solution, double damping, double convergence)
+{
+    pageRank_impl(g, solution, damping, convergence);
 }
@@ -2,7 +2,50 @@
 #define __PAGE_RANK_H__
 
 #include "common/graph.h"
+#include "common/compressed_graph.h"
+
+// How pageRank computes an iteration
+enum pagerank_kernel
+{
+    // every vertex sums its incoming neighbors' contributions
+    PAGERANK_PULL,
+    // propagation blocking: contributions are pushed into bins of
+    // destinations, which are then summed bin by bin.  Faster once the
+    // score arrays are much larger than the last-level cache; needs 10
+    // bytes per edge.
+    PAGERANK_BLOCKING,
+    // delta PageRank: only vertices whose pending score change (residual)
+    // exceeds their share of convergence, in proportion to their degree,
+    // are processed, passing it on to their neighbors, until the
+    // residuals sum to at most convergence
+    PAGERANK_DELTA,
+};
+
+// Selects the kernel for later pageRank calls; pull by default
+void set_pagerank_kernel(pagerank_kernel kernel);
+pagerank_kernel get_pagerank_kernel();
+
+// "pull", "blocking" or "delta"
+const char* pagerank_kernel_name(pagerank_kernel kernel);
+bool parse_pagerank_kernel(const char* name, pagerank_kernel* kernel);
+
+// What the last pageRank call did
+struct pagerank_stats
+{
+    // iterations; rounds over the frontier for the delta kernel
+    int iterations;
+    // vertices updated and edges scanned, over all iterations
+    long vertices;
+    long edges;
+    // time to reach the tolerance
+    double seconds;
+};
+
+const pagerank_stats& last_pagerank_stats();
 
 void pageRank(Graph g, double* solution, double damping, double convergence);
+void pageRank(Graph64 g, double* solution, double damping, double convergence);
+void pageRank(CompressedGraph g, double* solution, double damping, double convergence);
+void pageRank(CompressedGraph64 g, double* solution, double damping, double convergence);
 
 #endif /* __PAGE_RANK_H__ */
@@ -0,0 +1,671 @@
+#include "ppr.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+#include <omp.h>
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+#include "common/edge_partition.h"
+
+static_assert(PPR_LANES >= 1 && PPR_LANES <= 32, "seed masks have 32 bits");
+static_assert((PPR_LANES & (PPR_LANES - 1)) == 0, "lane vectors have a power of two lanes");
+
+// One score per set of a pass
+struct lanes
+{
+    double x[PPR_LANES];
+};
+
+// The same as a GCC vector, for sums over neighbors.  GCC vectorizes a
+// neighbor loop of lane loops across two neighbors at a time, scalar
+// per lane and through memory; a vector sum stays in registers, one zmm
+// or two ymm wide.
+typedef double lane_vector __attribute__((vector_size(sizeof(lanes))));
+
+#define PPR_INLINE inline __attribute__((always_inline))
+
+static PPR_INLINE void add_scaled_lanes(lane_vector& sum, const lanes& a, double scale)
+{
+    lane_vector v;
+    memcpy(&v, &a, sizeof(v));
+    sum += v * scale;
+}
+
+static PPR_INLINE void add_lanes(lanes& sum, const lanes& a)
+{
+    #pragma omp simd
+    for (int l = 0; l < PPR_LANES; l++)
+        sum.x[l] += a.x[l];
+}
+
+static PPR_INLINE void add_scaled_lanes(lanes& sum, const lanes& a, double scale)
+{
+    #pragma omp simd
+    for (int l = 0; l < PPR_LANES; l++)
+        sum.x[l] += a.x[l] * scale;
+}
+
+static PPR_INLINE bool any_lane_above(const lanes& a, double limit)
+{
+    bool above = false;
+    #pragma omp simd reduction(|:above)
+    for (int l = 0; l < PPR_LANES; l++)
+        above |= a.x[l] > limit;
+    return above;
+}
+
+// The sets of one pass: sets first .. first + count - 1 of the batch,
+// with their seeds deduplicated
+struct pass_seeds
+{
+    int first;
+    int count;
+    std::vector<Vertex> seeds[PPR_LANES];
+};
+
+// Lists the distinct seeds of each set of the pass
+static void collect_seeds(const Vertex* seeds, const int* seed_starts, int first, int count, pass_seeds* pass)
+{
+    pass->first = first;
+    pass->count = count;
+    for (int i = 0; i < count; i++) {
+        std::vector<Vertex>& set = pass->seeds[i];
+        set.assign(seeds + seed_starts[first + i], seeds + seed_starts[first + i + 1]);
+        std::sort(set.begin(), set.end());
+        set.erase(std::unique(set.begin(), set.end()), set.end());
+    }
+}
+
+// Sets bit i of mask[s] for each seed s of set i of the pass
+static void mark_seeds(const pass_seeds* pass, uint32_t* mask)
+{
+    for (int i = 0; i < pass->count; i++)
+        for (Vertex s : pass->seeds[i])
+            mask[s] |= 1u << i;
+}
+
+static void clear_seeds(const pass_seeds* pass, uint32_t* mask)
+{
+    for (int i = 0; i < pass->count; i++)
+        for (Vertex s : pass->seeds[i])
+            mask[s] = 0;
+}
+
+// Higher score first, then lower vertex id
+static inline bool ranks_before(const std::pair<double, Vertex>& a, const std::pair<double, Vertex>& b)
+{
+    return a.first > b.first || (a.first == b.first && a.second < b.second);
+}
+
+// Writes the top_k positive scores among count candidates, where
+// candidate(j) gives the j-th (score, vertex) pair
+template <typename F>
+static void select_top_k(long count, F candidate, int top_k, Vertex* top_vertices, double* top_scores)
+{
+    // a heap with the worst of the best top_k seen on top
+    std::vector<std::pair<double, Vertex>> best;
+    best.reserve(top_k + 1);
+    for (long j = 0; j < count && top_k > 0; j++) {
+        std::pair<double, Vertex> c = candidate(j);
+        if (c.first <= 0)
+            continue;
+        if ((int) best.size() < top_k) {
+            best.push_back(c);
+            std::push_heap(best.begin(), best.end(), ranks_before);
+        } else if (ranks_before(c, best.front())) {
+            std::pop_heap(best.begin(), best.end(), ranks_before);
+            best.back() = c;
+            std::push_heap(best.begin(), best.end(), ranks_before);
+        }
+    }
+
+    std::sort(best.begin(), best.end(), ranks_before);
+    for (int r = 0; r < top_k; r++) {
+        top_vertices[r] = r < (int) best.size() ? best[r].second : -1;
+        top_scores[r] = r < (int) best.size() ? best[r].first : 0.0;
+    }
+}
+
+/* Power iteration */
+
+struct power_state
+{
+    const lanes* score;
+    lanes* next_score;
+    const double* inverse_degree;
+    const uint32_t* mask;
+    // per lane: share of each seed of the set this iteration
+    lanes restart;
+    double damping;
+};
+
+// One iteration for vertices [first, last): each vertex takes damping
+// times its incoming neighbors' scores over their outgoing degrees,
+// plus its restart share if it is a seed.  Scaling by the degree per
+// edge costs a multiply but saves streaming a second array of lanes.
+// Adds the score changes to diff and the scores of vertices without
+// outgoing edges to dangling.
+template <typename G>
+static PPR_INLINE void power_range_body(G* g, Vertex first, Vertex last, const power_state* st,
+                                        lanes* diff, lanes* dangling)
+{
+    lanes range_diff = *diff, range_dangling = *dangling;
+    for (Vertex v = first; v < last; v++) {
+        lane_vector sum = {};
+        for (Vertex u : incoming_neighbors(g, v))
+            add_scaled_lanes(sum, st->score[u], st->inverse_degree[u]);
+
+        lanes s;
+        #pragma omp simd
+        for (int l = 0; l < PPR_LANES; l++)
+            s.x[l] = st->damping * sum[l];
+        if (uint32_t bits = st->mask[v]) {
+            for (int l = 0; l < PPR_LANES; l++)
+                if (bits & (1u << l))
+                    s.x[l] += st->restart.x[l];
+        }
+
+        #pragma omp simd
+        for (int l = 0; l < PPR_LANES; l++) {
+            range_diff.x[l] += fabs(s.x[l] - st->score[v].x[l]);
+            st->next_score[v].x[l] = s.x[l];
+        }
+        if (st->inverse_degree[v] == 0.0)
+            add_lanes(range_dangling, s);
+    }
+    *diff = range_diff;
+    *dangling = range_dangling;
+}
+
+template <typename G>
+__attribute__((target("avx512f")))
+static void power_range_avx512(G* g, Vertex first, Vertex last, const power_state* st, lanes* diff, lanes* dangling)
+{
+    power_range_body(g, first, last, st, diff, dangling);
+}
+
+template <typename G>
+__attribute__((target("avx2")))
+static void power_range_avx2(G* g, Vertex first, Vertex last, const power_state* st, lanes* diff, lanes* dangling)
+{
+    power_range_body(g, first, last, st, diff, dangling);
+}
+
+template <typename G>
+static void power_range_scalar(G* g, Vertex first, Vertex last, const power_state* st, lanes* diff, lanes* dangling)
+{
+    power_range_body(g, first, last, st, diff, dangling);
+}
+
+enum ppr_isa { PPR_SCALAR, PPR_AVX2, PPR_AVX512 };
+
+static ppr_isa detect_isa()
+{
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f"))
+        return PPR_AVX512;
+    if (__builtin_cpu_supports("avx2"))
+        return PPR_AVX2;
+    return PPR_SCALAR;
+}
+
+// Runs power iteration for the sets of one pass, parallel over
+// vertices.  mask holds the pass's seeds (see mark_seeds).
+template <typename G>
+static void power_pass(G* g, const pass_seeds* pass, const ppr_params* params, const double* inverse_degree,
+                       const uint32_t* mask, ppr_isa isa, ppr_result* result)
+{
+    long n = g->num_nodes;
+    double damping = params->damping;
+    lanes* score = (lanes*) malloc(sizeof(lanes) * n);
+    lanes* next_score = (lanes*) malloc(sizeof(lanes) * n);
+
+    #pragma omp parallel for schedule(static)
+    for (long v = 0; v < n; v++) {
+        score[v] = lanes();
+    }
+
+    // start from the restart distribution
+    lanes dangling = {};
+    for (int i = 0; i < pass->count; i++) {
+        double share = 1.0 / pass->seeds[i].size();
+        for (Vertex s : pass->seeds[i]) {
+            score[s].x[i] = share;
+            if (inverse_degree[s] == 0.0)
+                dangling.x[i] += share;
+        }
+    }
+
+    const edge_partition* partition = incoming_partition(g, omp_get_max_threads());
+    power_state st;
+    st.inverse_degree = inverse_degree;
+    st.mask = mask;
+    st.damping = damping;
+    lanes diff;
+    bool converged = false;
+
+    while (!converged) {
+        // walks restart at the seeds, and so do walks that reached a
+        // vertex without outgoing edges
+        st.restart = lanes();
+        for (int i = 0; i < pass->count; i++)
+            st.restart.x[i] = (1.0 - damping + damping * dangling.x[i]) / pass->seeds[i].size();
+        st.score = score;
+        st.next_score = next_score;
+
+        diff = lanes();
+        dangling = lanes();
+        #pragma omp parallel
+        {
+            lanes thread_diff = {}, thread_dangling = {};
+
+            #pragma omp for nowait schedule(dynamic, 1)
+            for (int p = 0; p < partition->num_parts; p++) {
+                Vertex first = partition->starts[p], last = partition->starts[p + 1];
+                if (isa == PPR_AVX512)
+                    power_range_avx512(g, first, last, &st, &thread_diff, &thread_dangling);
+                else if (isa == PPR_AVX2)
+                    power_range_avx2(g, first, last, &st, &thread_diff, &thread_dangling);
+                else
+                    power_range_scalar(g, first, last, &st, &thread_diff, &thread_dangling);
+            }
+
+            #pragma omp critical
+            {
+                add_lanes(diff, thread_diff);
+                add_lanes(dangling, thread_dangling);
+            }
+        }
+
+        std::swap(score, next_score);
+
+        converged = true;
+        for (int i = 0; i < pass->count; i++)
+            converged = converged && diff.x[i] < params->convergence;
+    }
+
+    // the iteration is a contraction by damping in L1
+    for (int i = 0; i < pass->count; i++)
+        result->error_bound[pass->first + i] = diff.x[i] * damping / (1.0 - damping);
+
+    int top_k = params->top_k;
+    #pragma omp parallel for schedule(dynamic, 1)
+    for (int i = 0; i < pass->count; i++) {
+        long set = pass->first + i;
+        select_top_k(n, [&](long v) { return std::make_pair(score[v].x[i], (Vertex) v); }, top_k,
+                     result->top_vertices + set * top_k, result->top_scores + set * top_k);
+        if (result->scores)
+            for (long v = 0; v < n; v++)
+                result->scores[set * n + v] = score[v].x[i];
+    }
+
+    free(score);
+    free(next_score);
+}
+
+/* Forward push */
+
+// A touched vertex and its position in the workspace's per-vertex
+// vectors; vertex is -1 in empty slots
+struct index_slot
+{
+    Vertex vertex;
+    int index;
+};
+
+// A pass that touches more than 1 / PPR_DENSE_FRACTION of the vertices
+// switches from the slot table to a position per vertex, which is
+// faster to look up.  Its 4 bytes per vertex are then less than the
+// state of the touched vertices, about 150 bytes each.
+#define PPR_DENSE_FRACTION 32
+
+// One thread's forward push state.  A pass only reaches the vertices
+// near its seeds, so state is kept per touched vertex, at its position
+// in touched, and an open-addressing table maps vertices to positions.
+// Memory follows the largest pass rather than the graph; the vectors
+// are cleared after a pass but keep their capacity from call to call.
+struct push_workspace
+{
+    long num_nodes;
+    // power of two slots, at most half full, found by linear probing
+    std::vector<index_slot> slots;
+    int slot_bits;
+    // position per vertex, or -1, instead of slots once a pass touched
+    // num_nodes / PPR_DENSE_FRACTION vertices, kept for later passes
+    std::vector<int> position;
+    // vertices with a nonzero estimate or residual, and their state
+    std::vector<Vertex> touched;
+    std::vector<lanes> estimate;
+    std::vector<lanes> residual;
+    std::vector<unsigned char> queued;
+    // positions waiting to push, this round's and the next round's
+    std::vector<int> queue;
+    std::vector<int> next_queue;
+};
+
+// Workspaces by thread number, made the first time a thread gets a pass
+static std::vector<push_workspace*> push_workspaces;
+
+// First slot to probe for v in a table of 2^bits slots (Fibonacci hashing)
+static PPR_INLINE size_t slot_of(Vertex v, int bits)
+{
+    return (size_t) (((uint64_t) (uint32_t) v * 0x9E3779B97F4A7C15ull) >> (64 - bits));
+}
+
+// Doubles the slot table, at least 1024 slots, and reinserts touched
+static void grow_slots(push_workspace* w)
+{
+    w->slot_bits = w->slots.empty() ? 10 : w->slot_bits + 1;
+    w->slots.assign((size_t) 1 << w->slot_bits, index_slot{ -1, 0 });
+    size_t mask = w->slots.size() - 1;
+    for (size_t j = 0; j < w->touched.size(); j++) {
+        size_t k = slot_of(w->touched[j], w->slot_bits);
+        while (w->slots[k].vertex >= 0)
+            k = (k + 1) & mask;
+        w->slots[k] = index_slot{ w->touched[j], (int) j };
+    }
+}
+
+// Moves the positions of touched from the slot table to position
+static void use_positions(push_workspace* w)
+{
+    w->position.assign(w->num_nodes, -1);
+    for (size_t j = 0; j < w->touched.size(); j++)
+        w->position[w->touched[j]] = (int) j;
+    std::fill(w->slots.begin(), w->slots.end(), index_slot{ -1, 0 });
+}
+
+// Adds v with zero state and returns its position
+static PPR_INLINE int add_touched(push_workspace* w, Vertex v)
+{
+    w->touched.push_back(v);
+    w->estimate.push_back(lanes());
+    w->residual.push_back(lanes());
+    w->queued.push_back(0);
+    return (int) w->touched.size() - 1;
+}
+
+// Position of v in the workspace, adding it with zero state if new
+static PPR_INLINE int touch(push_workspace* w, Vertex v)
+{
+    if (w->position.empty() && 2 * (w->touched.size() + 1) > w->slots.size()) {
+        if ((long) w->touched.size() * PPR_DENSE_FRACTION >= w->num_nodes)
+            use_positions(w);
+        else
+            grow_slots(w);
+    }
+    if (!w->position.empty()) {
+        int& p = w->position[v];
+        if (p < 0)
+            p = add_touched(w, v);
+        return p;
+    }
+
+    size_t mask = w->slots.size() - 1;
+    for (size_t k = slot_of(v, w->slot_bits);; k = (k + 1) & mask) {
+        index_slot& slot = w->slots[k];
+        if (slot.vertex == v)
+            return slot.index;
+        if (slot.vertex < 0) {
+            slot = index_slot{ v, add_touched(w, v) };
+            return slot.index;
+        }
+    }
+}
+
+// Empties the workspace for the next pass
+static void clear_push_workspace(push_workspace* w)
+{
+    if (!w->position.empty()) {
+        for (Vertex v : w->touched)
+            w->position[v] = -1;
+    } else {
+        std::fill(w->slots.begin(), w->slots.end(), index_slot{ -1, 0 });
+    }
+    w->touched.clear();
+    w->estimate.clear();
+    w->residual.clear();
+    w->queued.clear();
+    w->queue.clear();
+    w->next_queue.clear();
+}
+
+// The calling thread's workspace, for a graph of num_nodes vertices
+static push_workspace* thread_push_workspace(long num_nodes)
+{
+    push_workspace*& w = push_workspaces[omp_get_thread_num()];
+    if (!w)
+        w = new push_workspace();
+    if (w->num_nodes != num_nodes) {
+        w->num_nodes = num_nodes;
+        std::vector<int>().swap(w->position);
+    }
+    return w;
+}
+
+void free_ppr_workspaces()
+{
+    for (push_workspace*& w : push_workspaces) {
+        delete w;
+        w = NULL;
+    }
+}
+
+// Runs forward push for the sets of one pass on the calling thread.
+// A vertex pushes all its lanes at once, once any lane's residual is
+// above epsilon per outgoing edge: it keeps (1 - damping) of the
+// residual and sends the rest along its edges, or to the set's seeds if
+// it has none.  Sum of estimates plus sum of residuals stays 1 per set,
+// and the residual left is the error bound.
+template <typename G>
+static PPR_INLINE void push_pass_body(G* g, const pass_seeds* pass, const ppr_params* params,
+                                      push_workspace* w, ppr_result* result)
+{
+    long n = g->num_nodes;
+    double damping = params->damping;
+    double epsilon = params->epsilon;
+
+    // j is v's position in the workspace
+    auto enqueue_if_active = [&](int j, Vertex v) {
+        if (!w->queued[j] &&
+            any_lane_above(w->residual[j], epsilon * std::max<long>(outgoing_size(g, v), 1))) {
+            w->queued[j] = 1;
+            w->next_queue.push_back(j);
+        }
+    };
+
+    for (int i = 0; i < pass->count; i++) {
+        double share = 1.0 / pass->seeds[i].size();
+        for (Vertex s : pass->seeds[i])
+            w->residual[touch(w, s)].x[i] = share;
+    }
+    for (int i = 0; i < pass->count; i++)
+        for (Vertex s : pass->seeds[i])
+            enqueue_if_active(touch(w, s), s);
+
+    // rounds: vertices activated while a round runs push in the next
+    for (size_t head = 0; !w->next_queue.empty() || head < w->queue.size(); head++) {
+        if (head == w->queue.size()) {
+            w->queue.swap(w->next_queue);
+            w->next_queue.clear();
+            head = 0;
+        }
+        int j = w->queue[head];
+        Vertex u = w->touched[j];
+        w->queued[j] = 0;
+
+        long degree = outgoing_size(g, u);
+        lanes r = w->residual[j];
+        w->residual[j] = lanes();
+        add_scaled_lanes(w->estimate[j], r, 1.0 - damping);
+
+        if (degree > 0) {
+            lanes share;
+            #pragma omp simd
+            for (int l = 0; l < PPR_LANES; l++)
+                share.x[l] = r.x[l] * damping / degree;
+            for (Vertex v : outgoing_neighbors(g, u)) {
+                int k = touch(w, v);
+                add_lanes(w->residual[k], share);
+                enqueue_if_active(k, v);
+            }
+        } else {
+            for (int i = 0; i < pass->count; i++) {
+                double share = r.x[i] * damping / pass->seeds[i].size();
+                for (Vertex s : pass->seeds[i])
+                    w->residual[touch(w, s)].x[i] += share;
+            }
+            for (int i = 0; i < pass->count; i++)
+                for (Vertex s : pass->seeds[i])
+                    enqueue_if_active(touch(w, s), s);
+        }
+    }
+
+    int top_k = params->top_k;
+    for (int i = 0; i < pass->count; i++) {
+        long set = pass->first + i;
+        double left = 0;
+        for (const lanes& r : w->residual)
+            left += r.x[i];
+        result->error_bound[set] = left;
+
+        select_top_k(w->touched.size(),
+                     [&](long j) { return std::make_pair(w->estimate[j].x[i], w->touched[j]); },
+                     top_k, result->top_vertices + set * top_k, result->top_scores + set * top_k);
+
+        if (result->scores) {
+            double* row = result->scores + set * n;
+            memset(row, 0, sizeof(double) * n);
+            for (size_t j = 0; j < w->touched.size(); j++)
+                row[w->touched[j]] = w->estimate[j].x[i];
+        }
+    }
+
+    clear_push_workspace(w);
+}
+
+template <typename G>
+__attribute__((target("avx512f")))
+static void push_pass_avx512(G* g, const pass_seeds* pass, const ppr_params* params, push_workspace* w, ppr_result* result)
+{
+    push_pass_body(g, pass, params, w, result);
+}
+
+template <typename G>
+__attribute__((target("avx2")))
+static void push_pass_avx2(G* g, const pass_seeds* pass, const ppr_params* params, push_workspace* w, ppr_result* result)
+{
+    push_pass_body(g, pass, params, w, result);
+}
+
+template <typename G>
+static void push_pass_scalar(G* g, const pass_seeds* pass, const ppr_params* params, push_workspace* w, ppr_result* result)
+{
+    push_pass_body(g, pass, params, w, result);
+}
+
+template <typename G>
+static void personalized_page_rank_impl(G* g, const Vertex* seeds, const int* seed_starts, int num_sets,
+                                        const ppr_params* params, ppr_result* result)
+{
+    long n = g->num_nodes;
+    int num_passes = (num_sets + PPR_LANES - 1) / PPR_LANES;
+    ppr_isa isa = detect_isa();
+    if (num_passes == 0)
+        return;
+
+    if (params->mode == PPR_PUSH) {
+        // whole passes per thread: pushes stay near the seeds, too
+        // little work to split one pass.  No more threads than passes.
+        int num_threads = std::min(omp_get_max_threads(), num_passes);
+        if ((int) push_workspaces.size() < num_threads)
+            push_workspaces.resize(num_threads, NULL);
+
+        #pragma omp parallel for schedule(dynamic, 1) num_threads(num_threads)
+        for (int p = 0; p < num_passes; p++) {
+            push_workspace* w = thread_push_workspace(n);
+            pass_seeds pass;
+            int first = p * PPR_LANES;
+            collect_seeds(seeds, seed_starts, first, std::min(PPR_LANES, num_sets - first), &pass);
+            if (isa == PPR_AVX512)
+                push_pass_avx512(g, &pass, params, w, result);
+            else if (isa == PPR_AVX2)
+                push_pass_avx2(g, &pass, params, w, result);
+            else
+                push_pass_scalar(g, &pass, params, w, result);
+        }
+        return;
+    }
+
+    double* inverse_degree = (double*) malloc(sizeof(double) * n);
+    uint32_t* mask = (uint32_t*) calloc(n, sizeof(uint32_t));
+    #pragma omp parallel for schedule(static)
+    for (long v = 0; v < n; v++) {
+        long degree = outgoing_size(g, (Vertex) v);
+        inverse_degree[v] = degree ? 1.0 / degree : 0.0;
+    }
+
+    pass_seeds pass;
+    for (int p = 0; p < num_passes; p++) {
+        int first = p * PPR_LANES;
+        collect_seeds(seeds, seed_starts, first, std::min(PPR_LANES, num_sets - first), &pass);
+        mark_seeds(&pass, mask);
+        power_pass(g, &pass, params, inverse_degree, mask, isa, result);
+        clear_seeds(&pass, mask);
+    }
+
+    free(inverse_degree);
+    free(mask);
+}
+
+void personalized_page_rank(Graph g, const Vertex* seeds, const int* seed_starts, int num_sets,
+                            const ppr_params* params, ppr_result* result)
+{
+    personalized_page_rank_impl(g, seeds, seed_starts, num_sets, params, result);
+}
+
+void personalized_page_rank(Graph64 g, const Vertex* seeds, const int* seed_starts, int num_sets,
+                            const ppr_params* params, ppr_result* result)
+{
+    personalized_page_rank_impl(g, seeds, seed_starts, num_sets, params, result);
+}
+
+void personalized_page_rank(CompressedGraph g, const Vertex* seeds, const int* seed_starts, int num_sets,
+                            const ppr_params* params, ppr_result* result)
+{
+    personalized_page_rank_impl(g, seeds, seed_starts, num_sets, params, result);
+}
+
+void personalized_page_rank(CompressedGraph64 g, const Vertex* seeds, const int* seed_starts, int num_sets,
+                            const ppr_params* params, ppr_result* result)
+{
+    personalized_page_rank_impl(g, seeds, seed_starts, num_sets, params, result);
+}
+
+void write_ppr_top_k(FILE* out, const ppr_result* result, int num_sets, int top_k,
+                     const Vertex* new_ids, Vertex num_nodes)
+{
+    // original id of each relabeled vertex
+    std::vector<Vertex> original;
+    if (new_ids) {
+        original.resize(num_nodes);
+        for (Vertex v = 0; v < num_nodes; v++)
+            original[new_ids[v]] = v;
+    }
+
+    fprintf(out, "set\trank\tvertex\tscore\n");
+    for (long i = 0; i < num_sets; i++) {
+        for (int r = 0; r < top_k; r++) {
+            Vertex v = result->top_vertices[i * top_k + r];
+            if (v < 0)
+                break;
+            fprintf(out, "%ld\t%d\t%d\t%.9g\n", i, r + 1, new_ids ? original[v] : v,
+                    result->top_scores[i * top_k + r]);
+        }
+    }
+}
@@ -0,0 +1,86 @@
+#ifndef __PPR_H__
+#define __PPR_H__
+
+#include <stdio.h>
+
+#include "common/graph.h"
+#include "common/compressed_graph.h"
+
+// Batched personalized PageRank.  Set i of the num_sets seed sets is
+// seeds[seed_starts[i]] .. seeds[seed_starts[i + 1] - 1]; its scores are
+// the stationary distribution of a walk that follows an outgoing edge
+// with probability damping and otherwise restarts at a seed of the set,
+// chosen uniformly.  Walks at a vertex without outgoing edges restart
+// too.
+//
+// Sets are computed PPR_LANES at a time, with scores stored vertex-major
+// (a vertex's lanes are adjacent), so every edge scanned moves the
+// scores of all the sets of a pass with one vector add.  PPR_LANES is a
+// power of two; 8 doubles fill a zmm register.
+#ifndef PPR_LANES
+#define PPR_LANES 8
+#endif
+
+enum ppr_mode
+{
+    // power iteration over the whole graph until every set's scores
+    // change by less than convergence in L1
+    PPR_POWER,
+    // forward push (Andersen, Chung and Lang): only vertices holding
+    // more than epsilon * outgoing_size unpropagated score (at least
+    // epsilon) are processed, so the work stays near the seeds.  Each
+    // thread runs whole passes.
+    PPR_PUSH,
+};
+
+struct ppr_params
+{
+    ppr_mode mode;
+    double damping;
+    // PPR_POWER: L1 change of an iteration below which a set is done
+    double convergence;
+    // PPR_PUSH: residual per outgoing edge below which a vertex is done
+    double epsilon;
+    // length of the top-k lists
+    int top_k;
+};
+
+struct ppr_result
+{
+    // num_sets * top_k: set i's highest scoring vertices, best first, at
+    // top_vertices + i * top_k, and their scores.  Lists of sets that
+    // reach fewer than top_k vertices end with vertex -1 and score 0.
+    Vertex* top_vertices;
+    double* top_scores;
+    // per set: bound on the L1 distance of the computed scores from the
+    // exact ones
+    double* error_bound;
+    // num_sets arrays of num_nodes scores, set i's at scores + i *
+    // num_nodes, or NULL to keep only the top-k lists
+    double* scores;
+};
+
+// Vertices in seeds must be valid and every set non-empty.  All arrays
+// of result are allocated by the caller.  PPR_PUSH keeps a workspace
+// for each thread that ran a pass, of about 150 bytes per vertex the
+// largest pass reached, plus 4 bytes per vertex of the graph if that
+// was more than 1/32 of them.  Later calls reuse the workspaces;
+// free_ppr_workspaces releases them.
+void personalized_page_rank(Graph g, const Vertex* seeds, const int* seed_starts, int num_sets,
+                            const ppr_params* params, ppr_result* result);
+void personalized_page_rank(Graph64 g, const Vertex* seeds, const int* seed_starts, int num_sets,
+                            const ppr_params* params, ppr_result* result);
+void personalized_page_rank(CompressedGraph g, const Vertex* seeds, const int* seed_starts, int num_sets,
+                            const ppr_params* params, ppr_result* result);
+void personalized_page_rank(CompressedGraph64 g, const Vertex* seeds, const int* seed_starts, int num_sets,
+                            const ppr_params* params, ppr_result* result);
+
+void free_ppr_workspaces();
+
+// Writes the top-k lists as tab-separated "set rank vertex score" lines,
+// skipping empty slots.  If new_ids is set the graph was relabeled, and
+// vertices are written with their original ids.
+void write_ppr_top_k(FILE* out, const ppr_result* result, int num_sets, int top_k,
+                     const Vertex* new_ids, Vertex num_nodes);
+
+#endif /* __PPR_H__ */
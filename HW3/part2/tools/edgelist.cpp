@@ -0,0 +1,542 @@
+#include <algorithm>
+#include <cerrno>
+#include <charconv>
+#include <climits>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <queue>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <omp.h>
+#include <parallel/algorithm>
+
+#include "../common/CycleTimer.h"
+#include "../common/graph.h"
+#include "../common/graph_binary.h"
+#include "edgelist.h"
+
+// Edges are packed as (first << 32) | second, so sorting the packed
+// keys sorts by first vertex, then by second.  Ids are non-negative.
+static inline uint64_t pack_edge(Vertex first, Vertex second)
+{
+    return ((uint64_t) first << 32) | (uint32_t) second;
+}
+
+static inline Vertex edge_first(uint64_t key) { return (Vertex)(key >> 32); }
+static inline Vertex edge_second(uint64_t key) { return (Vertex)(uint32_t) key; }
+static inline uint64_t reverse_edge(uint64_t key) { return (key << 32) | (key >> 32); }
+
+// Smallest read buffer a run gets during a merge; bounds the fan-in
+#define MIN_MERGE_BUFFER ((size_t) 1 << 20)
+// Parse windows are split into this many chunks per thread
+#define CHUNKS_PER_THREAD 16
+// Parse windows never shrink below this many bytes
+#define MIN_WINDOW ((size_t) 1 << 16)
+
+static void write_all(int fd, const void* data, size_t bytes, uint64_t offset)
+{
+    const char* p = (const char*) data;
+    while (bytes > 0) {
+        ssize_t n = pwrite(fd, p, bytes, offset);
+        if (n <= 0) {
+            fprintf(stderr, "Error writing %zu bytes: %s\n", bytes, strerror(errno));
+            exit(1);
+        }
+        p += n;
+        bytes -= n;
+        offset += n;
+    }
+}
+
+static void read_all(int fd, void* data, size_t bytes, uint64_t offset)
+{
+    char* p = (char*) data;
+    while (bytes > 0) {
+        ssize_t n = pread(fd, p, bytes, offset);
+        if (n <= 0) {
+            fprintf(stderr, "Error reading %zu bytes of a sorted run: %s\n", bytes, strerror(errno));
+            exit(1);
+        }
+        p += n;
+        bytes -= n;
+        offset += n;
+    }
+}
+
+// Creates an anonymous temporary file in dir; it disappears when closed
+static int make_temp_file(const char* dir)
+{
+    std::string path = std::string(dir) + "/edgelist-run-XXXXXX";
+    int fd = mkstemp(&path[0]);
+    if (fd < 0) {
+        fprintf(stderr, "Could not create a temporary file in %s\n", dir);
+        exit(1);
+    }
+    unlink(path.c_str());
+    return fd;
+}
+
+// A sorted run of packed edges on disk
+struct run_file
+{
+    int fd;
+    uint64_t count;
+};
+
+// Buffered sequential writer at a fixed position in a file
+struct file_writer
+{
+    int fd;
+    uint64_t offset;
+    std::vector<char> buffer;
+    size_t used;
+
+    file_writer(int fd, uint64_t offset, size_t bytes)
+        : fd(fd), offset(offset), buffer(std::max<size_t>(bytes, 4096)), used(0) {}
+
+    template <typename T>
+    void put(T value)
+    {
+        if (used + sizeof(T) > buffer.size())
+            flush();
+        memcpy(&buffer[used], &value, sizeof(T));
+        used += sizeof(T);
+    }
+
+    void flush()
+    {
+        write_all(fd, buffer.data(), used, offset);
+        offset += used;
+        used = 0;
+    }
+};
+
+// Buffered reader over one run
+struct run_reader
+{
+    run_file run;
+    uint64_t loaded;
+    std::vector<uint64_t> buffer;
+    size_t pos;
+    size_t filled;
+
+    bool refill()
+    {
+        size_t n = (size_t) std::min<uint64_t>(buffer.size(), run.count - loaded);
+        if (n > 0)
+            read_all(run.fd, buffer.data(), n * sizeof(uint64_t), loaded * sizeof(uint64_t));
+        loaded += n;
+        pos = 0;
+        filled = n;
+        return n > 0;
+    }
+
+    uint64_t head() const { return buffer[pos]; }
+
+    bool advance()
+    {
+        if (++pos < filled)
+            return true;
+        return refill();
+    }
+};
+
+// k-way merge of sorted runs, feeding every key (or every distinct key,
+// when deduplicating) to sink in order.
+template <typename Sink>
+static void merge_runs(const std::vector<run_file>& runs, size_t buffer_keys, bool deduplicate, Sink sink)
+{
+    typedef std::pair<uint64_t, size_t> head;
+    std::vector<run_reader> readers(runs.size());
+    std::priority_queue<head, std::vector<head>, std::greater<head>> heap;
+
+    for (size_t r = 0; r < runs.size(); r++) {
+        readers[r].run = runs[r];
+        readers[r].loaded = 0;
+        readers[r].buffer.resize(std::max<size_t>(buffer_keys, 1));
+        if (readers[r].refill())
+            heap.push(head(readers[r].head(), r));
+    }
+
+    bool have_last = false;
+    uint64_t last = 0;
+    while (!heap.empty()) {
+        head top = heap.top();
+        heap.pop();
+
+        if (!deduplicate || !have_last || top.first != last) {
+            sink(top.first);
+            last = top.first;
+            have_last = true;
+        }
+
+        run_reader& reader = readers[top.second];
+        if (reader.advance())
+            heap.push(head(reader.head(), top.second));
+    }
+}
+
+// Merges groups of runs until at most fan_in are left, so the final
+// merge can give each run a reasonably sized buffer.
+static std::vector<run_file> reduce_runs(std::vector<run_file> runs, size_t fan_in, size_t budget,
+                                         bool deduplicate, const char* temp_dir, int* passes)
+{
+    while (runs.size() > fan_in) {
+        size_t buffer_keys = budget / sizeof(uint64_t) / (fan_in + 1);
+        std::vector<run_file> merged;
+
+        for (size_t i = 0; i < runs.size(); i += fan_in) {
+            std::vector<run_file> group(runs.begin() + i, runs.begin() + std::min(runs.size(), i + fan_in));
+            if (group.size() == 1) {
+                merged.push_back(group[0]);
+                continue;
+            }
+
+            run_file out = { make_temp_file(temp_dir), 0 };
+            file_writer writer(out.fd, 0, buffer_keys * sizeof(uint64_t));
+            merge_runs(group, buffer_keys, deduplicate, [&](uint64_t key) {
+                writer.put(key);
+                out.count++;
+            });
+            writer.flush();
+
+            for (const run_file& r : group)
+                close(r.fd);
+            merged.push_back(out);
+        }
+
+        runs.swap(merged);
+        (*passes)++;
+    }
+    return runs;
+}
+
+// Writes one CSR direction from runs sorted by (vertex, neighbor): the
+// num_nodes + 1 starts at starts_offset and the neighbor ids at
+// edges_offset.  Returns the number of edges written.
+template <typename O>
+static uint64_t write_direction(const std::vector<run_file>& runs, size_t budget, bool deduplicate,
+                                int fd, Vertex num_nodes, uint64_t starts_offset, uint64_t edges_offset)
+{
+    // one share of the budget per run, plus one for each writer
+    size_t share = budget / (runs.size() + 2);
+    file_writer starts(fd, starts_offset, share);
+    file_writer edges(fd, edges_offset, share);
+
+    uint64_t written = 0;
+    int64_t next_vertex = 0;
+    merge_runs(runs, share / sizeof(uint64_t), deduplicate, [&](uint64_t key) {
+        Vertex v = edge_first(key);
+        for (; next_vertex <= v; next_vertex++)
+            starts.put((O) written);
+        edges.put(edge_second(key));
+        written++;
+    });
+    for (; next_vertex <= num_nodes; next_vertex++)
+        starts.put((O) written);
+
+    starts.flush();
+    edges.flush();
+    return written;
+}
+
+static inline const char* next_line(const char* p, const char* end)
+{
+    const char* newline = (const char*) memchr(p, '\n', end - p);
+    return newline ? newline + 1 : end;
+}
+
+static inline bool is_blank(char c)
+{
+    return c == ' ' || c == '\t' || c == '\r' || c == ',';
+}
+
+static const char* parse_vertex(const char* p, const char* end, const char* base, Vertex* out)
+{
+    while (p < end && is_blank(*p))
+        p++;
+
+    long long value = -1;
+    std::from_chars_result result = std::from_chars(p, end, value);
+    if (result.ec != std::errc() || value < 0 || value >= INT_MAX) {
+        fprintf(stderr, "Malformed edge or vertex id out of range at byte %ld.\n", (long)(p - base));
+        exit(1);
+    }
+    *out = (Vertex) value;
+    return result.ptr;
+}
+
+// Parses the edge lines of [p, end), which starts on a line boundary.
+// With out == NULL the edges are only counted.  Returns the number of
+// packed edges produced and raises *max_id to the largest id seen.
+static int64_t parse_edges(const char* p, const char* end, const char* base,
+                           bool symmetrize, uint64_t* out, Vertex* max_id)
+{
+    int64_t count = 0;
+    while (p < end) {
+        while (p < end && is_blank(*p))
+            p++;
+        if (p == end)
+            break;
+        if (*p == '\n') {
+            p++;
+            continue;
+        }
+        if (*p == '#' || *p == '%') {
+            p = next_line(p, end);
+            continue;
+        }
+
+        if (out) {
+            Vertex src, dst;
+            p = parse_vertex(p, end, base, &src);
+            p = parse_vertex(p, end, base, &dst);
+            out[count] = pack_edge(src, dst);
+            if (symmetrize)
+                out[count + 1] = pack_edge(dst, src);
+            *max_id = std::max(*max_id, std::max(src, dst));
+        }
+        count += symmetrize ? 2 : 1;
+        p = next_line(p, end);
+    }
+    return count;
+}
+
+// Sorts the packed edges in buffer and writes them out as one run for
+// each direction (a single one when the graph is symmetric).
+static void flush_runs(uint64_t* buffer, size_t count, const edgelist_options* options,
+                       std::vector<run_file>* out_runs, std::vector<run_file>* in_runs)
+{
+    if (count == 0)
+        return;
+
+    __gnu_parallel::sort(buffer, buffer + count);
+    if (options->deduplicate)
+        count = std::unique(buffer, buffer + count) - buffer;
+
+    run_file run = { make_temp_file(options->temp_dir), count };
+    write_all(run.fd, buffer, count * sizeof(uint64_t), 0);
+    out_runs->push_back(run);
+
+    if (options->symmetrize)
+        return;
+
+    #pragma omp parallel for schedule(static)
+    for (size_t i = 0; i < count; i++)
+        buffer[i] = reverse_edge(buffer[i]);
+    __gnu_parallel::sort(buffer, buffer + count);
+
+    run_file reversed = { make_temp_file(options->temp_dir), count };
+    write_all(reversed.fd, buffer, count * sizeof(uint64_t), 0);
+    in_runs->push_back(reversed);
+}
+
+void import_edgelist(const char* input_filename, const char* output_filename,
+                     const edgelist_options* options)
+{
+    int in_fd = open(input_filename, O_RDONLY);
+    if (in_fd < 0) {
+        fprintf(stderr, "Could not open: %s\n", input_filename);
+        exit(1);
+    }
+
+    struct stat st;
+    if (fstat(in_fd, &st) != 0) {
+        fprintf(stderr, "Could not stat: %s\n", input_filename);
+        exit(1);
+    }
+
+    size_t size = st.st_size;
+    const char* base = (const char*) mmap(NULL, size > 0 ? size : 1, PROT_READ, MAP_PRIVATE, in_fd, 0);
+    if (base == MAP_FAILED) {
+        fprintf(stderr, "Could not mmap: %s\n", input_filename);
+        exit(1);
+    }
+    close(in_fd);
+    madvise((void*) base, size, MADV_SEQUENTIAL);
+
+    // Phase 1: parse windows of the input in parallel into a buffer of
+    // half the budget (the other half is scratch for the parallel sort)
+    // and spill it as sorted runs whenever it fills up.
+    double start = CycleTimer::currentSeconds();
+
+    size_t capacity = std::max<size_t>(options->memory_budget / 2 / sizeof(uint64_t), 2);
+    uint64_t* buffer = (uint64_t*) malloc(capacity * sizeof(uint64_t));
+    size_t used = 0;
+
+    std::vector<run_file> out_runs, in_runs;
+    int num_chunks = omp_get_max_threads() * CHUNKS_PER_THREAD;
+    std::vector<const char*> bounds(num_chunks + 1);
+    std::vector<int64_t> counts(num_chunks + 1);
+    std::vector<Vertex> chunk_max(num_chunks);
+
+    long page = sysconf(_SC_PAGESIZE);
+    const char* end = base + size;
+    const char* pos = base;
+    double bytes_per_edge = 16.0;
+    size_t window = 0;
+    int64_t total_edges = 0;
+    Vertex max_id = -1;
+
+    while (pos < end) {
+        size_t room = capacity - used;
+        if (window == 0)
+            window = std::max<size_t>(MIN_WINDOW, (size_t)(room * bytes_per_edge));
+        const char* limit = pos + std::min<size_t>(window, end - pos);
+
+        // chunk boundaries, moved forward to line starts
+        bounds[0] = pos;
+        for (int c = 1; c <= num_chunks; c++) {
+            const char* b = c == num_chunks ? limit : pos + (limit - pos) * c / num_chunks;
+            if (b >= end)
+                b = end;
+            else if (b > pos)
+                b = next_line(b - 1, end);
+            bounds[c] = std::max(b, bounds[c - 1]);
+        }
+
+        #pragma omp parallel for schedule(dynamic, 1)
+        for (int c = 0; c < num_chunks; c++)
+            counts[c + 1] = parse_edges(bounds[c], bounds[c + 1], base, options->symmetrize, NULL, NULL);
+
+        // take the longest prefix of chunks that fits in the buffer
+        counts[0] = 0;
+        int accepted = 0;
+        while (accepted < num_chunks && counts[accepted] + counts[accepted + 1] <= (int64_t) room) {
+            counts[accepted + 1] += counts[accepted];
+            accepted++;
+        }
+
+        if (accepted == 0) {
+            if (used > 0) {
+                flush_runs(buffer, used, options, &out_runs, &in_runs);
+                used = 0;
+            } else if (window > MIN_WINDOW) {
+                window = std::max<size_t>(MIN_WINDOW, window / 2);
+            } else {
+                fprintf(stderr, "Memory budget too small for the input.\n");
+                exit(1);
+            }
+            continue;
+        }
+
+        #pragma omp parallel for schedule(dynamic, 1)
+        for (int c = 0; c < accepted; c++) {
+            chunk_max[c] = -1;
+            parse_edges(bounds[c], bounds[c + 1], base, options->symmetrize, buffer + used + counts[c], &chunk_max[c]);
+        }
+        for (int c = 0; c < accepted; c++)
+            max_id = std::max(max_id, chunk_max[c]);
+
+        int64_t parsed = counts[accepted];
+        const char* consumed = bounds[accepted];
+        if (parsed > 0)
+            bytes_per_edge = (double)(consumed - pos) / parsed;
+        window = 0;
+        used += parsed;
+        total_edges += parsed;
+
+        // drop the parsed part of the input from the page cache mapping
+        const char* drop_begin = base + (pos - base) / page * page;
+        const char* drop_end = base + (consumed - base) / page * page;
+        if (drop_end > drop_begin)
+            madvise((void*) drop_begin, drop_end - drop_begin, MADV_DONTNEED);
+
+        // a partly accepted window means the buffer is (nearly) full
+        pos = consumed;
+        if (accepted < num_chunks || used == capacity) {
+            flush_runs(buffer, used, options, &out_runs, &in_runs);
+            used = 0;
+        }
+    }
+    flush_runs(buffer, used, options, &out_runs, &in_runs);
+    free(buffer);
+    munmap((void*) base, size > 0 ? size : 1);
+
+    double parse_time = CycleTimer::currentSeconds() - start;
+
+    // Phase 2: merge the runs straight into the v2 file layout.  Offsets
+    // are 64-bit if the edge count before the final deduplication could
+    // overflow an int.
+    start = CycleTimer::currentSeconds();
+
+    size_t fan_in = std::max<size_t>(2, options->memory_budget / MIN_MERGE_BUFFER - 2);
+    int passes = 0;
+    size_t num_runs = out_runs.size();
+    out_runs = reduce_runs(out_runs, fan_in, options->memory_budget, options->deduplicate, options->temp_dir, &passes);
+    if (!options->symmetrize)
+        in_runs = reduce_runs(in_runs, fan_in, options->memory_budget, options->deduplicate, options->temp_dir, &passes);
+    else
+        in_runs = out_runs;
+
+    uint64_t upper_bound = 0;
+    for (const run_file& r : out_runs)
+        upper_bound += r.count;
+    bool wide = upper_bound > (uint64_t) INT_MAX;
+    uint32_t offset_bytes = wide ? sizeof(int64_t) : sizeof(int);
+
+    Vertex num_nodes = max_id + 1;
+    uint64_t alignment = sysconf(_SC_PAGESIZE);
+
+    int fd = open(output_filename, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        fprintf(stderr, "Could not open: %s\n", output_filename);
+        exit(1);
+    }
+
+    // the outgoing arrays' positions do not depend on the edge count
+    graph_file_header header;
+    graph_file_layout(&header, num_nodes, 0, sizeof(Vertex), offset_bytes, alignment);
+    uint64_t num_edges = wide
+        ? write_direction<int64_t>(out_runs, options->memory_budget, options->deduplicate, fd, num_nodes,
+                                   header.outgoing_starts_offset, header.outgoing_edges_offset)
+        : write_direction<int>(out_runs, options->memory_budget, options->deduplicate, fd, num_nodes,
+                               header.outgoing_starts_offset, header.outgoing_edges_offset);
+
+    graph_file_layout(&header, num_nodes, num_edges, sizeof(Vertex), offset_bytes, alignment);
+    uint64_t num_incoming = wide
+        ? write_direction<int64_t>(in_runs, options->memory_budget, options->deduplicate, fd, num_nodes,
+                                   header.incoming_starts_offset, header.incoming_edges_offset)
+        : write_direction<int>(in_runs, options->memory_budget, options->deduplicate, fd, num_nodes,
+                               header.incoming_starts_offset, header.incoming_edges_offset);
+
+    if (num_incoming != num_edges) {
+        fprintf(stderr, "Internal error: %lu outgoing but %lu incoming edges.\n",
+                (unsigned long) num_edges, (unsigned long) num_incoming);
+        exit(1);
+    }
+
+    write_all(fd, &header, sizeof(header), 0);
+    if (ftruncate(fd, header.file_size) != 0) {
+        fprintf(stderr, "Could not resize: %s\n", output_filename);
+        exit(1);
+    }
+    close(fd);
+
+    for (const run_file& r : out_runs)
+        close(r.fd);
+    if (!options->symmetrize)
+        for (const run_file& r : in_runs)
+            close(r.fd);
+
+    double merge_time = CycleTimer::currentSeconds() - start;
+
+    printf("Parsed %ld edges%s from %.1f MB in %.2f s (%zu sorted runs per direction)\n",
+           (long) total_edges, options->symmetrize ? " (both directions)" : "",
+           size / 1e6, parse_time, num_runs);
+    printf("Merged in %.2f s (%d intermediate merge passes, fan-in %zu)\n",
+           merge_time, passes, fan_in);
+    printf("Vertices: %d\n", num_nodes);
+    printf("Edges:    %lu%s, %u-byte offsets\n", (unsigned long) num_edges,
+           options->deduplicate ? " after deduplication" : "", offset_bytes);
+    printf("Memory budget: %.1f MB\n", options->memory_budget / 1e6);
+}
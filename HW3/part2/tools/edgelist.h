@@ -0,0 +1,28 @@
+#ifndef __EDGELIST_H__
+#define __EDGELIST_H__
+
+#include <stddef.h>
+
+// Options for 'graphTools import-edgelist'
+struct edgelist_options
+{
+    // add the reverse of every edge
+    bool symmetrize;
+    // drop repeated (src, dst) pairs
+    bool deduplicate;
+    // bytes of heap used for run buffers, sort scratch and merge buffers
+    size_t memory_budget;
+    // directory for the sorted runs (unlinked as soon as they are created)
+    const char* temp_dir;
+};
+
+// Converts a text edge list (one "src dst" pair per line, '#' and '%'
+// lines ignored, extra columns ignored) into a v2 binary graph file.
+// The input is streamed and sorted externally, so only the memory
+// budget, not the graph size, bounds the heap used.  Vertex ids must be
+// non-negative and fit in a Vertex; the vertex count is the largest id
+// plus one.
+void import_edgelist(const char* input_filename, const char* output_filename,
+                     const edgelist_options* options);
+
+#endif /* __EDGELIST_H__ */
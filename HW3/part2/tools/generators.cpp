@@ -0,0 +1,330 @@
+#include <algorithm>
+#include <climits>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include <omp.h>
+
+#include "../common/CycleTimer.h"
+#include "../common/graph.h"
+#include "../common/memory_policy.h"
+#include "../common/parallel_scan.h"
+#include "generators.h"
+
+// Graph500 RMAT quadrant probabilities (D = 1 - A - B - C)
+#define RMAT_A 0.57
+#define RMAT_B 0.19
+#define RMAT_C 0.19
+
+#define GOLDEN_GAMMA 0x9e3779b97f4a7c15ULL
+
+// Edge slots handled per batch by the scatter pass
+#define SCATTER_BATCH 4096
+
+static inline uint64_t mix64(uint64_t z)
+{
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+// Counter-based random stream (SplitMix64) for one edge slot.  Every
+// draw depends only on (seed, slot, draw number), so the generated graph
+// is the same for any thread count or schedule.
+struct slot_rng
+{
+    uint64_t state;
+
+    slot_rng(uint64_t seed, uint64_t slot) : state(mix64(seed ^ mix64(slot + GOLDEN_GAMMA))) {}
+
+    uint64_t next()
+    {
+        state += GOLDEN_GAMMA;
+        return mix64(state);
+    }
+
+    // uniform in [0, n), by multiply-high instead of a biased modulo
+    uint64_t below(uint64_t n) { return (uint64_t)(((unsigned __int128) next() * n) >> 64); }
+};
+
+// Bijection on [0, 2^scale) that hides the RMAT id structure, as the
+// Graph500 generator does: two rounds of odd multiply and xorshift.
+struct id_scrambler
+{
+    int scale;
+    uint64_t mask, k1, k2;
+
+    id_scrambler(int scale, uint64_t seed)
+        : scale(scale), mask((1ULL << scale) - 1),
+          k1(mix64(seed + 1) | 1), k2(mix64(seed + 2) | 1) {}
+
+    uint64_t operator()(uint64_t v) const
+    {
+        v = (v * k1) & mask;
+        v ^= v >> (scale / 2 + 1);
+        v = (v * k2) & mask;
+        v ^= v >> (scale / 3 + 1);
+        return v;
+    }
+};
+
+// Each generator maps an edge slot to at most one directed edge
+struct rmat_generator
+{
+    int scale;
+    uint64_t seed;
+    id_scrambler scramble;
+
+    bool operator()(uint64_t slot, Vertex* u, Vertex* v) const
+    {
+        // quadrant thresholds in units of 2^-16; each 64-bit draw
+        // decides four levels
+        const uint64_t a = (uint64_t)(RMAT_A * 65536);
+        const uint64_t ab = (uint64_t)((RMAT_A + RMAT_B) * 65536);
+        const uint64_t abc = (uint64_t)((RMAT_A + RMAT_B + RMAT_C) * 65536);
+
+        slot_rng rng(seed, slot);
+        uint64_t src = 0, dst = 0, bits = 0;
+        for (int level = 0; level < scale; level++) {
+            if (level % 4 == 0)
+                bits = rng.next();
+            uint64_t r = bits & 0xffff;
+            bits >>= 16;
+            uint64_t src_bit = r >= ab;
+            uint64_t dst_bit = (r >= a && r < ab) || r >= abc;
+            src = (src << 1) | src_bit;
+            dst = (dst << 1) | dst_bit;
+        }
+        *u = (Vertex) scramble(src);
+        *v = (Vertex) scramble(dst);
+        return true;
+    }
+};
+
+struct erdos_renyi_generator
+{
+    uint64_t num_nodes;
+    uint64_t seed;
+
+    bool operator()(uint64_t slot, Vertex* u, Vertex* v) const
+    {
+        slot_rng rng(seed, slot);
+        *u = (Vertex) rng.below(num_nodes);
+        *v = (Vertex) rng.below(num_nodes);
+        return true;
+    }
+};
+
+// Slot d of vertex x + y*dims[0] + z*dims[0]*dims[1] is its edge to the
+// neighbor one step along axis d/2, in direction +1 or -1.
+struct grid_generator
+{
+    int axes;
+    int64_t dims[3];
+
+    bool operator()(uint64_t slot, Vertex* u, Vertex* v) const
+    {
+        int64_t vertex = slot / (2 * axes);
+        int direction = slot % (2 * axes);
+        int axis = direction / 2;
+        int64_t step = (direction & 1) ? -1 : 1;
+
+        int64_t coord[3] = { vertex % dims[0], (vertex / dims[0]) % dims[1], vertex / (dims[0] * dims[1]) };
+        coord[axis] += step;
+        if (coord[axis] < 0 || coord[axis] >= dims[axis])
+            return false;
+
+        *u = (Vertex) vertex;
+        *v = (Vertex)(coord[0] + dims[0] * (coord[1] + dims[1] * coord[2]));
+        return true;
+    }
+};
+
+// Builds the CSR of the edges produced by edge_at over [0, slots).  The
+// slots are walked twice, once to count degrees and once to scatter the
+// edges, then every neighbor list is sorted, which makes the result
+// independent of the scatter order.
+template <typename G, typename F>
+static G* build_graph(Vertex num_nodes, uint64_t slots, const F& edge_at, bool symmetrize, bool deduplicate)
+{
+    using O = typename G::offset_type;
+
+    O* starts = (O*) policy_alloc(sizeof(O) * ((size_t) num_nodes + 1));
+    #pragma omp parallel for schedule(static)
+    for (Vertex v = 0; v <= num_nodes; v++)
+        starts[v] = 0;
+
+    #pragma omp parallel for schedule(static)
+    for (uint64_t i = 0; i < slots; i++) {
+        Vertex u, v;
+        if (!edge_at(i, &u, &v))
+            continue;
+        __sync_fetch_and_add(&starts[u], 1);
+        if (symmetrize)
+            __sync_fetch_and_add(&starts[v], 1);
+    }
+
+    O num_edges = parallel_exclusive_scan(starts, starts, (long) num_nodes + 1);
+    Vertex* edges = (Vertex*) policy_alloc(sizeof(Vertex) * num_edges);
+
+    O* cursor = (O*) malloc(sizeof(O) * ((size_t) num_nodes + 1));
+    memcpy(cursor, starts, sizeof(O) * ((size_t) num_nodes + 1));
+
+    // A locked add is a full fence, so interleaving it with the (cache
+    // missing) stores into edges would serialize the misses.  Each batch
+    // claims all of its positions first and then does the stores.
+    uint64_t num_batches = (slots + SCATTER_BATCH - 1) / SCATTER_BATCH;
+    #pragma omp parallel
+    {
+        O* position = (O*) malloc(sizeof(O) * 2 * SCATTER_BATCH);
+        Vertex* target = (Vertex*) malloc(sizeof(Vertex) * 2 * SCATTER_BATCH);
+
+        #pragma omp for schedule(static)
+        for (uint64_t b = 0; b < num_batches; b++) {
+            uint64_t end = std::min(slots, (b + 1) * SCATTER_BATCH);
+            int count = 0;
+            for (uint64_t i = b * SCATTER_BATCH; i < end; i++) {
+                Vertex u, v;
+                if (!edge_at(i, &u, &v))
+                    continue;
+                position[count] = __sync_fetch_and_add(&cursor[u], 1);
+                target[count++] = v;
+                if (symmetrize) {
+                    position[count] = __sync_fetch_and_add(&cursor[v], 1);
+                    target[count++] = u;
+                }
+            }
+            for (int k = 0; k < count; k++)
+                edges[position[k]] = target[k];
+        }
+
+        free(position);
+        free(target);
+    }
+
+    // cursor is reused for the deduplicated degrees
+    #pragma omp parallel for schedule(dynamic, 1024)
+    for (Vertex v = 0; v < num_nodes; v++) {
+        std::sort(edges + starts[v], edges + starts[v + 1]);
+        if (deduplicate)
+            cursor[v] = std::unique(edges + starts[v], edges + starts[v + 1]) - (edges + starts[v]);
+    }
+
+    if (deduplicate) {
+        cursor[num_nodes] = 0;
+        O* unique_starts = (O*) policy_alloc(sizeof(O) * ((size_t) num_nodes + 1));
+        O unique_edges = parallel_exclusive_scan(cursor, unique_starts, (long) num_nodes + 1);
+        Vertex* unique = (Vertex*) policy_alloc(sizeof(Vertex) * unique_edges);
+
+        #pragma omp parallel for schedule(dynamic, 1024)
+        for (Vertex v = 0; v < num_nodes; v++)
+            memcpy(unique + unique_starts[v], edges + starts[v], sizeof(Vertex) * cursor[v]);
+
+        policy_free(starts);
+        policy_free(edges);
+        starts = unique_starts;
+        edges = unique;
+        num_edges = unique_edges;
+    }
+    free(cursor);
+
+    G* g = (G*) calloc(1, sizeof(G));
+    g->num_nodes = num_nodes;
+    g->num_edges = num_edges;
+    g->outgoing_starts = starts;
+    g->outgoing_edges = edges;
+    build_incoming_edges(g);
+    return g;
+}
+
+// Builds with the compact layout when the edge count allows it, times
+// the phases and writes the file.
+template <typename F>
+static void generate_and_store(const generator_options* options, const char* name,
+                               Vertex num_nodes, uint64_t slots, const F& edge_at,
+                               const char* output_filename)
+{
+    uint64_t max_edges = slots * (options->symmetrize ? 2 : 1);
+    double start = CycleTimer::currentSeconds();
+    double build_time, store_time;
+    long num_edges;
+
+    if (max_edges > (uint64_t) INT_MAX) {
+        Graph64 g = build_graph<graph64>(num_nodes, slots, edge_at, options->symmetrize, options->deduplicate);
+        build_time = CycleTimer::currentSeconds() - start;
+        start = CycleTimer::currentSeconds();
+        store_graph_binary(output_filename, g);
+        num_edges = g->num_edges;
+        free_graph(g);
+    } else {
+        Graph g = build_graph<graph>(num_nodes, slots, edge_at, options->symmetrize, options->deduplicate);
+        build_time = CycleTimer::currentSeconds() - start;
+        start = CycleTimer::currentSeconds();
+        store_graph_binary(output_filename, g);
+        num_edges = g->num_edges;
+        free_graph(g);
+    }
+    store_time = CycleTimer::currentSeconds() - start;
+
+    printf("Generated %s graph, scale %d, seed %lu\n", name, options->scale, (unsigned long) options->seed);
+    printf("Vertices: %d\n", num_nodes);
+    printf("Edges:    %ld%s\n", num_edges, max_edges > (uint64_t) INT_MAX ? " (64-bit edge offsets)" : "");
+    printf("Build time: %.2f s (%d threads, %.1f Medges/s), write time: %.2f s\n",
+           build_time, omp_get_max_threads(), num_edges / build_time / 1e6, store_time);
+}
+
+bool parse_generator_kind(const char* name, generator_kind* kind)
+{
+    if (!strcmp(name, "rmat") || !strcmp(name, "kronecker"))
+        *kind = GEN_RMAT;
+    else if (!strcmp(name, "er") || !strcmp(name, "uniform"))
+        *kind = GEN_ERDOS_RENYI;
+    else if (!strcmp(name, "grid2d"))
+        *kind = GEN_GRID2D;
+    else if (!strcmp(name, "grid3d"))
+        *kind = GEN_GRID3D;
+    else
+        return false;
+    return true;
+}
+
+void generate_graph(const generator_options* options, const char* output_filename)
+{
+    int scale = options->scale;
+    if (scale < 1 || scale > 30) {
+        fprintf(stderr, "Scale must be between 1 and 30.\n");
+        exit(1);
+    }
+
+    Vertex num_nodes = (Vertex)(1L << scale);
+    uint64_t edge_slots = (uint64_t) options->edge_factor << scale;
+    if ((options->kind == GEN_RMAT || options->kind == GEN_ERDOS_RENYI) && options->edge_factor < 1) {
+        fprintf(stderr, "Edge factor must be positive.\n");
+        exit(1);
+    }
+
+    switch (options->kind) {
+    case GEN_RMAT: {
+        rmat_generator gen = { scale, options->seed, id_scrambler(scale, options->seed) };
+        generate_and_store(options, "RMAT", num_nodes, edge_slots, gen, output_filename);
+        break;
+    }
+    case GEN_ERDOS_RENYI: {
+        erdos_renyi_generator gen = { (uint64_t) num_nodes, options->seed };
+        generate_and_store(options, "Erdos-Renyi", num_nodes, edge_slots, gen, output_filename);
+        break;
+    }
+    case GEN_GRID2D: {
+        grid_generator gen = { 2, { 1L << ((scale + 1) / 2), 1L << (scale / 2), 1 } };
+        generate_and_store(options, "2D grid", num_nodes, (uint64_t) num_nodes * 4, gen, output_filename);
+        break;
+    }
+    case GEN_GRID3D: {
+        grid_generator gen = { 3, { 1L << ((scale + 2) / 3), 1L << ((scale + 1) / 3), 1L << (scale / 3) } };
+        generate_and_store(options, "3D grid", num_nodes, (uint64_t) num_nodes * 6, gen, output_filename);
+        break;
+    }
+    }
+}
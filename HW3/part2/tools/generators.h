@@ -0,0 +1,39 @@
+#ifndef __GENERATORS_H__
+#define __GENERATORS_H__
+
+#include <stdint.h>
+
+// Synthetic graph families for 'graphTools generate'
+enum generator_kind
+{
+    // Graph500 Kronecker / RMAT (A=0.57, B=C=0.19), vertex ids scrambled
+    GEN_RMAT,
+    // Erdos-Renyi G(n, m): m endpoints drawn uniformly at random
+    GEN_ERDOS_RENYI,
+    // 4-neighbor 2D and 6-neighbor 3D grids, edges in both directions
+    GEN_GRID2D,
+    GEN_GRID3D,
+};
+
+struct generator_options
+{
+    generator_kind kind;
+    // 2^scale vertices; grids split the bits across their dimensions
+    int scale;
+    // edge_factor * 2^scale generated edges (ignored by grids)
+    int edge_factor;
+    // the output depends only on the seed, not on the thread count
+    uint64_t seed;
+    // add the reverse of every edge
+    bool symmetrize;
+    // drop repeated (src, dst) pairs
+    bool deduplicate;
+};
+
+bool parse_generator_kind(const char* name, generator_kind* kind);
+
+// Generates the graph in parallel and writes it as a v2 binary file,
+// with 64-bit edge offsets when it has more than INT_MAX edges.
+void generate_graph(const generator_options* options, const char* output_filename);
+
+#endif /* __GENERATORS_H__ */
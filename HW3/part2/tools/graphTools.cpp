@@ -1,13 +1,22 @@
 
 #include <algorithm>
 #include <climits>
+#include <cstdint>
 #include <iomanip>
 #include <iostream>
 #include <string>
 #include <vector>
 
+#include <getopt.h>
+#include <omp.h>
 
+
+#include "../common/CycleTimer.h"
 #include "../common/graph.h"
+#include "../common/compressed_graph.h"
+#include "reorder.h"
+#include "edgelist.h"
+#include "generators.h"
 
 #define CMD_TEXT2BIN    "text2bin"
 #define CMD_INFO        "info"
@@ -15,6 +24,10 @@
 #define CMD_NOOUTEDGES  "noout"
 #define CMD_NOINEDGES   "noin"
 #define CMD_EDGESTATS   "edgestats"
+#define CMD_COMPRESS    "compress"
+#define CMD_REORDER     "reorder"
+#define CMD_IMPORT      "import-edgelist"
+#define CMD_GENERATE    "generate"
 
 
 void print_help(const char* binary_name) {
@@ -27,7 +40,70 @@ void print_help(const char* binary_name) {
               << CMD_PRINT << ": print graph topology (careful with big graphs)\n"
               << CMD_NOOUTEDGES << ": detect vertices with no outgoing edges\n"
               << CMD_NOINEDGES << ": detect vertices with no incoming edges\n"
-              << CMD_EDGESTATS << ": print stats on graph edges: e.g., min/max edges per node, etc.\n";
+              << CMD_EDGESTATS << ": print stats on graph edges: e.g., min/max edges per node, etc.\n"
+              << CMD_COMPRESS << ": report compression ratio and decode throughput of the varint layout\n"
+              << CMD_REORDER << ": relabel vertices for locality and write the graph plus the permutation\n"
+              << CMD_IMPORT << ": stream a (possibly huge) src/dst edge list into a binary graph file\n"
+              << CMD_GENERATE << ": generate an RMAT, Erdos-Renyi or grid graph as a binary graph file\n";
+}
+
+// Decodes every neighbor list of one direction of c in parallel,
+// returning a checksum so the work cannot be optimized away.
+template <typename C, typename F>
+static uint64_t decode_all(const C* c, F neighbors) {
+    uint64_t checksum = 0;
+    #pragma omp parallel for schedule(dynamic, 1024) reduction(+:checksum)
+    for (int i = 0; i < num_nodes(c); i++) {
+        for (Vertex v : neighbors(c, i))
+            checksum += v;
+    }
+    return checksum;
+}
+
+// True if every compressed neighbor list of c decodes to the sorted
+// neighbor list of g.
+template <typename G, typename C>
+static bool verify_compressed(const G* g, const C* c) {
+    bool ok = true;
+    #pragma omp parallel
+    {
+        std::vector<Vertex> expected;
+        #pragma omp for schedule(dynamic, 1024) reduction(&&:ok)
+        for (int i = 0; i < num_nodes(g); i++) {
+            expected.assign(outgoing_begin(g, i), outgoing_end(g, i));
+            std::sort(expected.begin(), expected.end());
+            size_t k = 0;
+            for (Vertex v : outgoing_neighbors(c, i))
+                ok = ok && k < expected.size() && expected[k++] == v;
+            ok = ok && k == expected.size();
+
+            expected.assign(incoming_begin(g, i), incoming_end(g, i));
+            std::sort(expected.begin(), expected.end());
+            k = 0;
+            for (Vertex v : incoming_neighbors(c, i))
+                ok = ok && k < expected.size() && expected[k++] == v;
+            ok = ok && k == expected.size();
+        }
+    }
+    return ok;
+}
+
+// Loads a binary graph in the compact layout when it fits, or with
+// 64-bit edge offsets otherwise, and hands it to f.
+template <typename F>
+static void with_binary_graph(const std::string& filename, F f) {
+    std::cout << "Loading graph: " << filename << "\n";
+    if (graph_file_needs_wide_offsets(filename.c_str())) {
+        Graph64 g = load_graph_binary64(filename.c_str());
+        std::cout << "Done loading (64-bit edge offsets).\n";
+        f(g);
+        free_graph(g);
+    } else {
+        Graph g = load_graph_binary(filename.c_str());
+        std::cout << "Done loading.\n";
+        f(g);
+        free_graph(g);
+    }
 }
 
 int main(int argc, char** argv) {
@@ -50,12 +126,18 @@ int main(int argc, char** argv) {
         std::string inputFilename = std::string(argv[2]);
         std::string outputFilename = std::string(argv[3]);
 
-        Graph g;
         std::cout << "Loading graph: " << inputFilename << "\n";
-        g = load_graph(inputFilename.c_str());
-        std::cout << "Done loading.\n";
-        store_graph_binary(outputFilename.c_str(), g);
-        free_graph(g);
+        if (graph_file_needs_wide_offsets(inputFilename.c_str())) {
+            Graph64 g = load_graph64(inputFilename.c_str());
+            std::cout << "Done loading (64-bit edge offsets).\n";
+            store_graph_binary(outputFilename.c_str(), g);
+            free_graph(g);
+        } else {
+            Graph g = load_graph(inputFilename.c_str());
+            std::cout << "Done loading.\n";
+            store_graph_binary(outputFilename.c_str(), g);
+            free_graph(g);
+        }
 
     } else if (!cmd.compare(CMD_INFO)) {
         if (argc < 3) {
@@ -66,14 +148,10 @@ int main(int argc, char** argv) {
 
         std::string inputFilename = std::string(argv[2]);
 
-        Graph g;
-        std::cout << "Loading graph: " << inputFilename << "\n";
-        g = load_graph_binary(inputFilename.c_str());
-        std::cout << "Done loading.\n";
-
-        std::cout << "Num vertices: " << num_nodes(g) << "\n";
-        std::cout << "Num edges:    " << num_edges(g) << "\n";
-        free_graph(g);
+        with_binary_graph(inputFilename, [&](auto g) {
+            std::cout << "Num vertices: " << num_nodes(g) << "\n";
+            std::cout << "Num edges:    " << num_edges(g) << "\n";
+        });
 
     } else if (!cmd.compare(CMD_PRINT)) {
 
@@ -85,12 +163,9 @@ int main(int argc, char** argv) {
 
         std::string inputFilename = std::string(argv[2]);
 
-        Graph g;
-        std::cout << "Loading graph: " << inputFilename << "\n";
-        g = load_graph_binary(inputFilename.c_str());
-        std::cout << "Done loading.\n";
-        print_graph(g);
-        free_graph(g);
+        with_binary_graph(inputFilename, [&](auto g) {
+            print_graph(g);
+        });
 
     } else if (!cmd.compare(CMD_NOOUTEDGES)) {
 
@@ -102,28 +177,24 @@ int main(int argc, char** argv) {
 
         std::string inputFilename = std::string(argv[2]);
 
-        Graph g;
-        std::cout << "Loading graph: " << inputFilename << "\n";
-        g = load_graph_binary(inputFilename.c_str());
-        std::cout << "Done loading.\n";
-
-        std::vector<Vertex> zero_outgoing;
+        with_binary_graph(inputFilename, [&](auto g) {
+            std::vector<Vertex> zero_outgoing;
 
-        for (int i=0; i<num_nodes(g); i++) {
-            if (outgoing_size(g, i) == 0) {
-                zero_outgoing.push_back(i);
+            for (int i=0; i<num_nodes(g); i++) {
+                if (outgoing_size(g, i) == 0) {
+                    zero_outgoing.push_back(i);
+                }
             }
-        }
 
-        std::cout << "Nodes with no outgoing edges:\n";
-        for (size_t i=0; i<zero_outgoing.size(); i++) {
-            std::cout << zero_outgoing[i] << " ";
-        }
-        std::cout << "\n";
-        std::cout << zero_outgoing.size() << " of " << num_nodes(g) << " nodes have zero outgoing edges ("
-                  << std::setprecision(2)
-                  << 100.0 * static_cast<double>(zero_outgoing.size())/num_nodes(g) << "\%).\n";
-        free_graph(g);
+            std::cout << "Nodes with no outgoing edges:\n";
+            for (size_t i=0; i<zero_outgoing.size(); i++) {
+                std::cout << zero_outgoing[i] << " ";
+            }
+            std::cout << "\n";
+            std::cout << zero_outgoing.size() << " of " << num_nodes(g) << " nodes have zero outgoing edges ("
+                      << std::setprecision(2)
+                      << 100.0 * static_cast<double>(zero_outgoing.size())/num_nodes(g) << "\%).\n";
+        });
 
     } else if (!cmd.compare(CMD_NOINEDGES)) {
 
@@ -135,28 +206,24 @@ int main(int argc, char** argv) {
 
         std::string inputFilename = std::string(argv[2]);
 
-        Graph g;
-        std::cout << "Loading graph: " << inputFilename << "\n";
-        g = load_graph_binary(inputFilename.c_str());
-        std::cout << "Done loading.\n";
+        with_binary_graph(inputFilename, [&](auto g) {
+            std::vector<Vertex> zero_incoming;
 
-        std::vector<Vertex> zero_incoming;
-
-        for (int i=0; i<num_nodes(g); i++) {
-            if (incoming_size(g, i) == 0) {
-                zero_incoming.push_back(i);
+            for (int i=0; i<num_nodes(g); i++) {
+                if (incoming_size(g, i) == 0) {
+                    zero_incoming.push_back(i);
+                }
             }
-        }
 
-        std::cout << "Nodes with no incoming edges:\n";
-        for (size_t i=0; i<zero_incoming.size(); i++) {
-            std::cout << zero_incoming[i] << " ";
-        }
-        std::cout << "\n";
-        std::cout << zero_incoming.size() << " of " << num_nodes(g) << " nodes have zero incoming edges ("
-                  << std::setprecision(2)
-                  << 100.0 * static_cast<double>(zero_incoming.size())/num_nodes(g) << "\%).\n";
-        free_graph(g);
+            std::cout << "Nodes with no incoming edges:\n";
+            for (size_t i=0; i<zero_incoming.size(); i++) {
+                std::cout << zero_incoming[i] << " ";
+            }
+            std::cout << "\n";
+            std::cout << zero_incoming.size() << " of " << num_nodes(g) << " nodes have zero incoming edges ("
+                      << std::setprecision(2)
+                      << 100.0 * static_cast<double>(zero_incoming.size())/num_nodes(g) << "\%).\n";
+        });
 
     } else if (!cmd.compare(CMD_EDGESTATS)) {
 
@@ -168,104 +235,279 @@ int main(int argc, char** argv) {
 
         std::string inputFilename = std::string(argv[2]);
 
-        Graph g;
-        std::cout << "Loading graph: " << inputFilename << "\n";
-        g = load_graph_binary(inputFilename.c_str());
-        std::cout << "Done loading. Now analyzing graph...\n";
-
-        unsigned int total_incoming = 0;
-        unsigned int total_outgoing = 0;
-        unsigned int min_outgoing = INT_MAX;
-        unsigned int max_outgoing = 0;
-        unsigned int min_incoming = INT_MAX;
-        unsigned int max_incoming = 0;
-        bool is_symmetric = true;
-
-        for (int i=0; i<num_nodes(g); i++) {
-
-            unsigned int num_incoming = incoming_size(g, i);
-            unsigned int num_outgoing = outgoing_size(g, i);
-
-            min_outgoing = std::min(min_outgoing, num_outgoing);
-            max_outgoing = std::max(max_outgoing, num_outgoing);
-            total_outgoing += num_outgoing;
-
-            min_incoming = std::min(min_incoming, num_incoming);
-            max_incoming = std::max(max_incoming, num_incoming);
-            total_incoming += num_incoming;
-
-            // check graph for sanity, and test for symmetric directed
-            // edges
-            const Vertex* out_begin = outgoing_begin(g, i);
-            const Vertex* out_end = outgoing_end(g, i);
-            for (const Vertex* v=out_begin; v!=out_end; v++) {
-
-                Vertex target = *v;
-
-                // sanity check. vertex i has an outoing edge to target
-                // (i->target), therefore target better have an
-                // incoming edge from i.
-                bool found_matching = false;
-                const Vertex* sanity_begin = incoming_begin(g, target);
-                const Vertex* sanity_end = incoming_end(g, target);
-                for (const Vertex* v2=sanity_begin; v2!=sanity_end; v2++) {
-                    Vertex i2 = *v2;
-                    if (i == i2) {
-                        found_matching = true;
-                        break;
+        with_binary_graph(inputFilename, [&](auto g) {
+            std::cout << "Now analyzing graph...\n";
+
+            uint64_t total_incoming = 0;
+            uint64_t total_outgoing = 0;
+            uint64_t min_outgoing = UINT64_MAX;
+            uint64_t max_outgoing = 0;
+            uint64_t min_incoming = UINT64_MAX;
+            uint64_t max_incoming = 0;
+            bool is_symmetric = true;
+
+            for (int i=0; i<num_nodes(g); i++) {
+
+                uint64_t num_incoming = incoming_size(g, i);
+                uint64_t num_outgoing = outgoing_size(g, i);
+
+                min_outgoing = std::min(min_outgoing, num_outgoing);
+                max_outgoing = std::max(max_outgoing, num_outgoing);
+                total_outgoing += num_outgoing;
+
+                min_incoming = std::min(min_incoming, num_incoming);
+                max_incoming = std::max(max_incoming, num_incoming);
+                total_incoming += num_incoming;
+
+                // check graph for sanity, and test for symmetric directed
+                // edges
+                const Vertex* out_begin = outgoing_begin(g, i);
+                const Vertex* out_end = outgoing_end(g, i);
+                for (const Vertex* v=out_begin; v!=out_end; v++) {
+
+                    Vertex target = *v;
+
+                    // sanity check. vertex i has an outoing edge to target
+                    // (i->target), therefore target better have an
+                    // incoming edge from i.
+                    bool found_matching = false;
+                    const Vertex* sanity_begin = incoming_begin(g, target);
+                    const Vertex* sanity_end = incoming_end(g, target);
+                    for (const Vertex* v2=sanity_begin; v2!=sanity_end; v2++) {
+                        Vertex i2 = *v2;
+                        if (i == i2) {
+                            found_matching = true;
+                            break;
+                        }
                     }
+                    if (!found_matching) {
+                        std::cerr << "GRAPH DID NOT PASS SANITY CHECK:\n"
+                                  << "vertex " << i << " has outgoing edge to " << target << ",\n but "
+                                  << "vertex " << target << " has no incoming edge from " << i << "\n";
+
+                        // abort on a failed sanity check
+                        exit(1);
+                     }
+
+                    // symmetry test: vertex i has an outgoing edge to
+                    // target (i->target), so check to see if there's an
+                    // incoming edge from target as well (target->i).
+                    bool found_symmetric = false;
+                    const Vertex* in_start = incoming_begin(g, i);
+                    const Vertex* in_end =   incoming_end(g, i);
+
+                    for (const Vertex* v2=in_start; v2!=in_end; v2++) {
+
+                        Vertex target2 = *v2;
+
+                        if (target == target2) {
+                            found_symmetric = true;
+                            break;
+                        }
+                    }
+                    if (!found_symmetric)
+                        is_symmetric = false;
+
                 }
-                if (!found_matching) {
-                    std::cerr << "GRAPH DID NOT PASS SANITY CHECK:\n"
-                              << "vertex " << i << " has outgoing edge to " << target << ",\n but "
-                              << "vertex " << target << " has no incoming edge from " << i << "\n";
 
-                    // abort on a failed sanity check
-                    exit(1);
-                 }
+            }
+
+            float avg_outgoing = (float)total_outgoing / num_nodes(g);
+            float avg_incoming = (float)total_incoming / num_nodes(g);
+
+            std::cout << "=========================================================\n";
+            std::cout << "Edge statistics for this graph:\n";
+            std::cout << "=========================================================\n";
+            std::cout << "The graph " << ((is_symmetric) ? "IS " : "IS NOT ") << "symmetric.\n";
+            std::cout << "Outgoing edges: total=" << total_outgoing
+                      << " avg=" << avg_outgoing
+                      << " min=" << min_outgoing
+                      << " max=" << max_outgoing << "\n";
+
+            std::cout << "Incoming edges: total=" << total_incoming
+                      << " avg=" << avg_incoming
+                      << " min=" << min_incoming
+                      << " max=" << max_incoming << "\n";
+        });
+    }
 
-                // symmetry test: vertex i has an outgoing edge to
-                // target (i->target), so check to see if there's an
-                // incoming edge from target as well (target->i).
-                bool found_symmetric = false;
-                const Vertex* in_start = incoming_begin(g, i);
-                const Vertex* in_end =   incoming_end(g, i);
+    else if (!cmd.compare(CMD_COMPRESS)) {
 
-                for (const Vertex* v2=in_start; v2!=in_end; v2++) {
+        if (argc < 3) {
+            std::cerr << "Usage: " << argv[0] << " " << cmd << " filename\n";
+            std::cerr << "Builds the compressed (delta + varint) adjacency layout and reports\n"
+                      << "its compression ratio and decode throughput.\n";
+            exit(1);
+        }
 
-                    Vertex target2 = *v2;
+        std::string inputFilename = std::string(argv[2]);
 
-                    if (target == target2) {
-                        found_symmetric = true;
-                        break;
-                    }
-                }
-                if (!found_symmetric)
-                    is_symmetric = false;
+        with_binary_graph(inputFilename, [&](auto g) {
+            double start = CycleTimer::currentSeconds();
+            auto c = compress_graph(g);
+            double build_time = CycleTimer::currentSeconds() - start;
+
+            if (!verify_compressed(g, c)) {
+                std::cerr << "COMPRESSED GRAPH DOES NOT MATCH THE ORIGINAL\n";
+                exit(1);
+            }
 
+            uint64_t plain_bytes = 2 * sizeof(Vertex) * (uint64_t) num_edges(g);
+            uint64_t packed_bytes = compressed_adjacency_bytes(c);
+
+            // decode each direction a few times and keep the best run
+            const int runs = 3;
+            double best_time = 1e30;
+            uint64_t checksum = 0;
+            for (int r = 0; r < runs; r++) {
+                start = CycleTimer::currentSeconds();
+                checksum = decode_all(c, [](auto graph, int v) { return outgoing_neighbors(graph, v); });
+                checksum += decode_all(c, [](auto graph, int v) { return incoming_neighbors(graph, v); });
+                best_time = std::min(best_time, CycleTimer::currentSeconds() - start);
             }
 
+            double edges_decoded = 2.0 * num_edges(g);
+            std::cout << std::fixed << std::setprecision(2);
+            std::cout << "Plain adjacency:      " << plain_bytes / 1e6 << " MB\n";
+            std::cout << "Compressed adjacency: " << packed_bytes / 1e6 << " MB"
+                      << " (incl. " << 2 * sizeof(uint64_t) * ((uint64_t) num_nodes(g) + 1) / 1e6
+                      << " MB of byte offsets)\n";
+            std::cout << "Compression ratio:    " << (double) plain_bytes / packed_bytes << "x\n";
+            std::cout << "Bits per edge:        " << 8.0 * packed_bytes / edges_decoded << "\n";
+            std::cout << "Build time:           " << build_time << " s\n";
+            std::cout << "Decode throughput:    " << edges_decoded / best_time / 1e6 << " Medges/s, "
+                      << packed_bytes / best_time / 1e9 << " GB/s compressed"
+                      << " (" << omp_get_max_threads() << " threads, checksum " << checksum << ")\n";
+            free_graph(c);
+        });
+
+    } else if (!cmd.compare(CMD_REORDER)) {
+
+        reorder_method method;
+        if (argc < 6 || !parse_reorder_method(argv[2], &method)) {
+            std::cerr << "Usage: " << argv[0] << " " << cmd << " degree|hub|rcm|gorder inbin outbin permfile [window]\n";
+            std::cerr << "Relabels the vertices of a binary graph, writes the relabeled graph and\n"
+                      << "the permutation (pass it to bfs/pr with -p to map results back).\n"
+                      << "window is the Gorder window size (default 5).\n";
+            exit(1);
         }
 
-        float avg_outgoing = (float)total_outgoing / num_nodes(g);
-        float avg_incoming = (float)total_incoming / num_nodes(g);
-
-        std::cout << "=========================================================\n";
-        std::cout << "Edge statistics for this graph:\n";
-        std::cout << "=========================================================\n";
-        std::cout << "The graph " << ((is_symmetric) ? "IS " : "IS NOT ") << "symmetric.\n";
-        std::cout << "Outgoing edges: total=" << total_outgoing
-                  << " avg=" << avg_outgoing
-                  << " min=" << min_outgoing
-                  << " max=" << max_outgoing << "\n";
-
-        std::cout << "Incoming edges: total=" << total_incoming
-                  << " avg=" << avg_incoming
-                  << " min=" << min_incoming
-                  << " max=" << max_incoming << "\n";
-    }
+        std::string inputFilename = std::string(argv[3]);
+        std::string outputFilename = std::string(argv[4]);
+        std::string permFilename = std::string(argv[5]);
+        int window = (argc > 6) ? atoi(argv[6]) : 5;
+        if (window < 1) {
+            std::cerr << "Window size must be positive\n";
+            exit(1);
+        }
+
+        with_binary_graph(inputFilename, [&](auto g) {
+            double start = CycleTimer::currentSeconds();
+            Vertex* new_ids = compute_reordering(g, method, window);
+            double order_time = CycleTimer::currentSeconds() - start;
+
+            start = CycleTimer::currentSeconds();
+            auto relabeled = permute_graph(g, new_ids);
+            double permute_time = CycleTimer::currentSeconds() - start;
+
+            std::cout << std::fixed << std::setprecision(3);
+            std::cout << "Ordering time:      " << order_time << " s\n";
+            std::cout << "Relabeling time:    " << permute_time << " s\n";
+            std::cout << "Avg log2 edge gap:  " << average_log_edge_gap(g)
+                      << " -> " << average_log_edge_gap(relabeled) << "\n";
+
+            store_graph_binary(outputFilename.c_str(), relabeled);
+            store_permutation(permFilename.c_str(), new_ids, num_nodes(g));
+            free_graph(relabeled);
+            free(new_ids);
+        });
+
+    } else if (!cmd.compare(CMD_IMPORT)) {
+
+        edgelist_options options = { false, false, (size_t) 1024 << 20, NULL };
+        bool usage = false;
+        int opt;
+        optind = 2;
+        while ((opt = getopt(argc, argv, "sdM:T:")) != -1) {
+            switch (opt) {
+            case 's':
+                options.symmetrize = true;
+                break;
+            case 'd':
+                options.deduplicate = true;
+                break;
+            case 'M':
+                options.memory_budget = (size_t) atol(optarg) << 20;
+                break;
+            case 'T':
+                options.temp_dir = optarg;
+                break;
+            default:
+                usage = true;
+            }
+        }
+
+        if (usage || argc - optind < 2 || options.memory_budget < ((size_t) 16 << 20)) {
+            std::cerr << "Usage: " << argv[0] << " " << cmd << " [-s] [-d] [-M budget_mb] [-T tmpdir] edgelist binfilename\n";
+            std::cerr << "Converts a text edge list (one 'src dst' pair per line, '#' or '%' comments)\n"
+                      << "to binary file format, sorting on disk so it works for inputs larger than RAM.\n"
+                      << "  -s: symmetrize (add the reverse of every edge)\n"
+                      << "  -d: drop duplicate edges\n"
+                      << "  -M: heap budget in MB, at least 16 (default 1024)\n"
+                      << "  -T: directory for temporary sorted runs (default: next to binfilename)\n";
+            exit(1);
+        }
+
+        std::string inputFilename = std::string(argv[optind]);
+        std::string outputFilename = std::string(argv[optind + 1]);
+        std::string tempDir = options.temp_dir ? options.temp_dir : ".";
+        if (!options.temp_dir && outputFilename.find('/') != std::string::npos)
+            tempDir = outputFilename.substr(0, outputFilename.rfind('/') + 1);
+        options.temp_dir = tempDir.c_str();
+
+        std::cout << "Importing edge list: " << inputFilename << "\n";
+        double start = CycleTimer::currentSeconds();
+        import_edgelist(inputFilename.c_str(), outputFilename.c_str(), &options);
+        std::cout << "Done in " << CycleTimer::currentSeconds() - start << " s.\n";
+
+    } else if (!cmd.compare(CMD_GENERATE)) {
+
+        generator_options options = { GEN_RMAT, 0, 0, 0, false, false };
+        bool usage = false;
+        int opt;
+        optind = 2;
+        while ((opt = getopt(argc, argv, "sd")) != -1) {
+            switch (opt) {
+            case 's':
+                options.symmetrize = true;
+                break;
+            case 'd':
+                options.deduplicate = true;
+                break;
+            default:
+                usage = true;
+            }
+        }
+
+        if (usage || argc - optind < 5 || !parse_generator_kind(argv[optind], &options.kind)) {
+            std::cerr << "Usage: " << argv[0] << " " << cmd << " [-s] [-d] rmat|er|grid2d|grid3d scale edgefactor seed binfilename\n";
+            std::cerr << "Generates a graph with 2^scale vertices in parallel. The result only depends\n"
+                      << "on the arguments, not on the number of threads.\n"
+                      << "  rmat:   Graph500 Kronecker, edgefactor * 2^scale edges, scrambled ids\n"
+                      << "  er:     Erdos-Renyi, edgefactor * 2^scale uniformly random edges\n"
+                      << "  grid2d: 4-neighbor grid (edgefactor and seed unused)\n"
+                      << "  grid3d: 6-neighbor grid (edgefactor and seed unused)\n"
+                      << "  -s: symmetrize (add the reverse of every edge)\n"
+                      << "  -d: drop duplicate edges\n";
+            exit(1);
+        }
+
+        options.scale = atoi(argv[optind + 1]);
+        options.edge_factor = atoi(argv[optind + 2]);
+        options.seed = strtoull(argv[optind + 3], NULL, 10);
+        generate_graph(&options, argv[optind + 4]);
 
-    else {
+    } else {
         print_help(argv[0]);
     }
 
@@ -0,0 +1,297 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <queue>
+#include <utility>
+#include <vector>
+
+#include <omp.h>
+#include <parallel/algorithm>
+
+#include "reorder.h"
+
+bool parse_reorder_method(const char* name, reorder_method* method)
+{
+    if (!strcmp(name, "degree"))
+        *method = REORDER_DEGREE;
+    else if (!strcmp(name, "hub"))
+        *method = REORDER_HUB;
+    else if (!strcmp(name, "rcm"))
+        *method = REORDER_RCM;
+    else if (!strcmp(name, "gorder"))
+        *method = REORDER_GORDER;
+    else
+        return false;
+    return true;
+}
+
+template <typename G>
+static inline int64_t total_degree(const G* g, Vertex v)
+{
+    return (int64_t) outgoing_size(g, v) + incoming_size(g, v);
+}
+
+// Turns an ordering (order[i] is the vertex placed at position i) into
+// the new_ids array.
+static Vertex* order_to_new_ids(const std::vector<Vertex>& order)
+{
+    Vertex n = order.size();
+    Vertex* new_ids = (Vertex*)malloc(sizeof(Vertex) * n);
+    #pragma omp parallel for schedule(static)
+    for (Vertex i = 0; i < n; i++)
+        new_ids[order[i]] = i;
+    return new_ids;
+}
+
+template <typename G>
+static std::vector<Vertex> degree_order(const G* g)
+{
+    Vertex n = num_nodes(g);
+    std::vector<Vertex> order(n);
+    std::vector<int64_t> degree(n);
+
+    #pragma omp parallel for schedule(static)
+    for (Vertex v = 0; v < n; v++) {
+        order[v] = v;
+        degree[v] = total_degree(g, v);
+    }
+
+    __gnu_parallel::sort(order.begin(), order.end(), [&](Vertex a, Vertex b) {
+        return degree[a] != degree[b] ? degree[a] > degree[b] : a < b;
+    });
+    return order;
+}
+
+// Stable parallel partition: hubs first, then the rest.  Each thread
+// counts the hubs in its block, a scan over the per-thread counts gives
+// every block its write positions in both halves.
+template <typename G>
+static std::vector<Vertex> hub_order(const G* g)
+{
+    Vertex n = num_nodes(g);
+    double average = n > 0 ? 2.0 * num_edges(g) / n : 0.0;
+    std::vector<Vertex> order(n);
+
+    int threads = omp_get_max_threads();
+    std::vector<int64_t> hubs_before(threads + 1, 0);
+    int64_t total_hubs = 0;
+
+    #pragma omp parallel num_threads(threads)
+    {
+        int tid = omp_get_thread_num();
+        int nthreads = omp_get_num_threads();
+        Vertex begin = (int64_t) n * tid / nthreads;
+        Vertex end = (int64_t) n * (tid + 1) / nthreads;
+
+        int64_t hubs = 0;
+        for (Vertex v = begin; v < end; v++)
+            hubs += total_degree(g, v) > average;
+        hubs_before[tid + 1] = hubs;
+
+        #pragma omp barrier
+        #pragma omp single
+        {
+            for (int t = 1; t <= nthreads; t++)
+                hubs_before[t] += hubs_before[t - 1];
+            total_hubs = hubs_before[nthreads];
+        }
+
+        int64_t hub_pos = hubs_before[tid];
+        int64_t other_pos = total_hubs + (begin - hubs_before[tid]);
+        for (Vertex v = begin; v < end; v++) {
+            if (total_degree(g, v) > average)
+                order[hub_pos++] = v;
+            else
+                order[other_pos++] = v;
+        }
+    }
+    return order;
+}
+
+// Reverse Cuthill-McKee, treating edges as undirected.  Each component
+// is started from its lowest-degree vertex.  The traversal itself is
+// sequential; the degree sort that picks the start vertices is not.
+template <typename G>
+static std::vector<Vertex> rcm_order(const G* g)
+{
+    Vertex n = num_nodes(g);
+    std::vector<Vertex> by_degree = degree_order(g);
+    std::reverse(by_degree.begin(), by_degree.end());
+
+    std::vector<char> visited(n, 0);
+    std::vector<Vertex> order;
+    std::vector<Vertex> next;
+    order.reserve(n);
+
+    for (Vertex start : by_degree) {
+        if (visited[start])
+            continue;
+
+        size_t head = order.size();
+        visited[start] = 1;
+        order.push_back(start);
+
+        while (head < order.size()) {
+            Vertex u = order[head++];
+            next.clear();
+            for (Vertex v : outgoing_neighbors(g, u)) {
+                if (!visited[v]) {
+                    visited[v] = 1;
+                    next.push_back(v);
+                }
+            }
+            for (Vertex v : incoming_neighbors(g, u)) {
+                if (!visited[v]) {
+                    visited[v] = 1;
+                    next.push_back(v);
+                }
+            }
+            std::sort(next.begin(), next.end(), [&](Vertex a, Vertex b) {
+                int64_t da = total_degree(g, a), db = total_degree(g, b);
+                return da != db ? da < db : a < b;
+            });
+            order.insert(order.end(), next.begin(), next.end());
+        }
+    }
+
+    std::reverse(order.begin(), order.end());
+    return order;
+}
+
+// Gorder-style greedy ordering of the vertices in [begin, end).  The
+// score of an unplaced vertex u is the number of edges between u and
+// the last `window` placed vertices plus the number of in-neighbors it
+// shares with them.  Scores live in a lazily updated max-heap: stale
+// entries are re-pushed with the current score when popped.  Parents
+// with more than hub_degree out-edges are skipped when counting shared
+// in-neighbors, as in Gorder, to keep the update cost bounded.
+template <typename G>
+static void gorder_range(const G* g, Vertex begin, Vertex end, int window,
+                         int64_t hub_degree, Vertex* out)
+{
+    Vertex count = end - begin;
+    std::vector<int> score(count, 0);
+    std::vector<char> placed(count, 0);
+    std::priority_queue<std::pair<int, Vertex>> heap;
+
+    auto in_range = [&](Vertex v) { return v >= begin && v < end; };
+    auto update = [&](Vertex v, int delta) {
+        auto touch = [&](Vertex u) {
+            if (in_range(u) && !placed[u - begin]) {
+                score[u - begin] += delta;
+                if (delta > 0)
+                    heap.push(std::make_pair(score[u - begin], u));
+            }
+        };
+        for (Vertex u : outgoing_neighbors(g, v))
+            touch(u);
+        for (Vertex p : incoming_neighbors(g, v)) {
+            touch(p);
+            if (outgoing_size(g, p) <= hub_degree) {
+                for (Vertex u : outgoing_neighbors(g, p))
+                    if (u != v)
+                        touch(u);
+            }
+        }
+    };
+
+    // seed with the vertex of highest in-degree
+    Vertex seed = begin;
+    for (Vertex v = begin; v < end; v++)
+        if (incoming_size(g, v) > incoming_size(g, seed))
+            seed = v;
+
+    Vertex cursor = begin;
+    for (Vertex i = 0; i < count; i++) {
+        Vertex v = -1;
+        if (i == 0)
+            v = seed;
+        while (v < 0 && !heap.empty()) {
+            std::pair<int, Vertex> top = heap.top();
+            heap.pop();
+            Vertex u = top.second;
+            if (placed[u - begin])
+                continue;
+            if (top.first > score[u - begin]) {
+                heap.push(std::make_pair(score[u - begin], u));
+                continue;
+            }
+            if (top.first < score[u - begin])
+                continue;
+            v = u;
+        }
+        if (v < 0) {
+            while (placed[cursor - begin])
+                cursor++;
+            v = cursor;
+        }
+
+        placed[v - begin] = 1;
+        out[i] = v;
+        update(v, +1);
+        if (i >= window)
+            update(out[i - window], -1);
+    }
+}
+
+// The greedy placement is inherently sequential, so the vertex range is
+// cut into one contiguous slice per thread and each slice is ordered
+// independently; edges leaving a slice do not contribute to its scores.
+template <typename G>
+static std::vector<Vertex> gorder_order(const G* g, int window)
+{
+    Vertex n = num_nodes(g);
+    std::vector<Vertex> order(n);
+    int64_t hub_degree = (int64_t) std::sqrt((double) n) + 1;
+    int slices = std::max(1, std::min(omp_get_max_threads(), (int)(n / 4096)));
+
+    #pragma omp parallel for schedule(dynamic, 1)
+    for (int s = 0; s < slices; s++) {
+        Vertex begin = (int64_t) n * s / slices;
+        Vertex end = (int64_t) n * (s + 1) / slices;
+        gorder_range(g, begin, end, window, hub_degree, order.data() + begin);
+    }
+    return order;
+}
+
+template <typename G>
+static Vertex* compute_reordering_impl(const G* g, reorder_method method, int window)
+{
+    switch (method) {
+    case REORDER_DEGREE:
+        return order_to_new_ids(degree_order(g));
+    case REORDER_HUB:
+        return order_to_new_ids(hub_order(g));
+    case REORDER_RCM:
+        return order_to_new_ids(rcm_order(g));
+    case REORDER_GORDER:
+    default:
+        return order_to_new_ids(gorder_order(g, window));
+    }
+}
+
+Vertex* compute_reordering(const graph* g, reorder_method method, int window)
+{
+    return compute_reordering_impl(g, method, window);
+}
+
+Vertex* compute_reordering(const graph64* g, reorder_method method, int window)
+{
+    return compute_reordering_impl(g, method, window);
+}
+
+template <typename G>
+static double average_log_edge_gap_impl(const G* g)
+{
+    double total = 0.0;
+    #pragma omp parallel for schedule(dynamic, 1024) reduction(+:total)
+    for (Vertex u = 0; u < num_nodes(g); u++) {
+        for (Vertex v : outgoing_neighbors(g, u))
+            total += std::log2(1.0 + std::abs((double) u - v));
+    }
+    return num_edges(g) > 0 ? total / num_edges(g) : 0.0;
+}
+
+double average_log_edge_gap(const graph* g) { return average_log_edge_gap_impl(g); }
+double average_log_edge_gap(const graph64* g) { return average_log_edge_gap_impl(g); }
@@ -0,0 +1,33 @@
+#ifndef __REORDER_H__
+#define __REORDER_H__
+
+#include "../common/graph.h"
+
+// Vertex relabeling heuristics used by 'graphTools reorder'
+enum reorder_method
+{
+    // sort by total degree, highest first
+    REORDER_DEGREE,
+    // vertices of above-average degree first, both groups keep their
+    // original relative order
+    REORDER_HUB,
+    // reverse Cuthill-McKee on the symmetrized graph
+    REORDER_RCM,
+    // Gorder-style greedy: place next the vertex sharing the most
+    // neighbors with the last `window` placed vertices
+    REORDER_GORDER,
+};
+
+bool parse_reorder_method(const char* name, reorder_method* method);
+
+// Returns new_ids, with vertex v to be renamed new_ids[v].  The caller
+// frees it.  window is only used by REORDER_GORDER.
+Vertex* compute_reordering(const graph* g, reorder_method method, int window);
+Vertex* compute_reordering(const graph64* g, reorder_method method, int window);
+
+// Average log2 distance between the ids of the endpoints of each edge,
+// a rough proxy for how cache-friendly the labeling is.
+double average_log_edge_gap(const graph* g);
+double average_log_edge_gap(const graph64* g);
+
+#endif /* __REORDER_H__ */